@@ -1,7 +1,5 @@
-#include <mxml.h>
-
 #include <string.h>
-#include <ctype.h>
+#include <stdlib.h>
 #include <grrlib.h>
 #include "animation.h"
 #include "player.h"
@@ -10,189 +8,64 @@
 #include "game.h"
 #include "object_includes.h"
 
-void extractAnimName(const char* frameName, char* outAnimName) {
-    strcpy(outAnimName, frameName);
-
-    // remove extension
-    char* dot = strrchr(outAnimName, '.');
-    if (dot) *dot = '\0';
-
-    // remove trailing _### if present
-    char* underscore = strrchr(outAnimName, '_');
-    if (underscore && isdigit(*(unsigned char *)(underscore + 1))) {
-        *underscore = '\0';
-    }
-}
-
-Animation* getOrCreateAnimation(AnimationLibrary* lib, const char* animName) {
-    for (int i = 0; i < lib->animCount; i++) {
-        if (strcmp(lib->animations[i].name, animName) == 0) {
-            return &lib->animations[i];
-        }
-    }
-    Animation* a = &lib->animations[lib->animCount++];
-    strncpy(a->name, animName, sizeof(a->name));
-    a->frameCount = 0;
-    return a;
-}
-
-void parsePlist(const char* filename, AnimationLibrary* lib) {
-    FILE* fp = fopen(filename, "r");
-    if (!fp) {
-        output_log("Failed to open %s\n", filename);
-        return;
-    }
-    mxml_node_t* tree = mxmlLoadFile(NULL, fp, MXML_OPAQUE_CALLBACK);
-    fclose(fp);
-    if (!tree) return;
-
-    // Top-level <dict>
-    mxml_node_t* rootDict = mxmlFindElement(tree, tree, "dict", NULL, NULL, MXML_DESCEND_FIRST);
-    if (!rootDict) {
-        output_log("No top-level <dict> found\n");
-        mxmlDelete(tree);
+#include "monster1_plist.h"
+#include "monster2_plist.h"
+#include "monster3_plist.h"
+#include "black_sludge_plist.h"
+
+// Header of an animation in the tables made by tools/plist2anim.py
+typedef struct {
+    char name[32];
+    u32 frameCount;
+    u32 partCount;
+    u32 offset;
+} AnimationTableEntry;
+
+void loadAnimations(const u8* data, u32 size, AnimationLibrary* lib) {
+    if (size < 8 || memcmp(data, "ANIM", 4) != 0) {
+        output_log("Invalid animation table\n");
         return;
     }
 
-    // Find <key>animationContainer</key> inside that dict
-    mxml_node_t* animKey = NULL;
-    for (mxml_node_t* node = mxmlFindElement(rootDict, rootDict, "key", NULL, NULL, MXML_DESCEND_FIRST);
-         node != NULL;
-         node = mxmlFindElement(node, rootDict, "key", NULL, NULL, MXML_NO_DESCEND)) {
-        
-        const char* keyText = mxmlGetOpaque(node);
-        if (keyText && strcmp(keyText, "animationContainer") == 0) {
-            animKey = node;
-            break;
-        }
-    }
-
-    if (!animKey) {
-        output_log("No animationContainer key found\n");
-        mxmlDelete(tree);
+    u32 count = *(const u32 *)(data + 4);
+    if (8 + count * sizeof(AnimationTableEntry) > size) {
+        output_log("Animation table is truncated\n");
         return;
     }
 
-
-    // Get the dict that follows the animationContainer key
-    mxml_node_t* animDict = mxmlGetNextSibling(animKey);
-    while (animDict && mxmlGetType(animDict) != MXML_ELEMENT) {
-        animDict = mxmlGetNextSibling(animDict);
-    }
-
-    if (!animDict || strcmp(mxmlGetElement(animDict), "dict") != 0) {
-        output_log("No dict found after animationContainer key\n");
-        mxmlDelete(tree);
+    lib->animations = calloc(count, sizeof(Animation));
+    if (!lib->animations) {
+        output_log("Couldn't allocate %u animations\n", count);
         return;
     }
 
-    // Loop over all frame <key> elements
-    for (mxml_node_t* frameKey = mxmlFindElement(animDict, animDict, "key", NULL, NULL, MXML_DESCEND);
-         frameKey;
-         frameKey = mxmlFindElement(frameKey, animDict, "key", NULL, NULL, MXML_NO_DESCEND)) {
-
-        const char* frameName = mxmlGetOpaque(frameKey);
-        if (!frameName) continue;
-
-        //output_log("Processing frame: %s\n", frameName);  // Debug print
-
-        char animName[32];
-        extractAnimName(frameName, animName);
-        Animation* anim = getOrCreateAnimation(lib, animName);
-
-        AnimationFrame* frame = &anim->frames[anim->frameCount++];
-        frame->partCount = 0;
-
-        // Get the dict containing sprite data
-        mxml_node_t* frameDict = mxmlGetNextSibling(frameKey);
-        while (frameDict && mxmlGetType(frameDict) != MXML_ELEMENT) {
-            frameDict = mxmlGetNextSibling(frameDict);
-        }
-        
-        if (!frameDict || strcmp(mxmlGetElement(frameDict), "dict") != 0) {
-            output_log("No dict found for frame %s\n", frameName);
+    // The poses are already in SpritePart layout, point straight at them
+    const AnimationTableEntry *entries = (const AnimationTableEntry *)(data + 8);
+    for (u32 i = 0; i < count; i++) {
+        const AnimationTableEntry *entry = &entries[i];
+        if (entry->offset + entry->frameCount * entry->partCount * sizeof(SpritePart) > size) {
+            output_log("Animation %.31s is out of bounds\n", entry->name);
             continue;
         }
 
-        // Process each sprite
-        for (mxml_node_t* spriteKey = mxmlFindElement(frameDict, frameDict, "key", NULL, NULL, MXML_DESCEND_FIRST);
-             spriteKey;
-             spriteKey = mxmlFindElement(spriteKey, frameDict, "key", NULL, NULL, MXML_NO_DESCEND)) {
+        Animation *anim = &lib->animations[lib->animCount++];
+        memcpy(anim->name, entry->name, sizeof(anim->name));
+        anim->name[sizeof(anim->name) - 1] = '\0';
+        anim->frames = (const SpritePart *)(data + entry->offset);
+        anim->frameCount = entry->frameCount;
+        anim->partCount = entry->partCount;
 
-            const char* spriteKeyText = mxmlGetOpaque(spriteKey);
-            if (!spriteKeyText) continue;
-
-            //output_log("  Processing sprite: %s\n", spriteKeyText);  // Debug print
-
-            // Get sprite dict
-            mxml_node_t* spriteDict = mxmlGetNextSibling(spriteKey);
-            while (spriteDict && mxmlGetType(spriteDict) != MXML_ELEMENT) {
-                spriteDict = mxmlGetNextSibling(spriteDict);
-            }
-
-            if (!spriteDict || strcmp(mxmlGetElement(spriteDict), "dict") != 0) continue;
-
-            SpritePart* part = &frame->parts[frame->partCount++];
-            
-            part->x = 0.0f;
-            part->y = 0.0f;
-            part->sx = 1.0f;
-            part->sy = 1.0f;
-            part->rotation = 0.0f;
-            // Process sprite properties
-            for (mxml_node_t* propKey = mxmlFindElement(spriteDict, spriteDict, "key", NULL, NULL, MXML_DESCEND_FIRST);
-                 propKey;
-                 propKey = mxmlFindElement(propKey, spriteDict, "key", NULL, NULL, MXML_NO_DESCEND)) {
-
-                const char* keyText = mxmlGetOpaque(propKey);
-                if (!keyText) continue;
-
-                // Get value node
-                mxml_node_t* valNode = mxmlGetNextSibling(propKey);
-                while (valNode && mxmlGetType(valNode) != MXML_ELEMENT) {
-                    valNode = mxmlGetNextSibling(valNode);
-                }
-                if (!valNode) continue;
-
-                const char* valText = mxmlGetOpaque(valNode);
-                if (!valText) continue;
-
-                //output_log("    Property: %s = %s\n", keyText, valText);  // Debug print
-
-                if (strcmp(keyText, "position") == 0) {
-                    // Skip leading whitespace
-                    while (*valText && isspace(*(unsigned char *) valText)) valText++;
-                    if (sscanf(valText, "{%f,%f}", &part->x, &part->y) != 2) {
-                        // Try with space after comma
-                        if (sscanf(valText, "{%f, %f}", &part->x, &part->y) != 2) {
-                            output_log("Failed to parse position: %s\n", valText);
-                        }
-                    }
-                }
-                else if (strcmp(keyText, "scale") == 0) {
-                    // Skip leading whitespace
-                    while (*valText && isspace(*(unsigned char *) valText)) valText++;
-                    if (sscanf(valText, "{%f,%f}", &part->sx, &part->sy) != 2) {
-                        // Try with space after comma
-                        if (sscanf(valText, "{%f, %f}", &part->sx, &part->sy) != 2) {
-                            output_log("Failed to parse scale: %s\n", valText);
-                        }
-                    }
-                }
-                else if (strcmp(keyText, "rotation") == 0) {
-                    part->rotation = atof(valText);
-                }
-            }
-
-            //output_log("  Loaded sprite: pos(%.2f,%.2f) scale(%.2f,%.2f) rot=%.2f z=%d\n",
-            //       part->x, part->y, part->sx, part->sy, part->rotation, part->z);
-        }
+        bakeAnimation(anim);
     }
-
-    mxmlDelete(tree);
 }
 
-
+void freeAnimationLibrary(AnimationLibrary* lib) {
+    for (int i = 0; i < lib->animCount; i++) {
+        free(lib->animations[i].baked);
+    }
+    free(lib->animations);
+    memset(lib, 0, sizeof(AnimationLibrary));
+}
 
 Animation* getAnimation(AnimationLibrary* lib, const char* name) {
     for (int i = 0; i < lib->animCount; i++) {
@@ -205,7 +78,7 @@ Animation* getAnimation(AnimationLibrary* lib, const char* name) {
 
 #include "math.h"
 
-void lerpSpritePart(SpritePart* out, SpritePart* a, SpritePart* b, float t) {
+void lerpSpritePart(SpritePart* out, const SpritePart* a, const SpritePart* b, float t) {
     out->x = a->x + (b->x - a->x) * t;
     out->y = a->y + (b->y - a->y) * t;
     out->sx = a->sx + (b->sx - a->sx) * t;
@@ -218,7 +91,40 @@ void lerpSpritePart(SpritePart* out, SpritePart* a, SpritePart* b, float t) {
     out->rotation = a->rotation + angleDiff * t;
 }
 
-void playObjAnimation(GameObject *obj, AnimationDefinition definition, float time) 
+void bakeAnimation(Animation* anim) {
+    free(anim->baked);
+    anim->baked = NULL;
+
+    if (anim->frameCount == 0 || anim->partCount == 0) return;
+
+    int partCount = anim->partCount;
+    int ticks = anim->frameCount * ANIMATION_BAKE_SUBFRAMES;
+    anim->baked = malloc(ticks * partCount * sizeof(SpritePart));
+    if (!anim->baked) {
+        output_log("Couldn't bake animation %s\n", anim->name);
+        return;
+    }
+
+    // Sample every subframe once, so drawing is just a lookup
+    for (int tick = 0; tick < ticks; tick++) {
+        int currentFrame = tick / ANIMATION_BAKE_SUBFRAMES;
+        int nextFrame = (currentFrame + 1) % anim->frameCount;
+        float frameLerp = (tick % ANIMATION_BAKE_SUBFRAMES) * (1.f / ANIMATION_BAKE_SUBFRAMES);
+
+        const SpritePart *frame = &anim->frames[currentFrame * partCount];
+        const SpritePart *nextFrameData = &anim->frames[nextFrame * partCount];
+        SpritePart *pose = &anim->baked[tick * partCount];
+        for (int i = 0; i < partCount; i++) {
+            lerpSpritePart(&pose[i], &frame[i], &nextFrameData[i], frameLerp);
+        }
+    }
+}
+
+static inline int getBakedTick(Animation* anim, float time, float fps) {
+    return (int)(time * fps * ANIMATION_BAKE_SUBFRAMES) % (anim->frameCount * ANIMATION_BAKE_SUBFRAMES);
+}
+
+void playObjAnimation(GameObject *obj, ObjRenderState *render, AnimationDefinition definition, float time) 
 {
     Animation *anim = definition.anim;
 
@@ -227,35 +133,23 @@ void playObjAnimation(GameObject *obj, AnimationDefinition definition, float tim
         return;
     }
 
-    float frameTime = time * definition.fps;
-    int currentFrame = (int)frameTime % anim->frameCount;
-    int nextFrame = (currentFrame + 1) % anim->frameCount;
-    
-    // Get fractional part for interpolation
-    float frameLerp = frameTime - (int)frameTime; 
-    
-    AnimationFrame* frame = &anim->frames[currentFrame];
-    AnimationFrame* nextFrameData = &anim->frames[nextFrame];
+    if (!anim->baked) return;
 
-    float rotationRad = DegToRad(-obj->rotation);
-    float cosRot = cosf(rotationRad);
-    float sinRot = sinf(rotationRad);
+    SpritePart *pose = &anim->baked[getBakedTick(anim, time, definition.fps) * anim->partCount];
+
+    // Rotation goes the other way here
+    float cosRot = render->cos_a;
+    float sinRot = -render->sin_a;
 
     int x_flip_mult = (obj->flippedH ? -1 : 1);
     int y_flip_mult = (obj->flippedV ? -1 : 1);
 
-    SpritePart interpolatedPart;
-
     for (int i = 0; i < definition.part_count; i++) {
         AnimationPart part = definition.parts[i];
-        SpritePart* currentPart = &frame->parts[part.part_id];
-        SpritePart* nextPart = &nextFrameData->parts[part.part_id];
-        
-        // Interpolate between current and next frame
-        lerpSpritePart(&interpolatedPart, currentPart, nextPart, frameLerp);
-        
-        float part_x = interpolatedPart.x * x_flip_mult;
-        float part_y = interpolatedPart.y * y_flip_mult;
+        SpritePart *bakedPart = &pose[part.part_id];
+
+        float part_x = bakedPart->x * x_flip_mult;
+        float part_y = bakedPart->y * y_flip_mult;
 
         float rotated_x = (part_x * cosRot - part_y * sinRot) * obj->scale_x;
         float rotated_y = (part_x * sinRot + part_y * cosRot) * obj->scale_y;
@@ -263,7 +157,7 @@ void playObjAnimation(GameObject *obj, AnimationDefinition definition, float tim
         float calc_x = ((*soa_x(obj) + rotated_x - state.camera_x) * SCALE) - widthAdjust;
         float calc_y = screenHeight - ((*soa_y(obj) + rotated_y - state.camera_y) * SCALE);
 
-        float rotation = interpolatedPart.rotation;
+        float rotation = bakedPart->rotation;
         if (obj->flippedH) rotation = -rotation;
         if (obj->flippedV) rotation = -rotation;
         float final_rotation = (rotation + obj->rotation) * state.mirror_mult;
@@ -295,7 +189,8 @@ void playObjAnimation(GameObject *obj, AnimationDefinition definition, float tim
             blending = GRRLIB_BLEND_ALPHA;
         }
 
-        int opacity = get_fade_value(calc_x, screenWidth);
+        // The whole object fades at once
+        int opacity = render->fade_value;
         int unmodified_opacity = opacity;
 
         u32 color = get_layer_color(obj, color_type, col_channel, opacity, part.default_col_channel);
@@ -303,12 +198,10 @@ void playObjAnimation(GameObject *obj, AnimationDefinition definition, float tim
         // If it is invisible because of blending, skip
         if ((blending == GRRLIB_BLEND_ADD && !(color & ~0xff)) || opacity == 0) continue;
 
-        int fade_x = 0;
-        int fade_y = 0;
-
-        float fade_scale = 1.f;
+        int fade_x = render->fade_x;
+        int fade_y = render->fade_y;
 
-        get_fade_vars(obj, calc_x, &fade_x, &fade_y, &fade_scale);
+        float fade_scale = render->fade_scale;
 
         // Handle special fade types
         if (obj->transition_applied == FADE_DOWN_STATIONARY || obj->transition_applied == FADE_UP_STATIONARY) {
@@ -329,8 +222,8 @@ void playObjAnimation(GameObject *obj, AnimationDefinition definition, float tim
                 /* Y        */ calc_y + 6 - (tex->h) / 2 + fade_y,
                 /* Texture  */ tex, 
                 /* Rotation */ final_rotation, 
-                /* Scale X  */ BASE_SCALE * x_flip_mult * interpolatedPart.sx * fade_scale * state.mirror_mult * obj->scale_x, 
-                /* Scale Y  */ BASE_SCALE * y_flip_mult * interpolatedPart.sy * fade_scale * obj->scale_y, 
+                /* Scale X  */ BASE_SCALE * x_flip_mult * bakedPart->sx * fade_scale * state.mirror_mult * obj->scale_x, 
+                /* Scale Y  */ BASE_SCALE * y_flip_mult * bakedPart->sy * fade_scale * obj->scale_y, 
                 /* Color    */ color
             );
         }
@@ -356,36 +249,27 @@ void playRobotAnimation(Player *player,
         robot_4_l2, robot_4_l1,
     };
 
-    // Prev anim
-    float frameTimeFrom = time * 30;
-    int curFrameFrom = (int)frameTimeFrom % fromAnim->frameCount;
-    int nextFrameFrom = (curFrameFrom + 1) % fromAnim->frameCount;
-    float frameLerpFrom = frameTimeFrom - (int)frameTimeFrom;
+    if (!fromAnim->baked || !toAnim->baked) return;
 
-    AnimationFrame* frameFrom = &fromAnim->frames[curFrameFrom];
-    AnimationFrame* nextFrameFromData = &fromAnim->frames[nextFrameFrom];
+    // Prev anim
+    SpritePart *poseFrom = &fromAnim->baked[getBakedTick(fromAnim, time, 30) * fromAnim->partCount];
 
     // This anim
-    float frameTimeTo = time * 30;
-    int curFrameTo = (int)frameTimeTo % toAnim->frameCount;
-    int nextFrameTo = (curFrameTo + 1) % toAnim->frameCount;
-    float frameLerpTo = frameTimeTo - (int)frameTimeTo;
+    int tickTo = getBakedTick(toAnim, time, 30);
+    int curFrameTo = tickTo / ANIMATION_BAKE_SUBFRAMES;
 
     if (curFrameTo == toAnim->frameCount - 2) {
         switch (player->curr_robot_animation_id) {
             case ROBOT_JUMP_START:
                 player->curr_robot_animation_id = ROBOT_JUMP;
-                nextFrameTo = toAnim->frameCount - 1;
                 break;
             case ROBOT_FALL_START:
                 player->curr_robot_animation_id = ROBOT_FALL;
-                nextFrameTo = toAnim->frameCount - 1;
                 break;
         }
     }
 
-    AnimationFrame* frameTo = &toAnim->frames[curFrameTo];
-    AnimationFrame* nextFrameToData = &toAnim->frames[nextFrameTo];
+    SpritePart *poseTo = &toAnim->baked[tickTo * toAnim->partCount];
 
     float rotationRad = DegToRad(-rotation);
     float cosRot = cosf(rotationRad);
@@ -393,19 +277,18 @@ void playRobotAnimation(Player *player,
 
     int upside_down_mult = (player->upside_down ? -1 : 1);
 
-    for (int i = 0; i < frameFrom->partCount; i++) {
-        SpritePart partFromInterp;
-        SpritePart partToInterp;
-        SpritePart finalPart;
+    int partCount = MIN(fromAnim->partCount, toAnim->partCount);
 
-        lerpSpritePart(&partFromInterp, &frameFrom->parts[i], &nextFrameFromData->parts[i], frameLerpFrom);
-        lerpSpritePart(&partToInterp, &frameTo->parts[i], &nextFrameToData->parts[i], frameLerpTo);
+    for (int i = 0; i < partCount; i++) {
+        SpritePart *partFrom = &poseFrom[i];
+        SpritePart *partTo = &poseTo[i];
+        SpritePart finalPart;
 
-        finalPart.x        = lerp(partFromInterp.x,        partToInterp.x,        blendFactor);
-        finalPart.y        = lerp(partFromInterp.y,        partToInterp.y,        blendFactor);
-        finalPart.rotation = lerp(partFromInterp.rotation, partToInterp.rotation, blendFactor);
-        finalPart.sx       = lerp(partFromInterp.sx,       partToInterp.sx,       blendFactor);
-        finalPart.sy       = lerp(partFromInterp.sy,       partToInterp.sy,       blendFactor);
+        finalPart.x        = lerp(partFrom->x,        partTo->x,        blendFactor);
+        finalPart.y        = lerp(partFrom->y,        partTo->y,        blendFactor);
+        finalPart.rotation = lerp(partFrom->rotation, partTo->rotation, blendFactor);
+        finalPart.sx       = lerp(partFrom->sx,       partTo->sx,       blendFactor);
+        finalPart.sy       = lerp(partFrom->sy,       partTo->sy,       blendFactor);
 
         float part_y = finalPart.y * upside_down_mult;
 
@@ -587,7 +470,7 @@ const uint8_t *fire_4_layers[] = {
 };
 
 GRRLIB_texImg *load_png(const u8 *data) {
-    GRRLIB_texImg *tex = GRRLIB_LoadTexturePNG(data);
+    GRRLIB_texImg *tex = load_texture(data);
     GRRLIB_SetHandle(tex, tex->w / 2, tex->h / 2);
     return tex;
 }
@@ -927,9 +810,9 @@ AnimationLibrary monster_2_library;
 AnimationLibrary monster_3_library;
 AnimationLibrary black_sludge_library;
 AnimationDefinition prepare_monster_1_animation() {
-    char monster_plist_path[282];
-    snprintf(monster_plist_path, sizeof(monster_plist_path), "%s/%s/%s", launch_dir, RESOURCES_FOLDER, "monster1.plist");
-    parsePlist(monster_plist_path, &monster_1_library);
+    // Might be loaded again by a later level
+    freeAnimationLibrary(&monster_1_library);
+    loadAnimations(monster1_plist, monster1_plist_size, &monster_1_library);
     
     int part_index = 0;
     
@@ -980,9 +863,9 @@ AnimationDefinition prepare_monster_1_animation() {
 };
 
 AnimationDefinition prepare_monster_2_animation() {
-    char monster_plist_path[282];
-    snprintf(monster_plist_path, sizeof(monster_plist_path), "%s/%s/%s", launch_dir, RESOURCES_FOLDER, "monster2.plist");
-    parsePlist(monster_plist_path, &monster_2_library);
+    // Might be loaded again by a later level
+    freeAnimationLibrary(&monster_2_library);
+    loadAnimations(monster2_plist, monster2_plist_size, &monster_2_library);
     
     int part_index = 0;
     
@@ -1018,9 +901,9 @@ AnimationDefinition prepare_monster_2_animation() {
     return animation;
 };
 AnimationDefinition prepare_monster_3_animation() {
-    char monster_plist_path[282];
-    snprintf(monster_plist_path, sizeof(monster_plist_path), "%s/%s/%s", launch_dir, RESOURCES_FOLDER, "monster3.plist");
-    parsePlist(monster_plist_path, &monster_3_library);
+    // Might be loaded again by a later level
+    freeAnimationLibrary(&monster_3_library);
+    loadAnimations(monster3_plist, monster3_plist_size, &monster_3_library);
     
     int part_index = 0;
     
@@ -1057,9 +940,9 @@ AnimationDefinition prepare_monster_3_animation() {
 };
 
 AnimationDefinition prepare_black_sludge_animation() {
-    char black_sludge_plist_path[285];
-    snprintf(black_sludge_plist_path, sizeof(black_sludge_plist_path), "%s/%s/%s", launch_dir, RESOURCES_FOLDER, "black_sludge.plist");
-    parsePlist(black_sludge_plist_path, &black_sludge_library);
+    // Might be loaded again by a later level
+    freeAnimationLibrary(&black_sludge_library);
+    loadAnimations(black_sludge_plist, black_sludge_plist_size, &black_sludge_library);
     
     int part_index = 0;
     
@@ -1099,11 +982,18 @@ AnimationDefinition prepare_black_sludge_animation() {
 void unload_animation_definition(AnimationDefinition def) {
     for (int i = 0; i < def.part_count; i++) {
         AnimationPart *part = &def.parts[i];
+        if (!part->texture) continue;
 
-        if (part->texture) {
-            GRRLIB_FreeTexture(part->texture);
-            part->texture = NULL;
+        // Parts can share a texture, like the black sludge triangles
+        bool shared = FALSE;
+        for (int j = 0; j < i; j++) {
+            if (def.parts[j].texture == part->texture) {
+                shared = TRUE;
+                break;
+            }
         }
+
+        if (!shared) GRRLIB_FreeTexture(part->texture);
     }
 }
 
@@ -1,5 +1,4 @@
 #pragma once
-#include <mxml.h>
 #include "player.h"
 typedef struct {
     float x, y;
@@ -7,19 +6,21 @@ typedef struct {
     float rotation;
 } SpritePart;
 
-typedef struct {
-    SpritePart parts[8];
-    int partCount;
-} AnimationFrame;
+// Poses sampled between two plist frames when baking
+#define ANIMATION_BAKE_SUBFRAMES 8
 
 typedef struct Animation {
     char name[32];
-    AnimationFrame frames[64];
+    // Poses of every frame, indexed [frame][part], mapped from the animation table
+    const SpritePart *frames;
     int frameCount;
+    int partCount;
+    // Interpolated poses shared by every instance, indexed [tick][part]
+    SpritePart *baked;
 } Animation;
 
 typedef struct {
-    Animation animations[16];
+    Animation *animations;
     int animCount;
 } AnimationLibrary;
 
@@ -80,7 +81,7 @@ void unload_animation_definition(AnimationDefinition def);
 void unload_frame_definition(FramesDefinition def);
 
 void playAnimation(Animation* anim, float time);
-void playObjAnimation(GameObject *obj, AnimationDefinition definition, float time);
+void playObjAnimation(GameObject *obj, ObjRenderState *render, AnimationDefinition definition, float time);
 void playRobotAnimation(Player *player, 
                                Animation* fromAnim, 
                                Animation* toAnim,
@@ -88,6 +89,8 @@ void playRobotAnimation(Player *player,
                                float scale, 
                                float rotation,
                                float blendFactor);
-void parsePlist(const char* filename, AnimationLibrary* lib);
+void loadAnimations(const u8* data, u32 size, AnimationLibrary* lib);
+void bakeAnimation(Animation* anim);
+void freeAnimationLibrary(AnimationLibrary* lib);
 Animation* getAnimation(AnimationLibrary* lib, const char* name);
 GRRLIB_texImg *get_frame(FramesDefinition definition, int layer_num, float time, float *scale_out, bool *flip_x);
\ No newline at end of file
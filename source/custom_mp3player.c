@@ -19,8 +19,10 @@
 #include <ogcsys.h>
 #include <malloc.h>
 #include <unistd.h>
+#include <ogc/lwp_watchdog.h>
 
 #include "math.h"
+#include "game.h"
 
 #include "asndlib.h"
 #include "custom_mp3player.h"
@@ -29,11 +31,24 @@ static s32 have_samples = 0;
 static u32 mp3_volume = 255;
 static volatile float mp3_amplitude = 0.0f;
 static volatile int paused = FALSE;
-static volatile int preloaded = FALSE;
 
-static int frames_to_skip = 0; // ~1153 frames
+// Frames decoded but not played after a seek without an index
+static int frames_to_skip = 0;
 static int skipped = 0;
 
+// Byte the next playback starts at
+static s32 seek_offset = 0;
+// Frames before this byte only prime the decoder. Counted by position, as
+// the first frames after a jump can fail to decode for lack of bit reservoir.
+static s32 seek_target = 0;
+// Byte of the song at InputBuffer[0]
+static s32 input_offset = 0;
+
+// Song time of the first sample played, and bytes sent to the DSP since
+static f32 start_seconds = 0.0f;
+static volatile u32 played_bytes = 0;
+static volatile u64 last_pull_time = 0;
+
 
 #ifndef __SNDLIB_H__
 	#define ADMA_BUFFERSIZE			(4992)
@@ -44,6 +59,32 @@ static int skipped = 0;
 
 #define DATABUFFER_SIZE			(32768)
 
+// Output samples one frame can resample to, 576 samples at 8 kHz to 48 kHz
+#define RESAMPLE_BUFFER_SIZE	(3456)
+
+#define SEEK_INDEX_MAGIC		"MP3I"
+#define SEEK_INDEX_VERSION		1
+// Farthest back a layer III frame takes main data from (main_data_begin)
+#define SEEK_RESERVOIR_BYTES	511
+// Header, CRC and stereo side info, bytes of a frame that aren't main data
+#define SEEK_FRAME_OVERHEAD		38
+// Used when there is no index
+#define DEFAULT_FRAMES_PER_SEC	38.28125f
+// The song is scanned through this window, bigger than any frame plus the next header
+#define SCAN_WINDOW_SIZE		(64*1024)
+#define MAX_FRAME_SIZE			(2884)
+
+// Saved next to the song, followed by the offset of every frame
+typedef struct
+{
+	char magic[4];
+	u32 version;
+	u32 file_size;
+	u32 samplerate;
+	u32 samples_per_frame;
+	u32 frame_count;
+} SeekIndexHeader;
+
 typedef struct _eqstate_s
 {
 	f32 lf;
@@ -102,18 +143,30 @@ mp3filter_t mp3filterfunc = NULL;
 
 static void DataTransferCallback(s32);
 static void Init3BandState(EQState *es,s32 lowfreq,s32 highfreq,s32 mixfreq);
-static s16 Do3Band(EQState *es,s16 sample);
+static void Do3Band(EQState *es,s16 *samples,u32 count);
 static void Resample(struct mad_pcm *Pcm,EQState eqs[2],u32 stereo,u32 src_samplerate);
 
-typedef struct {
-    u8 *frame_start;
-    size_t frame_size;
-    u8 frame_data[DATABUFFER_SIZE];  // enough to hold next frame + padding
-    size_t byte_offset;
-	bool valid;
-} CachedMP3Start;
+// Decoded frame and its resampled output, so the ring is written once per frame
+static s16 FrameSamples[2][1152];
+static u32 ResampleBuffer[RESAMPLE_BUFFER_SIZE];
+
+static SeekIndexHeader seek_index;
+static u32 *seek_offsets = NULL;
+
+static const u16 mp3_bitrates[2][3][15] = {
+	{ // MPEG 1
+		{0,32,64,96,128,160,192,224,256,288,320,352,384,416,448},
+		{0,32,48,56,64,80,96,112,128,160,192,224,256,320,384},
+		{0,32,40,48,56,64,80,96,112,128,160,192,224,256,320},
+	},
+	{ // MPEG 2 and 2.5
+		{0,32,48,56,64,80,96,112,128,144,160,176,192,224,256},
+		{0,8,16,24,32,40,48,56,64,80,96,112,128,144,160},
+		{0,8,16,24,32,40,48,56,64,80,96,112,128,144,160},
+	},
+};
 
-static CachedMP3Start cached_start = {0};
+static const u32 mp3_samplerates[3] = {44100,48000,32000};
 
 struct _rambuffer
 {
@@ -193,23 +246,21 @@ static __inline__ s32 buf_get(struct _outbuffer_s *buf,void *data,s32 len)
 
 static __inline__ s32 buf_put(struct _outbuffer_s *buf,void *data,s32 len)
 {
-	u32 *p;
-	s32 cnt,i;
+	u8 *p;
+	s32 cnt;
 
 	while(len>buf_space(buf))
 		LWP_ThreadSleep(thQueue);
 
 	p = data;
 	cnt = ((u32)buf->bs + DATABUFFER_SIZE - (u32)buf->put);
-	if(len>cnt) {
-		for(i=0;i<(cnt>>2);i++)
-			*buf->put++ = *p++;
-		buf->put = buf->bs;
-		for(i=0;i<((len-cnt)>>2);i++)
-			*buf->put++ = *p++;
+	if(len>=cnt) {
+		memcpy(buf->put,p,cnt);
+		memcpy(buf->bs,p+cnt,len-cnt);
+		buf->put = (u32*)((u8*)buf->bs + (len-cnt));
 	} else {
-		for(i=0;i<(len>>2);i++)
-			*buf->put++ = *p++;
+		memcpy(buf->put,p,len);
+		buf->put = (u32*)((u8*)buf->put + len);
 	}
 
 	if(buf->buf_filled==0 && buf_used(buf)>=(DATABUFFER_SIZE>>1)) {
@@ -267,7 +318,8 @@ s32 MP3Player_PlayBuffer(const void *buffer,s32 len,bool (*filterfunc)(struct ma
 
 	rambuffer.buf_addr = buffer;
 	rambuffer.len = len;
-	rambuffer.pos = 0;
+	rambuffer.pos = MIN(seek_offset,len);
+	skipped = 0;
 
 	mp3cb_data = &rambuffer;
 	mp3read = _mp3ramcopy;
@@ -285,6 +337,7 @@ s32 MP3Player_PlayFile(void *cb_data,s32 (*reader)(void *,void *,s32),bool (*fil
 	mp3cb_data = cb_data;
 	mp3read = reader;
 	mp3filterfunc = filterfunc;
+	skipped = 0;
 	if(LWP_CreateThread(&hStreamPlay,StreamPlay,NULL,StreamPlay_Stack,STACKSIZE,80)<0) {
 		return -1;
 	}
@@ -295,10 +348,12 @@ void MP3Player_Stop(void)
 {
 	skipped = 0;
 	frames_to_skip = 0;
-	memset(&cached_start,0,sizeof(cached_start));
-	preloaded = FALSE;
+	seek_offset = 0;
+	seek_target = 0;
+	start_seconds = 0.0f;
     MP3Player_Unpause();
 	MP3Player_Reset();
+	MP3Player_FreeSeekIndex();
 }
 
 void MP3Player_Reset(void)
@@ -330,6 +385,7 @@ static void *StreamPlay(void *arg)
 	memset(OutputBuffer[2],0,ADMA_BUFFERSIZE);
 
 	buf_init(&OutputRingBuffer);
+	played_bytes = 0;
 	LWP_InitQueue(&thQueue);
 	Init3BandState(&eqs[0],880,5000,48000);
 	Init3BandState(&eqs[1],880,5000,48000);
@@ -338,30 +394,22 @@ static void *StreamPlay(void *arg)
 	AUDIO_RegisterDMACallback(DataTransferCallback);
 #endif
 
-	if (!preloaded)  {
-		mad_stream_init(&Stream);
-		mad_frame_init(&Frame);
-	}
+	mad_stream_init(&Stream);
+	mad_frame_init(&Frame);
 	mad_synth_init(&Synth);
 	mad_timer_reset(&Timer);
 
 	atend = false;
-	MP3Playing = true;
-	bool using_cache = false;
-
-	if (cached_start.valid) {
-		mad_stream_buffer(&Stream, cached_start.frame_data, cached_start.frame_size);
-		using_cache = true;
-	} else {
-		MP3Playing = false;
-	}
+	MP3Playing = false;
+	input_offset = seek_offset;
 
 	while (!atend && thr_running) {
-		if (!paused && (Stream.buffer == NULL || Stream.error == MAD_ERROR_BUFLEN) && !using_cache) {
+		if (!paused && (Stream.buffer == NULL || Stream.error == MAD_ERROR_BUFLEN)) {
 			u8 *ReadStart;
 			s32 ReadSize, Remaining;
 
 			if (Stream.next_frame != NULL) {
+				input_offset += Stream.next_frame - InputBuffer;
 				Remaining = Stream.bufend - Stream.next_frame;
 				memmove(InputBuffer, Stream.next_frame, Remaining);
 				ReadStart = InputBuffer + Remaining;
@@ -384,17 +432,9 @@ static void *StreamPlay(void *arg)
 		}
 		
 		while (!paused && !mad_frame_decode(&Frame, &Stream) && thr_running) {
-			if (mp3filterfunc && mp3filterfunc(&Stream, &Frame)) {
-				if (skipped == frames_to_skip && !cached_start.valid) {
-					cached_start.frame_size = Stream.bufend - Stream.this_frame;
-					memcpy(cached_start.frame_data, Stream.this_frame, cached_start.frame_size);
-					cached_start.valid = true;
-					struct _rambuffer *rb = (struct _rambuffer *)mp3cb_data;
-					s32 remaining_bytes = Stream.bufend - Stream.this_frame;
-					cached_start.byte_offset = rb->pos - remaining_bytes;
-				}
-				continue;
-			}
+			// Frames before the seek target only prime the decoder
+			if (seek_filter(&Stream, &Frame)) continue;
+			if (mp3filterfunc && mp3filterfunc(&Stream, &Frame)) continue;
 
 			if (!paused) {
 				mad_timer_add(&Timer, Frame.header.duration);
@@ -410,14 +450,6 @@ static void *StreamPlay(void *arg)
 			if (Stream.error != MAD_ERROR_BUFLEN)
 				break;
 		}
-
-		// If we were using cache and finished it, resume file reading
-		if (using_cache) {
-			using_cache = false;
-			Stream.buffer = NULL;
-			struct _rambuffer *rb = (struct _rambuffer *)mp3cb_data;
-			rb->pos += cached_start.byte_offset + cached_start.frame_size;
-		}
 	}
 
 	mad_synth_finish(&Synth);
@@ -469,39 +501,68 @@ float update_pulse(float current_amp) {
 
 static void Resample(struct mad_pcm *Pcm,EQState eqs[2],u32 stereo,u32 src_samplerate)
 {
-	u32 val32;
 	dword pos;
-	s32 incr;
+	u32 incr,i,len,count = 0;
+	u64 sum_squares = 0;
+	s16 *left = FrameSamples[0];
+	s16 *right = stereo ? FrameSamples[1] : FrameSamples[0];
+
+	len = MIN(Pcm->length,1152);
+	for(i=0;i<len;i++)
+		left[i] = FixedToShort(Pcm->samples[0][i]);
+	Do3Band(&eqs[0],left,len);
+
+	if(stereo) {
+		for(i=0;i<len;i++)
+			right[i] = FixedToShort(Pcm->samples[1][i]);
+		Do3Band(&eqs[1],right,len);
+	}
 
 	pos.adword = 0;
 	incr = (u32)(((f32)src_samplerate/48000.0F)*65536.0F);
-	u64 sum_squares = 0;
-	u32 sample_count = 0;
 
-	while(pos.aword.hi < Pcm->length) {
-		s16 left = Do3Band(&eqs[0], FixedToShort(Pcm->samples[0][pos.aword.hi]));
-		s16 right = stereo ? Do3Band(&eqs[1], FixedToShort(Pcm->samples[1][pos.aword.hi])) : left;
-
-		// Average stereo to mono
-		s16 mono = (left + right) / 2;
-
-		// Accumulate square of sample
-		sum_squares += mono * mono;
-		sample_count++;
+#ifdef MP3_LINEAR_RESAMPLE
+	// Blend with the sample before, the last one of the previous frame at the start
+	static s16 prev_left = 0,prev_right = 0;
+
+	while(pos.aword.hi<len && count<RESAMPLE_BUFFER_SIZE) {
+		u32 idx = pos.aword.hi;
+		// 15 bits, so a full scale step times it still fits in an s32
+		s32 frac = pos.aword.lo>>1;
+		s32 l0 = idx ? left[idx-1] : prev_left;
+		s32 r0 = idx ? right[idx-1] : prev_right;
+		s16 l = l0 + (((left[idx]-l0)*frac)>>15);
+		s16 r = r0 + (((right[idx]-r0)*frac)>>15);
+		s32 mono = (l + r)/2;
+
+		sum_squares += mono*mono;
+		ResampleBuffer[count++] = ((u16)l<<16) | (u16)r;
+		pos.adword += incr;
+	}
 
-		val32 = ((u16)left << 16) | ((u16)right & 0xFFFF);
-		buf_put(&OutputRingBuffer, &val32, sizeof(u32));
+	if(len>0) {
+		prev_left = left[len-1];
+		prev_right = right[len-1];
+	}
+#else
+	while(pos.aword.hi<len && count<RESAMPLE_BUFFER_SIZE) {
+		s16 l = left[pos.aword.hi];
+		s16 r = right[pos.aword.hi];
+		s32 mono = (l + r)/2;
 
+		sum_squares += mono*mono;
+		ResampleBuffer[count++] = ((u16)l<<16) | (u16)r;
 		pos.adword += incr;
 	}
+#endif
 
-	if (sample_count > 0) {
-		// RMS amplitude normalized to 0.0–1.0 (16-bit audio)
-		float rms = sqrtf((float)sum_squares / sample_count) / 32768.0f;
+	if(count==0) return;
 
-		mp3_amplitude = update_pulse(rms);
-		
-	}
+	buf_put(&OutputRingBuffer,ResampleBuffer,count*sizeof(u32));
+
+	// RMS amplitude normalized to 0.0–1.0 (16-bit audio)
+	float rms = sqrtf((float)sum_squares / count) / 32768.0f;
+	mp3_amplitude = update_pulse(rms);
 }
 
 static void Init3BandState(EQState *es,s32 lowfreq,s32 highfreq,s32 mixfreq)
@@ -516,33 +577,51 @@ static void Init3BandState(EQState *es,s32 lowfreq,s32 highfreq,s32 mixfreq)
 	es->hf = 2.0F*sinf(M_PI*((f32)highfreq/(f32)mixfreq));
 }
 
-static s16 Do3Band(EQState *es,s16 sample)
+static void Do3Band(EQState *es,s16 *samples,u32 count)
 {
-	f32 l,m,h;
+	u32 i;
 
-	es->f1p0 += (es->lf*((f32)sample - es->f1p0))+VSA;
-	es->f1p1 += (es->lf*(es->f1p0 - es->f1p1));
-	es->f1p2 += (es->lf*(es->f1p1 - es->f1p2));
-	es->f1p3 += (es->lf*(es->f1p2 - es->f1p3));
-	l = es->f1p3;
+	// With unity gains the bands add back up to the input
+	if(es->lg==1.0F && es->mg==1.0F && es->hg==1.0F)
+		return;
 
-	es->f2p0 += (es->hf*((f32)sample - es->f2p0))+VSA;
-	es->f2p1 += (es->hf*(es->f2p0 - es->f2p1));
-	es->f2p2 += (es->hf*(es->f2p1 - es->f2p2));
-	es->f2p3 += (es->hf*(es->f2p2 - es->f2p3));
-	h = es->sdm3 - es->f2p3;
+	// Work on a local copy so the state stays in registers
+	EQState eq = *es;
+	for(i=0;i<count;i++) {
+		f32 l,m,h;
+		f32 sample = samples[i];
 
-	m = es->sdm3 - (h+l);
+		eq.f1p0 += (eq.lf*(sample - eq.f1p0))+VSA;
+		eq.f1p1 += (eq.lf*(eq.f1p0 - eq.f1p1));
+		eq.f1p2 += (eq.lf*(eq.f1p1 - eq.f1p2));
+		eq.f1p3 += (eq.lf*(eq.f1p2 - eq.f1p3));
+		l = eq.f1p3;
 
-	l *= es->lg;
-	m *= es->mg;
-	h *= es->hg;
+		eq.f2p0 += (eq.hf*(sample - eq.f2p0))+VSA;
+		eq.f2p1 += (eq.hf*(eq.f2p0 - eq.f2p1));
+		eq.f2p2 += (eq.hf*(eq.f2p1 - eq.f2p2));
+		eq.f2p3 += (eq.hf*(eq.f2p2 - eq.f2p3));
+		h = eq.sdm3 - eq.f2p3;
 
-	es->sdm3 = es->sdm2;
-	es->sdm2 = es->sdm1;
-	es->sdm1 = (f32)sample;
+		m = eq.sdm3 - (h+l);
 
-	return (s16)(l+m+h);
+		eq.sdm3 = eq.sdm2;
+		eq.sdm2 = eq.sdm1;
+		eq.sdm1 = sample;
+
+		samples[i] = (s16)(l*eq.lg + m*eq.mg + h*eq.hg);
+	}
+	*es = eq;
+}
+
+static s32 PullOutput(void *dst)
+{
+	s32 len = buf_get(&OutputRingBuffer,dst,ADMA_BUFFERSIZE);
+	if(len>0) {
+		played_bytes += len;
+		last_pull_time = gettime();
+	}
+	return len;
 }
 
 static void DataTransferCallback(s32 voice)
@@ -551,10 +630,10 @@ static void DataTransferCallback(s32 voice)
 	AUDIO_InitDMA((u32)OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE);
 
 	CurrentBuffer = (CurrentBuffer+1)%3;
-	MP3Playing = (buf_get(&OutputRingBuffer,OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE)>0);
+	MP3Playing = (PullOutput(OutputBuffer[CurrentBuffer])>0);
 #else
 	if(!thr_running) {
-		MP3Playing = (buf_get(&OutputRingBuffer,OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE)>0);
+		MP3Playing = (PullOutput(OutputBuffer[CurrentBuffer])>0);
 		return;
 	}
 
@@ -566,7 +645,7 @@ static void DataTransferCallback(s32 voice)
 	}
 	if(!(SND_TestPointer(mp3_voice,(void*)OutputBuffer[CurrentBuffer]) && SND_StatusVoice(mp3_voice)!=SND_UNUSED)) {
 		if(have_samples==0) {
-			MP3Playing = (buf_get(&OutputRingBuffer,OutputBuffer[CurrentBuffer],ADMA_BUFFERSIZE)>0);
+			MP3Playing = (PullOutput(OutputBuffer[CurrentBuffer])>0);
 			have_samples = 1;
 		}
 	}
@@ -590,11 +669,44 @@ void MP3Player_Unpause() {
 }
 
 void MP3Player_SetSeconds(float seconds) {
-	if (!cached_start.valid) skipped = 0;
-	frames_to_skip = seconds * 38.28125;
+	skipped = 0;
+	start_seconds = seconds;
+	seek_target = 0;
+
+	if (!seek_offsets || seek_index.frame_count == 0) {
+		// No index, decode from the start until the time is reached
+		seek_offset = 0;
+		frames_to_skip = seconds * DEFAULT_FRAMES_PER_SEC;
+		return;
+	}
+
+	// Every frame lasts the same, even on VBR files
+	s32 frame = seconds * seek_index.samplerate / seek_index.samples_per_frame;
+	if (frame >= (s32)seek_index.frame_count) {
+		seek_offset = seek_index.file_size;
+		frames_to_skip = 0;
+		return;
+	}
+	if (frame < 0) frame = 0;
+
+	start_seconds = (f32)frame * seek_index.samples_per_frame / seek_index.samplerate;
+
+	// Decode from far enough back that the target frame's bit reservoir is
+	// filled, low bitrate frames can be much smaller than the reservoir
+	s32 first = frame;
+	s32 main_data = 0;
+	while (first > 0 && main_data < SEEK_RESERVOIR_BYTES) {
+		first--;
+		main_data += (s32)(seek_offsets[first + 1] - seek_offsets[first]) - SEEK_FRAME_OVERHEAD;
+	}
+	seek_offset = seek_offsets[first];
+	seek_target = seek_offsets[frame];
+	frames_to_skip = 0;
 }
 
 bool seek_filter(struct mad_stream *stream, struct mad_frame *frame) {
+    if (input_offset + (stream->this_frame - InputBuffer) < seek_target) return true;
+
     if (skipped < frames_to_skip) {
         skipped++;
         return true;  // Skip this frame
@@ -603,76 +715,202 @@ bool seek_filter(struct mad_stream *stream, struct mad_frame *frame) {
     }
 }
 
-void MP3Player_PreloadOffset(const void *buffer, s32 len, float seconds) {
-	MP3Player_SetSeconds(seconds);
-	if (seconds == 0) return;
-	
-	rambuffer.buf_addr = buffer;
-	rambuffer.len = len;
-	rambuffer.pos = 0;
+// Size of the frame with this header, 0 if it isn't one
+static u32 ParseFrameHeader(const u8 *p,u32 *samplerate,u32 *samples_per_frame)
+{
+	if(p[0]!=0xFF || (p[1]&0xE0)!=0xE0) return 0;
 
-	mp3cb_data = &rambuffer;
-	mp3read = _mp3ramcopy;
+	u32 version = (p[1]>>3)&3;		// 0 = MPEG 2.5, 1 = reserved, 2 = MPEG 2, 3 = MPEG 1
+	u32 layer = (p[1]>>1)&3;		// 1 = III, 2 = II, 3 = I
+	u32 bitrate_index = p[2]>>4;
+	u32 samplerate_index = (p[2]>>2)&3;
+	u32 padding = (p[2]>>1)&1;
 
-	mad_stream_init(&Stream);
-	mad_frame_init(&Frame);
-	
-	u8 *GuardPtr = NULL;
+	// Free format bitrates can't be walked without decoding
+	if(version==1 || layer==0 || bitrate_index==0 || bitrate_index==15 || samplerate_index==3) return 0;
 
-	bool exit = FALSE;
-	bool atend = FALSE;
-	while (!exit && !atend) {
-		if ((Stream.buffer == NULL || Stream.error == MAD_ERROR_BUFLEN)) {
-			u8 *ReadStart;
-			s32 ReadSize, Remaining;
+	u32 lsf = (version!=3);
+	u32 bitrate = mp3_bitrates[lsf][3-layer][bitrate_index]*1000;
+	u32 rate = mp3_samplerates[samplerate_index]>>(version==3 ? 0 : (version==2 ? 1 : 2));
 
-			if (Stream.next_frame != NULL) {
-				Remaining = Stream.bufend - Stream.next_frame;
-				memmove(InputBuffer, Stream.next_frame, Remaining);
-				ReadStart = InputBuffer + Remaining;
-				ReadSize = DATABUFFER_SIZE - Remaining;
-			} else {
-				ReadSize = DATABUFFER_SIZE;
-				ReadStart = InputBuffer;
-				Remaining = 0;
-			}
+	*samplerate = rate;
+	if(layer==3) {
+		*samples_per_frame = 384;
+		return (12*bitrate/rate + padding)*4;
+	}
+	if(layer==2 || !lsf) {
+		*samples_per_frame = 1152;
+		return 144*bitrate/rate + padding;
+	}
+	*samples_per_frame = 576;
+	return 72*bitrate/rate + padding;
+}
 
-			ReadSize = mp3read(mp3cb_data, ReadStart, ReadSize);
-			if (ReadSize <= 0) {
-				GuardPtr = ReadStart;
-				memset(GuardPtr, 0, MAD_BUFFER_GUARD);
-				ReadSize = MAD_BUFFER_GUARD;
-				atend = true;
+static bool ScanFrames(FILE *fp,u32 len)
+{
+	u32 pos = 0;
+	u32 capacity = 0;
+	u32 window_start = 0,window_len = 0;
+	bool ok = true;
+	u8 *window = malloc(SCAN_WINDOW_SIZE);
+	if(!window) return false;
+
+	memset(&seek_index,0,sizeof(seek_index));
+	memcpy(seek_index.magic,SEEK_INDEX_MAGIC,4);
+	seek_index.version = SEEK_INDEX_VERSION;
+	seek_index.file_size = len;
+
+	// Skip the ID3v2 tag
+	window_len = fread(window,1,SCAN_WINDOW_SIZE,fp);
+	if(window_len>=10 && memcmp(window,"ID3",3)==0) {
+		pos = 10 + (((window[6]&0x7F)<<21) | ((window[7]&0x7F)<<14) | ((window[8]&0x7F)<<7) | (window[9]&0x7F));
+		if(window[5]&0x10) pos += 10;
+	}
+
+	while(pos+4<=len) {
+		u32 rate,samples,next_rate,next_samples;
+
+		// Keep the whole frame and the header after it in the window
+		if(pos<window_start || (pos+MAX_FRAME_SIZE+4>window_start+window_len && window_start+window_len<len)) {
+			fseek(fp,pos,SEEK_SET);
+			window_start = pos;
+			window_len = fread(window,1,SCAN_WINDOW_SIZE,fp);
+			if(window_len<4) {
+				ok = false;
+				break;
 			}
+		}
 
-			mad_stream_buffer(&Stream, InputBuffer, ReadSize + Remaining);
+		const u8 *data = window+(pos-window_start);
+		u32 size = ParseFrameHeader(data,&rate,&samples);
+
+		// The next header has to agree too, or this was a false sync
+		if(size==0 || pos+size>len ||
+		   (pos+size+4<=len && ParseFrameHeader(data+size,&next_rate,&next_samples)==0) ||
+		   (seek_index.frame_count>0 && rate!=seek_index.samplerate)) {
+			pos++;
+			continue;
 		}
-		
-		while (!mad_frame_decode(&Frame, &Stream)) {
-			if (seek_filter(&Stream, &Frame)) {
-				if (skipped == frames_to_skip && !cached_start.valid) {
-					cached_start.frame_size = Stream.bufend - Stream.this_frame;
-					memcpy(cached_start.frame_data, Stream.this_frame, cached_start.frame_size);
-					cached_start.valid = true;
-					struct _rambuffer *rb = (struct _rambuffer *)mp3cb_data;
-					s32 remaining_bytes = Stream.bufend - Stream.this_frame;
-					cached_start.byte_offset = rb->pos - remaining_bytes;
-					exit = TRUE;
-					break;
-				}
-				continue;
+
+		if(seek_index.frame_count==capacity) {
+			capacity = capacity ? capacity*2 : 4096;
+			u32 *offsets = realloc(seek_offsets,capacity*sizeof(u32));
+			if(!offsets) {
+				ok = false;
+				break;
 			}
+			seek_offsets = offsets;
 		}
+
+		seek_index.samplerate = rate;
+		seek_index.samples_per_frame = samples;
+		seek_offsets[seek_index.frame_count++] = pos;
+		pos += size;
 	}
-	preloaded = TRUE;
+
+	free(window);
+	return ok && seek_index.frame_count>0;
 }
 
+static bool ReadSeekIndex(const char *path,u32 file_size)
+{
+	FILE *fp = fopen(path,"rb");
+	if(!fp) return false;
+
+	bool ok = (fread(&seek_index,sizeof(seek_index),1,fp)==1 &&
+			   memcmp(seek_index.magic,SEEK_INDEX_MAGIC,4)==0 &&
+			   seek_index.version==SEEK_INDEX_VERSION &&
+			   seek_index.file_size==file_size &&
+			   seek_index.frame_count>0 && seek_index.samples_per_frame>0);
+
+	if(ok) {
+		seek_offsets = malloc(seek_index.frame_count*sizeof(u32));
+		ok = seek_offsets && fread(seek_offsets,sizeof(u32),seek_index.frame_count,fp)==seek_index.frame_count;
+	}
+	fclose(fp);
+
+	if(!ok) MP3Player_FreeSeekIndex();
+	return ok;
+}
+
+static void WriteSeekIndex(const char *path)
+{
+	FILE *fp = fopen(path,"wb");
+	if(!fp) {
+		output_log("Couldn't save the seek index %s\n",path);
+		return;
+	}
+	fwrite(&seek_index,sizeof(seek_index),1,fp);
+	fwrite(seek_offsets,sizeof(u32),seek_index.frame_count,fp);
+	fclose(fp);
+}
+
+bool MP3Player_LoadSeekIndex(const char *song_path)
+{
+	char index_path[278];
+	snprintf(index_path,sizeof(index_path),"%s.idx",song_path);
+
+	MP3Player_FreeSeekIndex();
+
+	FILE *fp = fopen(song_path,"rb");
+	if(!fp) return false;
+	fseek(fp,0,SEEK_END);
+	u32 len = ftell(fp);
+	rewind(fp);
+
+	if(ReadSeekIndex(index_path,len)) {
+		fclose(fp);
+		return true;
+	}
+
+	bool scanned = ScanFrames(fp,len);
+	fclose(fp);
+
+	if(!scanned) {
+		output_log("Couldn't index the frames of %s\n",song_path);
+		MP3Player_FreeSeekIndex();
+		return false;
+	}
+
+	output_log("Indexed %u frames of %s\n",seek_index.frame_count,song_path);
+	WriteSeekIndex(index_path);
+	return true;
+}
+
+s32 MP3Player_GetSeekOffset(void)
+{
+	return seek_offset;
+}
+
+void MP3Player_FreeSeekIndex(void)
+{
+	free(seek_offsets);
+	seek_offsets = NULL;
+	memset(&seek_index,0,sizeof(seek_index));
+}
 
 float MP3Player_GetAmplitude(void)
 {
 	return mp3_amplitude;
 }
 
+// Song time of what is being heard, a DMA buffer behind what was pulled from the ring
+float MP3Player_GetPosition(void)
+{
+	u64 pull_time = last_pull_time;
+	s32 samples = ((s32)played_bytes - ADMA_BUFFERSIZE)/4;
+	if(samples<=0) return start_seconds;
+
+	f32 position = start_seconds + (f32)samples/48000.0F;
+
+	// Buffers are pulled every ~43 ms, move along with the clock in between
+	if(MP3Playing && !paused) {
+		f32 since_pull = ticks_to_microsecs(gettime() - pull_time)/1000000.0F;
+		position += MIN(since_pull,(f32)(ADMA_BUFFERSIZE/4)/48000.0F);
+	}
+	return position;
+}
+
 void MP3Player_Volume(u32 volume)
 {
 	if(volume>255) volume = 255;
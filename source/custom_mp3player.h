@@ -13,11 +13,15 @@ void MP3Player_Stop(void);
 void MP3Player_Reset(void);
 bool MP3Player_IsPlaying(void);
 void MP3Player_Volume(u32 volume);
+void MP3Player_SetVoice(int voice);
 s32 MP3Player_PlayBuffer(const void *buffer,s32 len,bool (*filterfunc)(struct mad_stream *,struct mad_frame *));
 s32 MP3Player_PlayFile(void *cb_data,s32 (*reader)(void *,void *,s32),bool (*filterfunc)(struct mad_stream *,struct mad_frame *));
 float MP3Player_GetAmplitude(void);
+float MP3Player_GetPosition(void);
 void MP3Player_SetSeconds(float seconds);
-void MP3Player_PreloadOffset(const void *buffer, s32 len, float seconds);
+bool MP3Player_LoadSeekIndex(const char *song_path);
+s32 MP3Player_GetSeekOffset(void);
+void MP3Player_FreeSeekIndex(void);
 void MP3Player_Pause();
 void MP3Player_Unpause();
 bool seek_filter(struct mad_stream *stream, struct mad_frame *frame);
@@ -5,6 +5,7 @@
 
 #include "filesystem.h"
 #include "game.h"
+#include "main.h"
 
 char *read_file(const char *filepath, size_t *out_size) {
     FILE *f = fopen(filepath, "rb");
@@ -28,4 +29,42 @@ char *read_file(const char *filepath, size_t *out_size) {
 
     if (out_size) *out_size = size;
     return buffer;
-}
\ No newline at end of file
+}
+
+// Same as read_file(), but the caller can follow or cancel the read between chunks
+char *read_file_chunked(const char *filepath, size_t chunk_size, ReadChunkCallback callback, size_t *out_size) {
+    FILE *f = fopen(filepath, "rb");
+    if (!f) {
+        output_log("Failed to open file: %s\n", filepath);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    size_t size = ftell(f);
+    rewind(f);
+
+    char *buffer = malloc(size + 1);
+    if (!buffer) {
+        output_log("Failed to allocate file\n");
+        fclose(f);
+        return NULL;
+    }
+
+    size_t read = 0;
+    while (read < size) {
+        if (callback && !callback(read, size)) break;
+
+        size_t chunk = fread(buffer + read, 1, MIN(chunk_size, size - read), f);
+        if (chunk == 0) break;
+        read += chunk;
+    }
+    fclose(f);
+
+    if (read < size) {
+        free(buffer);
+        return NULL;
+    }
+
+    buffer[size] = '\0';
+    if (out_size) *out_size = size;
+    return buffer;
+}
@@ -1,3 +1,9 @@
 #pragma once
+#include <gctypes.h>
+#include <stddef.h>
 
-char *read_file(const char *filepath, size_t *out_size);
\ No newline at end of file
+// Called after every chunk, returning FALSE gives up the read
+typedef bool (*ReadChunkCallback)(size_t read, size_t size);
+
+char *read_file(const char *filepath, size_t *out_size);
+char *read_file_chunked(const char *filepath, size_t chunk_size, ReadChunkCallback callback, size_t *out_size);
@@ -1,3 +1,4 @@
+#pragma once
 // values taken from bigFont-hd.fnt
 struct glyph {
     int id, x, y, width, height, xoffset, yoffset, xadvance;
@@ -5,6 +6,8 @@ struct glyph {
 
 struct charset {
     struct glyph *chars;
+    // Position in chars + 1 of every character, 0 if the font lacks it
+    const unsigned char *index;
     int char_num;
 };
 
@@ -7,8 +7,7 @@
 #include "level.h"
 #include "math.h"
 
-#include "oggplayer.h"
-#include "endStart_02_ogg.h"
+#include "sfx.h"
 #include "trail.h"
 
 #include "stdio.h"
@@ -18,6 +17,10 @@
 #include <unistd.h>
 #include <math.h>
 #include "triggers.h"
+#include "profiler.h"
+#include "telemetry.h"
+#include "song_stream.h"
+#include "song_analysis.h"
 
 int paused_loop();
 int handle_wall_cutscene();
@@ -32,10 +35,17 @@ float death_timer = 0.0f;
 float completion_timer = 0.0f;
 bool completion_shake = FALSE;
 
-char *current_song_pointer = NULL;
+bool song_loaded = FALSE;
 
 int frame_skipped = 0;
 
+// Physics time run this attempt, and the song time it started at
+double sim_time = 0.0;
+float audio_clock_start = 0.f;
+
+// Song time of the physics step being run, read from the player once per frame
+float song_position = 0.f;
+
 int paused_loop() {
     MP3Player_Pause();
     while (1) {
@@ -47,7 +57,7 @@ int paused_loop() {
             MP3Player_Stop();
             MP3Player_Volume(0);
             gameRoutine = ROUTINE_MENU;
-            if (current_song_pointer) free(current_song_pointer);
+            release_level_song();
             state.paused = FALSE;
             return TRUE;
         }
@@ -71,18 +81,34 @@ int paused_loop() {
 }
 
 
-int game_loop() {
-    size_t size;
-    if (level_info.custom_song_id >= 0) {
-        current_song_pointer = load_user_song(level_info.custom_song_id, &size);
-    } else {
-        current_song_pointer = load_song(songs[level_info.song_id].song_name, &size);
-    }
+// Called by load_level() once the level info is known, the stream thread
+// then reads the start of the song while the objects are being parsed
+void prepare_level_song() {
+    char song_path[273];
+    get_level_song_path(song_path, sizeof(song_path));
 
-    if (current_song_pointer) {
-        MP3Player_PreloadOffset(current_song_pointer, size, level_info.song_offset);
+    // Respawns seek through the index instead of decoding up to the offset
+    MP3Player_LoadSeekIndex(song_path);
+    song_loaded = open_song_stream(song_path);
+    load_song_envelope(song_path);
+
+    if (song_loaded) {
+        MP3Player_SetSeconds(level_info.song_offset);
+        song_stream_seek(MP3Player_GetSeekOffset());
     }
-    
+}
+
+void release_level_song() {
+    close_song_stream();
+    free_song_envelope();
+    song_loaded = FALSE;
+
+    // Otherwise the menu music would start at this song's offset
+    MP3Player_FreeSeekIndex();
+    MP3Player_SetSeconds(0);
+}
+
+int game_loop() {
     set_camera_x(15 - CAMERA_X_OFFSET);
     draw_game();
     fade_in_level();
@@ -90,37 +116,64 @@ int game_loop() {
     // Wait 0.5 seconds before starting first attempt
     wait_initial_time();
     
-    if (current_song_pointer) {
-        MP3Player_PlayBuffer(current_song_pointer, size, NULL);
+    if (song_loaded) {
+        MP3Player_PlayFile(NULL, song_stream_read, NULL);
     }
+    sim_time = 0.0;
+    audio_clock_start = MP3Player_GetPosition();
     
     init_move_triggers();
 
+    reset_frame_telemetry();
+
     double accumulator = 0.0f;
     u64 prevTicks = gettime();
     while (1) {
+        PROFILE_SCOPE("frame");
         start_frame = gettime();
         float frameTime = ticks_to_secs_float(start_frame - prevTicks);
         dt = frameTime;
 
-        if (frameTime > 1) frameTime = 1; // Avoid spiral of death
         if (fixed_dt) {
             frameTime = STEPS_DT_UNMOD;
             fixed_dt = FALSE;
         }
         prevTicks = start_frame;
+
+        song_position = MP3Player_GetPosition();
+
+        // How far the physics are from the song being heard
+        audio_drift_ms = 0.f;
+        if (song_loaded && MP3Player_IsPlaying()) {
+            double drift = (song_position - audio_clock_start) - (sim_time + accumulator + frameTime);
+            audio_drift_ms = drift * 1000.0;
+#ifdef AUDIO_CLOCK_TIMING
+            if (fabs(drift) > AUDIO_CLOCK_RESYNC) {
+                frameTime = MAX(frameTime + drift, 0.0);
+                audio_resyncs++;
+            } else {
+                frameTime += drift * AUDIO_CLOCK_GAIN;
+            }
+#endif
+        }
+
+        // After the drift correction, so catching up to the song can't exceed it either
+        if (frameTime > 1) frameTime = 1; // Avoid spiral of death
         
         accumulator += frameTime;
 
         update_input();
         
+        physics_steps = 0;
         u64 t0 = gettime();
         while (accumulator >= STEPS_DT_UNMOD) {
+            PROFILE_SCOPE("physics_step");
             // Always have valid input
             u64 start_physics = gettime();
             state.old_player = state.player;
             if (level_info.custom_song_id >= 0) {
-                amplitude = CLAMP(MP3Player_GetAmplitude(), 0.1f, 1.f);
+                float pulse = song_envelope_ready() ? get_song_envelope(song_position) : MP3Player_GetAmplitude();
+                amplitude = CLAMP(pulse, 0.1f, 1.f);
             } else {
                 amplitude = (beat_pulse ? 1.f : 0.1f);
             }
@@ -153,7 +206,9 @@ int game_loop() {
             }
                 
             u64 t2 = gettime();
+            PROFILE_BEGIN("handle_objects");
             handle_objects();
+            PROFILE_END();
             u64 t3 = gettime();
             triggers_time = ticks_to_microsecs(t3 - t2) / 1000.f * 4;
 
@@ -161,6 +216,7 @@ int game_loop() {
             
             update_percentage();
             frame_counter++;
+            physics_steps++;
 
             u64 end_physics = gettime();
 
@@ -172,12 +228,16 @@ int game_loop() {
             else frame_skipped = 0;
             
             accumulator -= STEPS_DT;
+            sim_time += STEPS_DT;
+            song_position += STEPS_DT;
             
             if (state.dead) break;
         }
         
         u64 t2 = gettime();
+        PROFILE_BEGIN("update_particles");
         update_particles();
+        PROFILE_END();
         u64 t3 = gettime();
         particles_time = ticks_to_microsecs(t3 - t2) / 1000.f;
 
@@ -194,6 +254,15 @@ int game_loop() {
             enable_info ^= 1;
         }
 
+        // With the info shown, up and down change the particle budget
+        if (enable_info && (state.input.pressedDir & INPUT_UP)) {
+            set_particle_capacity(particle_capacity * 2);
+        }
+
+        if (enable_info && (state.input.pressedDir & INPUT_DOWN)) {
+            set_particle_capacity(particle_capacity / 2);
+        }
+
         if (state.input.pressedPlusOrL) {
             state.paused ^= 1;
         }
@@ -210,12 +279,15 @@ int game_loop() {
             if (death_timer <= 0.f) {
                 init_variables();
                 reload_level(); 
-                if (current_song_pointer) {
+                if (song_loaded) {
                     MP3Player_Reset();
                     MP3Player_SetSeconds(level_info.song_offset);
-                    MP3Player_PlayBuffer(current_song_pointer, size, NULL);
+                    song_stream_seek(MP3Player_GetSeekOffset());
+                    MP3Player_PlayFile(NULL, song_stream_read, NULL);
                     MP3Player_Volume(255);
                 }
+                sim_time = 0.0;
+                audio_clock_start = MP3Player_GetPosition();
                 update_input();
                 fixed_dt = TRUE; 
             }
@@ -231,6 +303,7 @@ int game_loop() {
         }
 
         draw_game();
+        record_frame_telemetry();
         GRRLIB_Render();
     }
     fade_out();
@@ -241,6 +314,8 @@ int game_loop() {
 #ifdef REPORT_LEAKS
     report_leaks();
 #endif
+    PROFILE_DUMP();
+    write_frame_telemetry();
     return FALSE;
 }
 
@@ -396,7 +471,7 @@ int handle_wall_cutscene() {
         spawn_particle(END_WALL_COLL_CIRCLE, level_info.wall_x, level_info.wall_y, NULL);
         spawn_particle(END_WALL_COLL_CIRCUNFERENCE, level_info.wall_x, level_info.wall_y, NULL);
         circunferences_spawned++;
-        PlayOgg(endStart_02_ogg, endStart_02_ogg_size, 0, OGG_ONE_TIME);
+        play_sfx(SFX_END_START);
     } else if (completion_timer <= 0.2 && circunferences_spawned < 5) {
         spawn_particle(END_WALL_COLL_CIRCUNFERENCE, level_info.wall_x, level_info.wall_y, NULL);
         circunferences_spawned++;
@@ -484,7 +559,7 @@ int handle_wall_cutscene() {
         completion_timer = 0.0f;
         MP3Player_Stop();
         complete_text_elapsed = 0.f;
-        if (current_song_pointer) free(current_song_pointer);
+        release_level_song();
         gameRoutine = ROUTINE_MENU;
         erase_rays();
         draw_game();
@@ -13,6 +13,13 @@
 #define INPUT_BUFFER_SIZE 8
 #define INPUT_BUFFER_MASK (INPUT_BUFFER_SIZE-1)
 
+// Follow the song being heard instead of the wall clock for the physics
+//#define AUDIO_CLOCK_TIMING
+// Share of the drift to the song corrected every frame
+#define AUDIO_CLOCK_GAIN 0.1f
+// Drift in seconds past which the physics jump to the song instead
+#define AUDIO_CLOCK_RESYNC 0.05f
+
 #define ticks_to_secs_float(ticks) (((float)(ticks)/(float)(TB_TIMER_CLOCK*1000)))
 
 extern bool enable_info;
@@ -24,6 +31,7 @@ extern float completion_timer;
 extern bool completion_shake;
 
 extern u64 start_frame;
+extern float song_position;
 
 #define MAX_RAYS 8
 
@@ -39,6 +47,8 @@ typedef struct {
 } Ray;
 
 int game_loop();
+void prepare_level_song();
+void release_level_song();
 
 void draw_rays();
 void create_ray(float x, float y, float angle, float length, float startWidth, float endWidth, float duration, u32 color);
@@ -46,4 +56,4 @@ void erase_rays();
 
 extern int frame_skipped;
 
-int output_log(const char *fmt, ...);
\ No newline at end of file
+#include "logger.h"
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <ogc/lwp.h>
+
+#include "level_loader.h"
+#include "level_loading.h"
+#include "main.h"
+#include "game.h"
+#include "filesystem.h"
+#include "menu.h"
+
+// Share of the whole load each stage takes, most of it is parsing
+static const float stage_weights[LOAD_STAGE_COUNT] = {
+    [LOAD_STAGE_READ]       = 0.10f,
+    [LOAD_STAGE_DECOMPRESS] = 0.10f,
+    [LOAD_STAGE_PARSE]      = 0.50f,
+    [LOAD_STAGE_LAYERS]     = 0.10f,
+    [LOAD_STAGE_GROUPS]     = 0.10f,
+    [LOAD_STAGE_TEXTURES]   = 0.10f,
+};
+
+static u8 loader_stack[LEVEL_LOADER_STACK_SIZE] ATTRIBUTE_ALIGN(8);
+static lwp_t loader_thread = LWP_THREAD_NULL;
+
+static char *loader_data = NULL;
+static char loader_path[MAX_PATH_LEN];
+static bool loader_owns_data = FALSE;
+static bool loader_is_custom = FALSE;
+static volatile bool loader_done = FALSE;
+static volatile int loader_code = 0;
+
+static volatile float load_progress = 0.f;
+
+static void update_load_progress(int stage, float progress) {
+    float total = 0.f;
+    for (int i = 0; i < stage; i++) total += stage_weights[i];
+    total += stage_weights[stage] * CLAMP(progress, 0.f, 1.f);
+
+    // Stages can be skipped, like with empty levels, but never go back
+    if (total > load_progress) load_progress = total;
+}
+
+static bool report_read_progress(size_t read, size_t size) {
+    update_load_progress(LOAD_STAGE_READ, (float) read / size);
+    return TRUE;
+}
+
+static void *level_loader_thread(void *arg) {
+    if (!loader_data) {
+        loader_data = read_file_chunked(loader_path, LEVEL_LOADER_CHUNK_SIZE, report_read_progress, NULL);
+        if (!loader_data) {
+            output_log_level(LOG_ERROR, "Couldn't read the level %s\n", loader_path);
+            loader_code = 1;
+            loader_done = TRUE;
+            return NULL;
+        }
+    }
+
+    loader_code = load_level(loader_data, loader_is_custom);
+    loader_done = TRUE;
+    return NULL;
+}
+
+static void run_level_loader() {
+    loader_done = FALSE;
+    loader_code = 0;
+    load_progress = 0.f;
+
+    set_level_load_callback(update_load_progress);
+
+    if (LWP_CreateThread(&loader_thread, level_loader_thread, NULL, loader_stack, LEVEL_LOADER_STACK_SIZE, LEVEL_LOADER_PRIORITY) < 0) {
+        output_log("Couldn't start the level loader thread, loading on the main thread\n");
+        loader_thread = LWP_THREAD_NULL;
+        level_loader_thread(NULL);
+    }
+}
+
+void start_level_loader(char *data, bool is_custom) {
+    loader_data = data;
+    loader_owns_data = FALSE;
+    loader_is_custom = is_custom;
+    run_level_loader();
+}
+
+// Reads the level on the loader thread too, unless the menu read it ahead.
+// The level data is freed by finish_level_loader().
+void start_level_file_loader(const char *path, char *prefetched) {
+    snprintf(loader_path, sizeof(loader_path), "%s", path);
+    loader_data = prefetched;
+    loader_owns_data = TRUE;
+    loader_is_custom = TRUE;
+    run_level_loader();
+}
+
+bool level_loader_done() {
+    return loader_done;
+}
+
+float get_level_load_progress() {
+    return load_progress;
+}
+
+// Waits for the loader thread and uploads the textures if the level loaded
+int finish_level_loader() {
+    if (loader_thread != LWP_THREAD_NULL) {
+        LWP_JoinThread(loader_thread, NULL);
+        loader_thread = LWP_THREAD_NULL;
+    }
+
+    if (loader_code == 0) {
+        finish_level_loading();
+    } else {
+        // It might have been opened before the level failed to parse
+        release_level_song();
+    }
+
+    if (loader_owns_data) free(loader_data);
+    loader_data = NULL;
+
+    set_level_load_callback(NULL);
+    return loader_code;
+}
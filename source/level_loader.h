@@ -0,0 +1,18 @@
+#pragma once
+#include <gctypes.h>
+
+// Runs load_level() on its own thread so the menu can keep drawing while a
+// level is read, decompressed and parsed. The textures are uploaded afterwards on
+// the main thread by finish_level_loader().
+#define LEVEL_LOADER_STACK_SIZE (64 * 1024)
+// Below the main thread, so it only runs while it waits for the retrace
+#define LEVEL_LOADER_PRIORITY 40
+// Between progress updates while reading a level from the SD card
+#define LEVEL_LOADER_CHUNK_SIZE (64 * 1024)
+
+void start_level_loader(char *data, bool is_custom);
+void start_level_file_loader(const char *path, char *prefetched);
+bool level_loader_done();
+// Of the whole load, from 0 to 1
+float get_level_load_progress();
+int finish_level_loader();
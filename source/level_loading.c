@@ -20,6 +20,7 @@
 
 #include "groups.h"
 #include "triggers.h"
+#include "rng.h"
 
 #include "bg_01_png.h"
 #include "bg_02_png.h"
@@ -978,11 +979,11 @@ GameObject *convert_to_game_object(const GDObject *obj, int i) {
     object->opacity = 1.f;
 
     if (is_object_unimplemented(*soa_id(object))) {
-        output_log("Found unimplemented object with id %d\n", *soa_id(object));
+        output_log_level(LOG_DEBUG, "Found unimplemented object with id %d\n", *soa_id(object));
     }
 
     // Get a random value for this object
-    object->random = rand();
+    object->random = random_u32(RNG_GAMEPLAY) & 0x7FFFFFFF;
 
     for (int i = 0; i < obj->propCount; i++) {
         int key = obj->keys[i];
@@ -1260,8 +1261,26 @@ GameObject *convert_to_game_object(const GDObject *obj, int i) {
 void free_game_object(GameObject *obj) {
     if (!obj) return;
     if (obj->object.text) free(obj->object.text);
+    free_text_layout(obj->object.text_layout);
     free(obj);
 }
+void layout_text_object(GameObject *obj) {
+    if (*soa_id(obj) != TEXT_OBJ || obj->object.text_layout) return;
+
+    // The text never changes, so lay it out only once
+    obj->object.text_layout = create_text_layout(font_charsets[level_info.font_used], obj->object.text);
+}
+
+static LevelLoadCallback load_callback = NULL;
+
+void set_level_load_callback(LevelLoadCallback callback) {
+    load_callback = callback;
+}
+
+static void report_load_progress(int stage, float progress) {
+    if (load_callback) load_callback(stage, progress);
+}
+
 GDGameObjectList *parse_string(const char *levelString) {
     int sectionCount = 0;
 
@@ -1276,7 +1295,7 @@ GDGameObjectList *parse_string(const char *levelString) {
     
 
     int objectCount = sectionCount - 1;
-    output_log("%d\n", objectCount);
+    output_log("%d objects\n", objectCount);
 
     GameObject **objectArray = malloc(sizeof(GameObject *) * objectCount);
     if (!objectArray) {
@@ -1312,6 +1331,8 @@ GDGameObjectList *parse_string(const char *levelString) {
         }
 
         free(object);
+
+        if ((i & (LEVEL_LOAD_REPORT_STEP - 1)) == 0) report_load_progress(LOAD_STAGE_PARSE, (float) i / objectCount);
     }
     
     free_string_array(sections, sectionCount);
@@ -1319,7 +1340,9 @@ GDGameObjectList *parse_string(const char *levelString) {
     // Do this separated
     for (int i = 0; i < objectCount; i++) {
         GameObject *obj = objectArray[i];
-        load_obj_textures(*soa_id(obj));
+        register_obj_textures(*soa_id(obj), *soa_x(obj));
+        layout_text_object(obj);
+        compute_cull_radius(obj);
         register_object(obj);
         assign_object_to_section(obj);
     }
@@ -1352,6 +1375,8 @@ void free_game_object_list(GDGameObjectList *list) {
     if (!list) return;
     if (list->objects) {
         for (int i = 0; i < list->count; i++) {
+            // Every object in the list went through register_obj_textures()
+            if (list->objects[i]) release_obj_animation(*soa_id(list->objects[i]));
             free_game_object(list->objects[i]);
         }
         free(list->objects);
@@ -1808,7 +1833,9 @@ GameObject* add_object(int object_id, float x, float y, float rotation) {
     // Add to sections
     assign_object_to_section(obj);
 
-    load_obj_textures(*soa_id(obj));
+    register_obj_textures(*soa_id(obj), x);
+    layout_text_object(obj);
+    compute_cull_radius(obj);
     origPositionsList[objectsArrayList->count - 1].x = x;
     origPositionsList[objectsArrayList->count - 1].y = y;
     return obj;
@@ -1923,14 +1950,17 @@ void load_level_info(char *data, char *level_string) {
     }
 }
 
+// Everything that doesn't touch GX, so it can run on the level loader thread.
+// finish_level_loading() has to be called on the main thread after it.
 int load_level(char *data, bool is_custom) {
     level_info.level_is_custom = is_custom;
 
     printf("Free MEM1: %d Free MEM2: %d\n", SYS_GetArena1Hi() - SYS_GetArena1Lo(), SYS_GetArena2Hi() - SYS_GetArena2Lo());
+    report_load_progress(LOAD_STAGE_DECOMPRESS, 0.f);
     char *level_string = decompress_level(data);
 
     if (level_string == NULL) {
-        output_log("Failed decompressing the level.\n");
+        output_log_level(LOG_ERROR, "Failed decompressing the level.\n");
         return 1;
     }
 
@@ -1950,18 +1980,26 @@ int load_level(char *data, bool is_custom) {
         
         load_level_info(data, level_string);
 
+        // The song is read in the background while the objects are parsed
+        prepare_level_song();
+
+        // Same level, same random values
+        seed_level_random(hash_level_seed(data));
+
+        report_load_progress(LOAD_STAGE_PARSE, 0.f);
         objectsArrayList = parse_string(level_string);
 
         free(level_string);
 
         if (objectsArrayList == NULL) {
-            output_log("Failed parsing the objects.\n");
+            output_log_level(LOG_ERROR, "Failed parsing the objects.\n");
             return 2;
         }
         
 
         create_extra_objects();
 
+        report_load_progress(LOAD_STAGE_LAYERS, 0.f);
         layersArrayList = fill_layers_array(objectsArrayList);
 
         if (layersArrayList == NULL) {
@@ -1972,8 +2010,10 @@ int load_level(char *data, bool is_custom) {
 
         make_sortable_layers(layersArrayList);
 
+        report_load_progress(LOAD_STAGE_GROUPS, 0.f);
         for (int i = 1; i < MAX_GROUPS; i++) {
             sort_group(i);
+            if ((i & (LEVEL_LOAD_REPORT_STEP - 1)) == 0) report_load_progress(LOAD_STAGE_GROUPS, (float) i / MAX_GROUPS);
         }
 
         level_info.level_is_empty = FALSE;
@@ -1987,6 +2027,8 @@ int load_level(char *data, bool is_custom) {
         objectsArrayList->count = 0;
         objectsArrayList->objects = NULL;
         layersArrayList = fill_layers_array(objectsArrayList);
+
+        prepare_level_song();
     }
 
     memset(col_trigger_buffer, 0, sizeof(col_trigger_buffer));
@@ -1995,7 +2037,14 @@ int load_level(char *data, bool is_custom) {
     memset(pulse_trigger_buffer, 0, sizeof(pulse_trigger_buffer));
     memset(spawn_trigger_buffer, 0, sizeof(spawn_trigger_buffer));
 
-    level_info.pulsing_type = random_int(0,2);
+    level_info.pulsing_type = random_int_stream(RNG_GAMEPLAY, 0, 2);
+
+    return 0;
+}
+
+// Texture uploads and the rest that has to happen on the main thread
+void finish_level_loading() {
+    report_load_progress(LOAD_STAGE_TEXTURES, 0.f);
 
     // Allocate the rest of mem1 so the textures end up in mem2
     int allocate = SYS_GetArena1Hi() - SYS_GetArena1Lo();
@@ -2005,14 +2054,14 @@ int load_level(char *data, bool is_custom) {
     }
 
     // Load level's bg and ground texture
-    bg = GRRLIB_LoadTexturePNG(backgrounds[level_info.background_id]);
-    ground = GRRLIB_LoadTexturePNG(grounds[level_info.ground_id]);
+    bg = load_texture(backgrounds[level_info.background_id]);
+    ground = load_texture(grounds[level_info.ground_id]);
     if (grounds_l2[level_info.ground_id]) {
-        ground_l2 = GRRLIB_LoadTexturePNG(grounds_l2[level_info.ground_id]);
+        ground_l2 = load_texture(grounds_l2[level_info.ground_id]);
     } else {
         ground_l2 = NULL;
     }
-    level_font = GRRLIB_LoadTexturePNG(font_text[level_info.font_used]);
+    level_font = load_texture(font_text[level_info.font_used]);
 
     if (padding) free(padding);
 
@@ -2025,14 +2074,16 @@ int load_level(char *data, bool is_custom) {
     load_obj_textures(GLOW);
     load_obj_textures(CHECKER_EDGE);
 
+    // Load what's visible at the start, the rest is streamed in while playing
+    preload_obj_textures();
+
     reset_color_channels();
     set_color_channels();
 
     load_coin_texture();
 
+    report_load_progress(LOAD_STAGE_TEXTURES, 1.f);
     output_log("Finished loading level\n");
-
-    return 0;
 }
 
 void unload_level() {
@@ -2176,6 +2227,29 @@ char *get_author_name(char *data_ptr) {
     return extract_gmd_key((const char *) data_ptr, "k5", "s");
 }
 
+int get_custom_song_id(char *data_ptr) {
+    char *song_id = extract_gmd_key((const char *) data_ptr, "k45", "i");
+    if (!song_id) return -1;
+
+    int id = atoi(song_id);
+    free(song_id);
+    return id;
+}
+
+int count_level_objects(char *data_ptr) {
+    char *level_string = decompress_level(data_ptr);
+    if (!level_string) return 0;
+
+    // Objects are separated by ';' after the level settings
+    int count = 0;
+    for (char *c = level_string; *c; c++) {
+        if (*c == ';') count++;
+    }
+
+    if (level_string != data_ptr) free(level_string);
+    return MAX(count - 1, 0);
+}
+
 void reload_level() {
     for (int i = 0; i < MAX_PULSE_CHANNELS; i++) {
         struct PulseTriggerBuffer *buffer = &pulse_trigger_buffer[i];
@@ -2193,6 +2267,7 @@ void reload_level() {
     memset(pulse_trigger_buffer, 0, sizeof(pulse_trigger_buffer));
     memset(spawn_trigger_buffer, 0, sizeof(spawn_trigger_buffer));
     memset(&state.particles, 0, sizeof(state.particles));
+    seed_attempt_random();
     for (int i = 0; i < objectsArrayList->count; i++) {
         GameObject *obj = objectsArrayList->objects[i];
         obj->activated[0] = obj->activated[1] = FALSE;
@@ -2281,10 +2356,12 @@ char *load_song(const char *file_name, size_t *out_size) {
     return read_file(full_path, out_size);
 }
 
-char *load_user_song(int id, size_t *out_size) {
-    char full_path[273];
-    snprintf(full_path, sizeof(full_path), "%s/%s/%d.mp3", launch_dir, USER_SONGS_FOLDER, id);
-    return read_file(full_path, out_size);
+void get_level_song_path(char *out, size_t size) {
+    if (level_info.custom_song_id >= 0) {
+        snprintf(out, size, "%s/%s/%d.mp3", launch_dir, USER_SONGS_FOLDER, level_info.custom_song_id);
+    } else {
+        snprintf(out, size, "%s/%s/%s/%s", launch_dir, RESOURCES_FOLDER, SONGS_FOLDER, songs[level_info.song_id].song_name);
+    }
 }
 
 bool check_song(int id) {
@@ -150,6 +150,7 @@ typedef struct {
     float animation_timer;
 
     char *text; // key 31
+    struct TextLayout *text_layout;
     
 } NormalObject;
 
@@ -174,6 +175,7 @@ typedef struct GameObjectSoA {
     int type[MAX_SOA_OBJECTS];
     unsigned char touching_player[MAX_SOA_OBJECTS];
     unsigned char prev_touching_player[MAX_SOA_OBJECTS];
+    float cull_radius[MAX_SOA_OBJECTS];
 } GameObjectSoA;
 
 typedef struct GameObject {
@@ -211,6 +213,7 @@ typedef struct GameObject {
 
     u8 transition_applied;          // the transition applied to the object
     u8 layer_count;
+    u16 render_index;               // index in render_states[] this frame
     
     u8 hitbox_counter[2];           // number of times the player has entered the hitbox
     bool activated[2];              // if it has been activated
@@ -218,6 +221,23 @@ typedef struct GameObject {
 
 } GameObject;
 
+// Values shared by all layers of an object, computed once per frame
+typedef struct {
+    GameObject *obj;
+    float calc_x;       // screen position
+    float calc_y;
+    float draw_x;       // x after stationary fades
+    float cos_a;
+    float sin_a;
+    float rotation;     // adjusted for mirroring
+    float fade_scale;
+    float pulse_scale;
+    int fade_value;
+    int opacity;
+    int fade_x;
+    int fade_y;
+} ObjRenderState;
+
 #define gameobjectsize sizeof(GameObject)
 #define normalobjectsize sizeof(NormalObject)
 #define triggersize sizeof(Trigger)
@@ -349,6 +369,8 @@ void update_object_section(GameObject *obj, float new_x, float new_y);
 
 char *get_level_name(char *data_ptr);
 char *get_author_name(char *data_ptr);
+int get_custom_song_id(char *data_ptr);
+int count_level_objects(char *data_ptr);
 
 extern struct LoadedLevelInfo level_info;
 
@@ -366,10 +388,30 @@ extern GDLayerSortable gfx_player_layer;
 extern GameObject *player_game_object;
 
 GameObject* add_object(int object_id, float x, float y, float rotation);
+void layout_text_object(GameObject *obj);
 
 void free_game_object_list(GDGameObjectList *list);
 void free_game_object_array(GameObject **array, int count);
+// Steps of load_level() and finish_level_loading(), in order
+enum LevelLoadStages {
+    LOAD_STAGE_READ,
+    LOAD_STAGE_DECOMPRESS,
+    LOAD_STAGE_PARSE,
+    LOAD_STAGE_LAYERS,
+    LOAD_STAGE_GROUPS,
+    LOAD_STAGE_TEXTURES,
+    LOAD_STAGE_COUNT
+};
+
+// Objects or groups between progress reports, a power of two
+#define LEVEL_LOAD_REPORT_STEP 256
+
+// Called from the thread that loads the level, progress goes from 0 to 1
+typedef void (*LevelLoadCallback)(int stage, float progress);
+
+void set_level_load_callback(LevelLoadCallback callback);
 int load_level(char *data, bool is_custom);
+void finish_level_loading();
 void unload_level();
 void reload_level();
 void reset_color_channels();
@@ -382,7 +424,7 @@ int get_detail_channel_id(int id);
 char *extract_gmd_key(const char *data, const char *key, const char *type);
 
 char *load_song(const char *file_name, size_t *out_size);
-char *load_user_song(int id, size_t *out_size);
+void get_level_song_path(char *out, size_t size);
 
 bool check_song(int id);
 void update_percentage();
@@ -419,4 +461,8 @@ inline unsigned char* soa_touching_player(GameObject *obj) {
 inline unsigned char* soa_prev_touching_player(GameObject *obj) { 
     //if (obj->soa_index < 0 || obj->soa_index >= level_info.object_count) printf("OOB %d\n", obj->soa_index); 
     return &gameObjectSoA.prev_touching_player[obj->soa_index]; 
+}
+inline float* soa_cull_radius(GameObject *obj) { 
+    //if (obj->soa_index < 0 || obj->soa_index >= level_info.object_count) printf("OOB %d\n", obj->soa_index); 
+    return &gameObjectSoA.cull_radius[obj->soa_index]; 
 }
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <ogc/lwp.h>
+#include <ogc/irq.h>
+
+#include "logger.h"
+#include "main.h"
+
+typedef struct {
+    volatile bool ready; // Set once the text is complete
+    char text[LOG_MESSAGE_SIZE];
+} LogMessage;
+
+static LogMessage log_ring[LOG_RING_SIZE];
+static volatile u32 log_head = 0; // Next slot handed to a caller
+static volatile u32 log_tail = 0; // Next slot the writer prints
+static volatile u32 log_dropped = 0;
+
+static FILE *log_file = NULL;
+static u8 logger_stack[LOGGER_STACK_SIZE] ATTRIBUTE_ALIGN(8);
+static lwp_t logger_thread = LWP_THREAD_NULL;
+static volatile bool logger_running = FALSE;
+
+static int queue_message(int level, const char *fmt, va_list args) {
+    if (level < LOG_MIN_LEVEL) return 0;
+
+    // Any thread can log, taking a slot is the only part that can't be
+    // interrupted. When the writer falls behind the message is dropped
+    // instead of making the caller wait.
+    u32 isr;
+    u32 slot;
+    _CPU_ISR_Disable(isr);
+    if (log_head - log_tail >= LOG_RING_SIZE) {
+        log_dropped++;
+        _CPU_ISR_Restore(isr);
+        return 0;
+    }
+    slot = log_head++;
+    _CPU_ISR_Restore(isr);
+
+    LogMessage *msg = &log_ring[slot & (LOG_RING_SIZE - 1)];
+    int ret = vsnprintf(msg->text, LOG_MESSAGE_SIZE, fmt, args);
+    msg->ready = TRUE;
+    return ret;
+}
+
+static bool write_queued_messages() {
+    bool wrote = FALSE;
+
+    // Stops at a slot that is still being formatted, it's picked up next batch
+    while (log_tail != log_head) {
+        LogMessage *msg = &log_ring[log_tail & (LOG_RING_SIZE - 1)];
+        if (!msg->ready) break;
+
+        if (log_file) fputs(msg->text, log_file);
+        fputs(msg->text, stdout);
+
+        msg->ready = FALSE;
+        log_tail++;
+        wrote = TRUE;
+    }
+
+    if (log_dropped > 0) {
+        u32 isr;
+        _CPU_ISR_Disable(isr);
+        u32 dropped = log_dropped;
+        log_dropped = 0;
+        _CPU_ISR_Restore(isr);
+
+        char text[64];
+        snprintf(text, sizeof(text), "%u log messages dropped\n", dropped);
+        if (log_file) fputs(text, log_file);
+        fputs(text, stdout);
+        wrote = TRUE;
+    }
+
+    return wrote;
+}
+
+static void *logger_thread_func(void *arg) {
+    while (logger_running) {
+        // One flush per batch instead of one per message
+        if (write_queued_messages() && log_file) fflush(log_file);
+        usleep(LOG_FLUSH_INTERVAL * 1000);
+    }
+    return NULL;
+}
+
+// Call after fatInitDefault(), messages logged before are kept until then
+void start_logger() {
+    if (logger_thread != LWP_THREAD_NULL) return;
+
+    char log_filename[278];
+    snprintf(log_filename, sizeof(log_filename), "%s/%s", launch_dir, "output.txt");
+    log_file = fopen(log_filename, "a");
+
+    logger_running = TRUE;
+    if (LWP_CreateThread(&logger_thread, logger_thread_func, NULL, logger_stack, LOGGER_STACK_SIZE, LOGGER_PRIORITY) < 0) {
+        logger_running = FALSE;
+        logger_thread = LWP_THREAD_NULL;
+    }
+}
+
+// Writes whatever is left, so nothing logged before exiting is lost
+void stop_logger() {
+    if (logger_thread != LWP_THREAD_NULL) {
+        logger_running = FALSE;
+        LWP_JoinThread(logger_thread, NULL);
+        logger_thread = LWP_THREAD_NULL;
+    }
+
+    write_queued_messages();
+
+    if (log_file) {
+        fclose(log_file);
+        log_file = NULL;
+    }
+}
+
+int output_log(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int ret = queue_message(LOG_INFO, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+int output_log_level(int level, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int ret = queue_message(level, fmt, args);
+    va_end(args);
+    return ret;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <gctypes.h>
+
+// output_log() only formats the message into a ring buffer. A low priority
+// thread writes the queued messages to output.txt and the console in
+// batches, so logging never waits for the SD card.
+#define LOG_RING_SIZE 256 // Messages, a power of two
+#define LOG_MESSAGE_SIZE 192 // Longer messages are cut
+#define LOG_FLUSH_INTERVAL 50 // Milliseconds between batches
+
+#define LOGGER_STACK_SIZE (16 * 1024)
+// Above the background loaders so the ring drains while they run, below
+// the main thread
+#define LOGGER_PRIORITY 50
+
+enum LogLevels {
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARNING,
+    LOG_ERROR
+};
+
+// Messages below this level are dropped before being formatted
+#define LOG_MIN_LEVEL LOG_INFO
+
+void start_logger();
+void stop_logger();
+
+int output_log(const char *fmt, ...);
+int output_log_level(int level, const char *fmt, ...);
@@ -17,12 +17,13 @@
 #include "game.h"
 
 #include "custom_mp3player.h"
-#include "oggplayer.h"
+#include "sfx.h"
 
 #include "level_loading.h"
 #include "objects.h"
 
 #include "cursor_png.h"
+#include "robot_plist.h"
 
 #include "player.h"
 #include "math.h"
@@ -33,6 +34,8 @@
 #include "trail.h"
 
 #include "animation.h"
+#include "rng.h"
+#include "profiler.h"
 
 #include <fat.h>
 
@@ -91,8 +94,13 @@ int ir_is_valid;
 AnimationLibrary robot_animations = {0};
 
 void draw_game() {
+    PROFILE_SCOPE("draw_game");
+    layersDrawn = 0;
+
     draw_background(state.background_x / 8, -(state.camera_y / 8) + 416);
 
+    update_texture_residency();
+
     u64 t0 = gettime();
     draw_all_object_layers();
     u64 t1 = gettime();
@@ -138,8 +146,8 @@ void draw_game() {
         snprintf(fpsText, sizeof(fpsText), "FPS: %.2f Steps: %d Objs: %d Layers: %d", fps, frame_counter - old_frame_counter, level_info.object_count, layersArrayList->count);
         draw_text(big_font, big_font_text, 20, 20, 0.25, fpsText);  // White tex
         
-        char layerText[64];
-        snprintf(layerText, sizeof(layerText), "Drawn layers: %d", layersDrawn);
+        char layerText[128];
+        snprintf(layerText, sizeof(layerText), "Drawn layers: %d Objs: %d Trig calls: %d", layersDrawn, render_state_count, render_trig_calls);
         draw_text(big_font, big_font_text, 20, 50, 0.25, layerText);
         old_frame_counter = frame_counter;
         
@@ -160,7 +168,7 @@ void draw_game() {
         draw_text(big_font, big_font_text, 20, 170, 0.25, physics);
         
         char objects[128];
-        snprintf(objects, sizeof(objects), "Obj: Move %d", number_of_moving_objects);
+        snprintf(objects, sizeof(objects), "Obj: Move %d Particles: %d/%d (Scanned: %d Drawn: %d) Evicted/s: %.1f", number_of_moving_objects, state.particles.count, particle_capacity, particles_scanned, particles_drawn, particle_evictions_per_second);
         draw_text(big_font, big_font_text, 20, 200, 0.25, objects);
 
         char collision[128];
@@ -174,6 +182,13 @@ void draw_game() {
         snprintf(text_ms, sizeof(text_ms), "Text: %.2f ms", text);
         draw_text(big_font, big_font_text, 20, 260, 0.25, text_ms);
 
+        char textures[128];
+        snprintf(textures, sizeof(textures), "Textures: %d (MEM1: %u KB MEM2: %u KB) Loads/s: %.1f Misses: %d Evicted: %d",
+            texture_telemetry.textures_resident,
+            texture_telemetry.bytes_resident[REGION_MEM1] / 1024, texture_telemetry.bytes_resident[REGION_MEM2] / 1024,
+            texture_telemetry.loads_per_second, texture_telemetry.misses, texture_telemetry.evictions);
+        draw_text(big_font, big_font_text, 20, 290, 0.25, textures);
+
         u64 last_frame = gettime();
         float cpu_time = ticks_to_microsecs(last_frame - start_frame) / 1000.f;
         
@@ -184,6 +199,8 @@ void draw_game() {
     
     draw_time = 0;
     obj_particles_time = 0;
+    particles_scanned = 0;
+    particles_drawn = 0;
 
     if (state.paused) {
         GRRLIB_FillScreen(RGBA(0, 0, 0, 127));
@@ -192,7 +209,6 @@ void draw_game() {
         update_ir_cursor();
         draw_ir_cursor();
     }
-    layersDrawn = 0;
 
     state.timer += dt;
 }
@@ -349,6 +365,7 @@ int main(int argc, char **argv) {
     if (!fatInitDefault()) {
 		output_log("fatInitDefault failure\n");
 	}
+    start_logger();
 
     SYS_STDIO_Report(true);
     // Init GRRLIB & WiiUse
@@ -359,13 +376,15 @@ int main(int argc, char **argv) {
     WPAD_SetIdleTimeout( 60 * 10 );
     WPAD_SetDataFormat( WPAD_CHAN_0, WPAD_FMT_BTNS_ACC_IR );
 
-    srand(time(NULL));
+    // Levels reseed it when loaded
+    seed_level_random(0);
 
     // Initialise the audio subsystem
 	ASND_Init();
     MP3Player_Init();
+    MP3Player_SetVoice(MUSIC_VOICE);
     
-    SetVolumeOgg(255);
+    init_sfx();
     load_spritesheet();
 
     // Set resolution based on mode
@@ -383,21 +402,18 @@ int main(int argc, char **argv) {
 
     startTime = gettime();    
 
-    cursor = GRRLIB_LoadTexturePNG(cursor_png);
+    cursor = load_texture(cursor_png);
     GRRLIB_SetHandle(cursor, 14, 22);
-    big_font_text = GRRLIB_LoadTexturePNG(bigFont_png);
+    big_font_text = load_texture(bigFont_png);
 
     // hopefully this fixes the ir position
     WPAD_SetVRes(WPAD_CHAN_0,screenWidth,screenHeight);
     
-    char robot_plist_path[278];
-    
-    snprintf(robot_plist_path, sizeof(robot_plist_path), "%s/%s/%s", launch_dir, RESOURCES_FOLDER, "robot.plist");
-    parsePlist(robot_plist_path, &robot_animations);
+    loadAnimations(robot_plist, robot_plist_size, &robot_animations);
 
     output_log("Loaded %d animations\n", robot_animations.animCount);
     for (int i = 0; i < robot_animations.animCount; i++) {
-        output_log("Animation %s: %d frames\n",
+        output_log_level(LOG_DEBUG, "Animation %s: %d frames\n",
                robot_animations.animations[i].name,
                robot_animations.animations[i].frameCount);
     }
@@ -420,58 +436,10 @@ Exit:
     return 0;
 }
 
-static FILE *log_file = NULL;
-
-static void ensure_log_file(void) {
-    if (log_file) return;  // already open
-
-    // Initialize SD/USB filesystem
-    if (!fatInitDefault()) return;
-
-    char log_filename[278];
-    snprintf(log_filename, sizeof(log_filename), "%s/%s", launch_dir, "output.txt");
-    
-    log_file = fopen(log_filename, "a");
-}
-
-static void close_log_file(void) {
-    if (log_file) {
-        fclose(log_file);
-        log_file = NULL;
-    }
-}
-
-int output_log(const char *fmt, ...) {
-    ensure_log_file();
-
-    if (!log_file) return 0; // failed to open log
-
-    va_list args1, args2;
-    int ret;
-
-    va_start(args1, fmt);
-    va_copy(args2, args1);  // duplicate args for two outputs
-
-    // Output to log file
-    ensure_log_file();
-    if (log_file) {
-        ret = vfprintf(log_file, fmt, args1);
-        fflush(log_file);
-    }
-
-    // Output to console (stdout)
-    ret = vprintf(fmt, args2);
-    
-    va_end(args2);
-    va_end(args1);
-
-    return ret;
-}
-
 static void ExitGame(void) {
     unload_spritesheet();
 
-    close_log_file();
+    stop_logger();
 
     // Deinitialize GRRLIB & Video
     GRRLIB_Exit();
@@ -107,7 +107,7 @@ typedef struct {
 
     float timer;
     
-    Particle particles[MAX_PARTICLES];
+    ParticlePool particles;
 
     int last_hitbox_trail;
     PlayerHitboxTrail hitbox_trail_players[2][HITBOX_TRAIL_SIZE];
@@ -1,18 +1,25 @@
 #include <math.h>
 #include <stdlib.h>
 #include <float.h>
+#include <string.h>
+#include <malloc.h>
 
 #include "math.h"
 #include "objects.h"
 #include "game.h"
+#include "custom_mp3player.h"
 #include "player.h"
 #include "main.h"
 #include "easing.h"
+#include "rng.h"
 #include "font_stuff.h"
 #include <stdio.h>
 
 #include "../libraries/color.h"
 
+// Calls into libm's sinf/cosf/fmod, for the debug info
+int trig_calls = 0;
+
 Vec2D normalize(Vec2D v) {
     float len = sqrtf(v.x*v.x + v.y*v.y);
     return (Vec2D){ v.x / len, v.y / len };
@@ -27,6 +34,7 @@ Vec2D perpendicular(Vec2D v) {
 }
 
 float positive_fmod(float n, float divisor) {
+    trig_calls++;
     float value = fmod(n, divisor);
     return value + (value < 0 ? divisor : 0);
 }
@@ -111,16 +119,17 @@ void rotate_point_around_center(float cx, float cy, float angle, float x, float
     *out_y = ynew + cy;
 }
 
+// Those are only used for effects, gameplay code uses RNG_GAMEPLAY
 float randomf() {
-    return (float)rand() / RAND_MAX;
+    return random_float_stream(RNG_COSMETIC, 0, 1);
 }
 
 float random_float(float min, float max) {
-    return ((max - min) * ((float)rand() / RAND_MAX)) + min;
+    return random_float_stream(RNG_COSMETIC, min, max);
 }
 
 int random_int(int min, int max) {
-    return rand() % (max + 1 - min) + min;
+    return random_int_stream(RNG_COSMETIC, min, max);
 }
 
 float map_range(float val, float min1, float max1, float min2, float max2) {
@@ -133,6 +142,7 @@ float adjust_angle(float angle, int flipX, int flipY) {
 
     if (flipX && flipY) {
         angle = fmodf(angle + 180.0f, 360.0f);
+        trig_calls++;
     } else if (flipX) {
         angle = 180.0f - angle;
     } else if (flipY) {
@@ -221,6 +231,58 @@ static guVector axis = (guVector){0.0f, 0.0f, 1.0f};
 
 // Custom GRRLIB functions for maximum performance (so it can be batched)
 
+GRRLIB_texImg *load_texture(const u8 *data) {
+    const GXTextureHeader *header = (const GXTextureHeader *) data;
+
+    // Not converted at build time, decode the PNG
+    if (memcmp(header->magic, GX_TEXTURE_MAGIC, 4) != 0) {
+        return GRRLIB_LoadTexturePNG(data);
+    }
+
+    GRRLIB_texImg *tex = calloc(1, sizeof(GRRLIB_texImg));
+    if (tex == NULL) {
+        output_log("Couldn't allocate texture\n");
+        return NULL;
+    }
+
+    tex->data = memalign(32, header->data_size);
+    if (tex->data == NULL) {
+        output_log("Couldn't allocate %d bytes for texture data\n", header->data_size);
+        free(tex);
+        return NULL;
+    }
+
+    // Already tiled, just copy it
+    memcpy(tex->data, data + sizeof(GXTextureHeader), header->data_size);
+    DCFlushRange(tex->data, header->data_size);
+
+    tex->w = header->width;
+    tex->h = header->height;
+    tex->format = header->format;
+    GRRLIB_SetHandle(tex, 0, 0);
+
+    return tex;
+}
+
+bool get_texture_dimensions(const u8 *data, int *width, int *height) {
+    const GXTextureHeader *header = (const GXTextureHeader *) data;
+
+    if (memcmp(header->magic, GX_TEXTURE_MAGIC, 4) == 0) {
+        *width = header->width;
+        *height = header->height;
+        return TRUE;
+    }
+
+    // Read it from the PNG IHDR chunk
+    if (memcmp(data + 12, "IHDR", 4) == 0) {
+        *width = (data[16] << 24) | (data[17] << 16) | (data[18] << 8) | data[19];
+        *height = (data[20] << 24) | (data[21] << 16) | (data[22] << 8) | data[23];
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
 void set_texture(const GRRLIB_texImg *tex) {
     
     if (tex == NULL || tex->data == NULL)
@@ -246,6 +308,9 @@ void  custom_drawImg (const f32 xpos, const f32 ypos, const GRRLIB_texImg *tex,
     guMtxRotAxisDeg(m2, &axis, degrees);
     guMtxConcat    (m2, m1, m);
 
+    // sinf and cosf in guMtxRotAxisDeg, then the handle offset below
+    trig_calls += 6;
+
     const f32 width  = tex->w * 0.5f;
     const f32 height = tex->h * 0.5f;
 
@@ -818,9 +883,11 @@ void wait_initial_time() {
         opacity -= FADE_SPEED * dt;
         if (opacity < 0) opacity = 0;
 
+        song_position = MP3Player_GetPosition();
         while (accumulator >= STEPS_DT) {
             update_beat();
             accumulator -= STEPS_DT;
+            song_position += STEPS_DT;
         }
         update_particles();
     
@@ -902,25 +969,104 @@ void  draw_glyph (const f32 xpos, const f32 ypos, const f32 partx, const f32 par
     GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
 }
 
-struct glyph *get_glyph(struct charset font, char character) {
-    for (int i = 0; i < font.char_num; i++) {
-        if (character == font.chars[i].id) {
-            return &font.chars[i];
-        }
+static inline struct glyph *get_glyph(const struct charset *font, char character) {
+    int index = font->index[(unsigned char) character];
+    return index ? &font->chars[index - 1] : NULL;
+}
+
+TextLayout text_layout_cache[TEXT_LAYOUT_CACHE_SIZE];
+u32 text_layout_clock = 0;
+
+static u32 hash_text(const struct glyph *font_chars, const char *text) {
+    u32 hash = 0x811C9DC5 ^ (u32) font_chars;
+    for (const char *c = text; *c; c++) {
+        hash ^= (u8) *c;
+        hash *= 0x01000193;
     }
-    // If not found and a lowercase letter, convert to uppercase
-    if (character >= 'a' && character <= 'z') {
-        character -= 32;
-
-        // Search again
-        for (int i = 0; i < font.char_num; i++) {
-            if (character == font.chars[i].id) {
-                return &font.chars[i];
-            }
+    return hash;
+}
+
+static bool layout_text(TextLayout *layout, const struct charset *font, const char *text) {
+    int length = strlen(text);
+
+    // Reuse the buffers of whatever was here before
+    if (length + 1 > layout->capacity) {
+        char *new_text = realloc(layout->text, length + 1);
+        if (!new_text) return FALSE;
+        layout->text = new_text;
+
+        TextQuad *new_quads = realloc(layout->quads, (length + 1) * sizeof(TextQuad));
+        if (!new_quads) return FALSE;
+        layout->quads = new_quads;
+
+        layout->capacity = length + 1;
+    }
+
+    memcpy(layout->text, text, length + 1);
+    layout->font_chars = font->chars;
+    layout->hash = hash_text(font->chars, text);
+    layout->quad_count = 0;
+
+    float offset = 0;
+    for (int i = 0; i < length; i++) {
+        struct glyph *character = get_glyph(font, text[i]);
+        if (character == NULL) continue;
+
+        TextQuad *quad = &layout->quads[layout->quad_count++];
+        quad->x = offset + character->xoffset;
+        quad->y = character->yoffset;
+        quad->tile_x = character->x;
+        quad->tile_y = character->y;
+        quad->width = character->width;
+        quad->height = character->height;
+
+        offset += character->xadvance;
+    }
+    layout->length = offset;
+    return TRUE;
+}
+
+TextLayout *create_text_layout(const struct charset *font, const char *text) {
+    if (!text) return NULL;
+
+    TextLayout *layout = calloc(1, sizeof(TextLayout));
+    if (!layout) return NULL;
+
+    if (!layout_text(layout, font, text)) {
+        free_text_layout(layout);
+        return NULL;
+    }
+    return layout;
+}
+
+void free_text_layout(TextLayout *layout) {
+    if (!layout) return;
+    free(layout->text);
+    free(layout->quads);
+    free(layout);
+}
+
+TextLayout *get_text_layout(const struct charset *font, const char *text) {
+    u32 hash = hash_text(font->chars, text);
+    text_layout_clock++;
+
+    TextLayout *lru = &text_layout_cache[0];
+    for (int i = 0; i < TEXT_LAYOUT_CACHE_SIZE; i++) {
+        TextLayout *layout = &text_layout_cache[i];
+        if (layout->text && layout->hash == hash && layout->font_chars == font->chars && strcmp(layout->text, text) == 0) {
+            layout->last_used = text_layout_clock;
+            return layout;
         }
+        if (layout->last_used < lru->last_used) lru = layout;
     }
-    
-    return NULL;
+
+    // Not cached, replace the least recently used one
+    if (!layout_text(lru, font, text)) {
+        lru->last_used = 0;
+        return NULL;
+    }
+    lru->last_used = text_layout_clock;
+    return lru;
 }
 
 float get_text_length(struct charset font, const float zoom, const char *text, ...) {
@@ -929,112 +1075,89 @@ float get_text_length(struct charset font, const float zoom, const char *text, .
 
     va_list argp;
     va_start(argp, text);
-    const int size = vsnprintf(tmp, sizeof(tmp), text, argp);
+    vsnprintf(tmp, sizeof(tmp), text, argp);
     va_end(argp);
     
-    float text_length = 0;
-    for (int i = 0; i < size; i++) {
-        struct glyph *character = get_glyph(font, tmp[i]);
+    TextLayout *layout = get_text_layout(&font, tmp);
+    if (!layout) return 0;
 
-        if (character != NULL) {
-            float xadvance = character->xadvance * zoom;
+    return layout->length * zoom;
+}
 
-            text_length += xadvance;
-        }
+void draw_text_layout(TextLayout *layout, GRRLIB_texImg *tex, const float x, const float y, const float zoom) {
+    if (!layout || !tex || !tex->data) {
+        return;
+    }
+    GRRLIB_SetHandle(tex, tex->w / 2, tex->h / 2);
+
+    for (int i = 0; i < layout->quad_count; i++) {
+        TextQuad *quad = &layout->quads[i];
+        draw_glyph(x + quad->x * zoom, y + quad->y * zoom, quad->tile_x, quad->tile_y, quad->width, quad->height, tex, 0, zoom, zoom, 0xffffffff);
     }
-    return text_length;
 }
 
 void draw_text(struct charset font, GRRLIB_texImg *tex, const float x, const float y, const float zoom, const char *text, ...) {
     if (!text || !tex || !tex->data) {
         return;
     }
-    GRRLIB_SetHandle(tex, tex->w / 2, tex->h / 2);
 
     char tmp[1024];
 
     va_list argp;
     va_start(argp, text);
-    const int size = vsnprintf(tmp, sizeof(tmp), text, argp);
+    vsnprintf(tmp, sizeof(tmp), text, argp);
     va_end(argp);
 
-    float offset = 0;
-    for (int i = 0; i < size; i++) {
-        struct glyph *character = get_glyph(font, tmp[i]);
-
-        if (character != NULL) {
-            int tile_x = character->x;
-            int tile_y = character->y;
-            int width = character->width;
-            int height = character->height;
-            float xoffset = character->xoffset * zoom;
-            float yoffset = character->yoffset * zoom;
-            float xadvance = character->xadvance * zoom;
-
-            draw_glyph(x + offset + xoffset, y + yoffset, tile_x, tile_y, width, height, tex, 0, zoom, zoom, 0xffffffff);
-            
-            offset += xadvance;
-        }
-    }
+    draw_text_layout(get_text_layout(&font, tmp), tex, x, y, zoom);
 }
 
-void draw_rotated_text(struct charset font, GRRLIB_texImg *tex, const float x, const float y, const float rotation, const float zoom_x, const float zoom_y, const u32 color, const char *text, ...) {
-    if (!text || !tex || !tex->data) {
+void draw_rotated_text_layout(TextLayout *layout, GRRLIB_texImg *tex, const float x, const float y, const float rotation, const float zoom_x, const float zoom_y, const u32 color) {
+    if (!layout || !tex || !tex->data) {
         return;
     }
     
     GRRLIB_SetHandle(tex, tex->w / 2, tex->h / 2);
 
-    char tmp[1024];
-
-    va_list argp;
-    va_start(argp, text);
-    const int size = vsnprintf(tmp, sizeof(tmp), text, argp);
-    va_end(argp);
+    float rad = DegToRad(rotation); // convert to radians
+    float cos_rad = cosf(rad);
+    float sin_rad = sinf(rad);
 
-    float length = get_text_length(font, fabsf(zoom_x), tmp);
+    for (int i = 0; i < layout->quad_count; i++) {
+        TextQuad *quad = &layout->quads[i];
 
-    float rad = DegToRad(rotation); // convert to radians
-    float offset = 0;
+        // Glyph center relative to the text center, before rotation
+        float dx = (quad->x + quad->width / 2.f - layout->length / 2.f) * zoom_x;
+        float dy = (quad->y + quad->height / 2.f - 55 / 2.f) * zoom_y;
 
-    int flip_x = (zoom_x < 0 ? -1 : 1);
-    int flip_y = (zoom_y < 0 ? -1 : 1);
+        // Rotate glyph center around text center (x, y)
+        float final_x = x + dx * cos_rad - dy * sin_rad;
+        float final_y = y + dx * sin_rad + dy * cos_rad;
 
-    for (int i = 0; i < size; i++) {
-        struct glyph *character = get_glyph(font, tmp[i]);
-        
-        if (character != NULL) {
-            int tile_x = character->x;
-            int tile_y = character->y;
-            int width = character->width;
-            int height = character->height;
-            float xoffset = character->xoffset * zoom_x;
-            float yoffset = character->yoffset * zoom_y;
-            float xadvance = character->xadvance * zoom_x;
-
-            // Compute glyph center position before rotation
-            float gx = (x - length * flip_x / 2.f) + offset + xoffset + width * zoom_x / 2.0f;
-            float gy = (y - 55 * fabsf(zoom_y) * flip_y / 2.f) + yoffset + height * zoom_y / 2.0f;
-
-            // Rotate glyph center around text center (x, y)
-            float dx = gx - x;
-            float dy = gy - y;
-            float final_x = x + dx * cosf(rad) - dy * sinf(rad);
-            float final_y = y + dx * sinf(rad) + dy * cosf(rad);
-
-            // Draw glyph so its center is at (final_x, final_y)
-            draw_glyph(final_x - width * zoom_x / 2.0f, final_y - height * zoom_y / 2.0f,
-                       tile_x, tile_y, width, height,
-                       tex, rotation, zoom_x, zoom_y, color);
-
-            offset += xadvance;
-        }
+        // Draw glyph so its center is at (final_x, final_y)
+        draw_glyph(final_x - quad->width * zoom_x / 2.0f, final_y - quad->height * zoom_y / 2.0f,
+                   quad->tile_x, quad->tile_y, quad->width, quad->height,
+                   tex, rotation, zoom_x, zoom_y, color);
     }
     
     GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
     GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
 }
 
+void draw_rotated_text(struct charset font, GRRLIB_texImg *tex, const float x, const float y, const float rotation, const float zoom_x, const float zoom_y, const u32 color, const char *text, ...) {
+    if (!text || !tex || !tex->data) {
+        return;
+    }
+
+    char tmp[1024];
+
+    va_list argp;
+    va_start(argp, text);
+    vsnprintf(tmp, sizeof(tmp), text, argp);
+    va_end(argp);
+
+    draw_rotated_text_layout(get_text_layout(&font, tmp), tex, x, y, rotation, zoom_x, zoom_y, color);
+}
+
 Color HSV_combine(Color color, HSV hsv) {
     if (hsv.h == 0 && hsv.s == 0 && hsv.v == 0) {
         return color;
@@ -12,6 +12,7 @@
 
 
 extern Mtx                 GXmodelView2D;
+extern int trig_calls;
 
 Vec2D rotate(Vec2D point, float angle, Vec2D origin);
 float maxf(float a, float b);
@@ -70,6 +71,19 @@ void draw_hitbox_line_inward(Vec2D rect[4],
                              const u32 color);
 void draw_polygon_inward_mitered(Vec2D *poly, int n, float thickness, u32 color);
 
+// Header of the pre-tiled textures made by tools/png2gx.py
+#define GX_TEXTURE_MAGIC "GXTX"
+typedef struct {
+    char magic[4];
+    u16 width;
+    u16 height;
+    u32 format;
+    u32 data_size;
+    u8 pad[16];
+} GXTextureHeader;
+
+GRRLIB_texImg *load_texture(const u8 *data);
+bool get_texture_dimensions(const u8 *data, int *width, int *height);
 void set_texture(const GRRLIB_texImg *tex);
 float normalize_angle(float angle);
 float ip1_ceilf(float x);
@@ -79,6 +93,33 @@ void fade_out();
 void fade_in_level();
 void wait_initial_time();
 
+// Strings laid out recently, so static text isn't laid out every frame
+#define TEXT_LAYOUT_CACHE_SIZE 32
+
+// A glyph of a laid out string, positions in font units
+typedef struct {
+    float x, y;
+    u16 tile_x, tile_y;
+    u16 width, height;
+} TextQuad;
+
+typedef struct TextLayout {
+    const struct glyph *font_chars;
+    char *text;
+    u32 hash;
+    u32 last_used;
+    float length; // In font units
+    TextQuad *quads;
+    int quad_count;
+    int capacity;
+} TextLayout;
+
+TextLayout *create_text_layout(const struct charset *font, const char *text);
+void free_text_layout(TextLayout *layout);
+TextLayout *get_text_layout(const struct charset *font, const char *text);
+void draw_text_layout(TextLayout *layout, GRRLIB_texImg *tex, const float x, const float y, const float zoom);
+void draw_rotated_text_layout(TextLayout *layout, GRRLIB_texImg *tex, const float x, const float y, const float rotation, const float zoom_x, const float zoom_y, const u32 color);
+
 float get_text_length(struct charset font, const float zoom, const char *text, ...);
 void draw_text(struct charset font, GRRLIB_texImg *tex, const float x, const float y, const float zoom, const char *text, ...);
 void draw_rotated_text(struct charset font, GRRLIB_texImg *tex, const float x, const float y, const float rotation, const float zoom_x, const float zoom_y, const u32 color, const char *text, ...) ;
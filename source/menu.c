@@ -5,8 +5,7 @@
 
 #include "level.h"
 #include "custom_mp3player.h"
-#include "oggplayer.h"
-#include "playSound_01_ogg.h"
+#include "sfx.h"
 
 #include <fat.h>
 #include <dirent.h>
@@ -16,6 +15,8 @@
 #include "math.h"
 
 #include "menu.h"
+#include "menu_loader.h"
+#include "level_loader.h"
 
 #include "game.h"
 
@@ -35,15 +36,11 @@ GRRLIB_texImg *ground_line_texture;
 
 int main_levels();
 int sdcard_levels();
+void refresh_sdcard_levels();
 void game_folder_not_found();
 
 int level_id = 0;
 
-typedef struct {
-    char name[MAX_PATH_LEN];
-    bool is_dir;
-} FileOrFolder;
-
 FileOrFolder sd_level_paths[MAX_SD_LEVELS];
 int sd_level_count = 0;
 
@@ -170,15 +167,37 @@ void menu_go_right(){
     if (level_id >= LEVEL_NUM) level_id = 0;
 }
 
+void draw_loading_screen(float progress) {
+    GRRLIB_FillScreen(RGBA(0, 0, 0, 255));
+
+    int text_width = get_text_length(big_font, 0.5, "Loading...");
+    draw_text(big_font, big_font_text, (screenWidth - text_width) / 2, screenHeight / 2 - 40, 0.5, "Loading...");
+
+    int bar_width = screenWidth / 2;
+    int bar_x = (screenWidth - bar_width) / 2;
+    int bar_y = screenHeight / 2;
+    GRRLIB_Rectangle(bar_x, bar_y, bar_width, 16, RGBA(255, 255, 255, 255), FALSE);
+    GRRLIB_Rectangle(bar_x + 2, bar_y + 2, (bar_width - 4) * progress, 12, RGBA(255, 255, 255, 255), TRUE);
+}
+
+// Keeps drawing the progress while the loader thread loads the level
+int wait_for_level_loader() {
+    // The play sound lasts about 90 frames, the level loads during it
+    for (int frame = 0; frame < 90 || !level_loader_done(); frame++) {
+        update_input();
+        draw_loading_screen(get_level_load_progress());
+        GRRLIB_Render();
+    }
+
+    return finish_level_loader();
+}
+
 void start_level(){
     gameRoutine = ROUTINE_GAME;
     MP3Player_Stop();
-    PlayOgg(playSound_01_ogg, playSound_01_ogg_size, 0, OGG_ONE_TIME);
-    for (int i = 0; i < 90; i++) {
-        update_input();
-        VIDEO_WaitVSync();
-    }
-    int code = load_level((char *) levels[level_id].data_ptr, FALSE);
+    play_sfx(SFX_PLAY_LEVEL);
+    start_level_loader((char *) levels[level_id].data_ptr, FALSE);
+    int code = wait_for_level_loader();
     if (!code) {
         exit_menu = true;
     }
@@ -213,6 +232,7 @@ char current_directory[256];
 int dir_level = 0;
 
 int custom_song_id = -1;
+bool custom_song_found = FALSE;
 
 void print_custom_song(int song_id) {
     char text[269];
@@ -220,27 +240,18 @@ void print_custom_song(int song_id) {
     
     draw_text(big_font, big_font_text, 0, 270, 0.5, text);
 
-    if (!check_song(song_id)) {
+    if (!custom_song_found) {
         draw_text(big_font, big_font_text, 0, 300, 0.5, "Song not found.");
         draw_text(big_font, big_font_text, 0, 330, 0.5, "Add it in the \"%s\" folder.", USER_SONGS_FOLDER);
     }
 }
 
-void check_custom_song(char *level_data) {
-    char *gmd_custom_song_id = extract_gmd_key((const char *) level_data, "k45", "i");
-    if (gmd_custom_song_id) {
-        custom_song_id = atoi(gmd_custom_song_id);   
-        free(gmd_custom_song_id);     
-    } else {
-        custom_song_id = -1;
-    }
-}
-
 void load_folder(char *dir) {
+    // The loader thread fills the entries in, it mustn't see them half made
+    lock_menu_loader();
     sd_level_count = 0;
 
 	struct dirent *pent;
-	struct stat statbuf;
 
     char directory[268];
     
@@ -256,9 +267,11 @@ void load_folder(char *dir) {
 
     output_log("Loaded folder: %s\n", directory);
 
-    while ((pent=readdir(level_dir))!=NULL) {
-        stat(pent->d_name,&statbuf);
+    int index_count;
+    LevelMetadata *index = read_level_index(directory, &index_count);
+    int indexed = 0;
 
+    while ((pent=readdir(level_dir))!=NULL) {
         if(strcmp(".", pent->d_name) == 0 || strcmp("..", pent->d_name) == 0)
             continue;
 
@@ -266,25 +279,59 @@ void load_folder(char *dir) {
     
         if (ext) {
             if (strcmp(ext, ".gmd") == 0) { // GMD
-                snprintf(sd_level_paths[sd_level_count].name, MAX_PATH_LEN, "%s/%s", directory, pent->d_name);
-                sd_level_paths[sd_level_count].is_dir = FALSE;
+                FileOrFolder *entry = &sd_level_paths[sd_level_count];
+                snprintf(entry->name, MAX_PATH_LEN, "%s/%s", directory, pent->d_name);
+                entry->is_dir = FALSE;
+                entry->song_found = FALSE;
+
+                u32 size = pent->d_stat.st_size;
+                u32 mtime = pent->d_stat.st_mtime;
+
+                // Only levels that are new or changed since the index was saved get read
+                LevelMetadata *cached = NULL;
+                for (int i = 0; i < index_count; i++) {
+                    if (index[i].size == size && index[i].mtime == mtime && strcmp(index[i].file_name, pent->d_name) == 0) {
+                        cached = &index[i];
+                        break;
+                    }
+                }
+
+                if (cached) {
+                    entry->meta = *cached;
+                    entry->state = (entry->meta.song_id >= 0) ? ENTRY_NEEDS_SONG_CHECK : ENTRY_READY;
+                    indexed++;
+                } else {
+                    memset(&entry->meta, 0, sizeof(entry->meta));
+                    snprintf(entry->meta.file_name, sizeof(entry->meta.file_name), "%s", pent->d_name);
+                    entry->meta.size = size;
+                    entry->meta.mtime = mtime;
+                    entry->meta.song_id = -1;
+                    entry->state = ENTRY_NEEDS_METADATA;
+                }
                 sd_level_count++;
 
                 if (sd_level_count >= MAX_SD_LEVELS) break;
 
-                output_log("Found GMD file: %s %llu\n", pent->d_name, pent->d_stat.st_size);
+                output_log_level(LOG_DEBUG, "Found GMD file: %s %llu\n", pent->d_name, pent->d_stat.st_size);
             }
         } else { { // Folder
             snprintf(sd_level_paths[sd_level_count].name, MAX_PATH_LEN, "%s/%s", directory, pent->d_name);
             sd_level_paths[sd_level_count].is_dir = TRUE;
+            sd_level_paths[sd_level_count].state = ENTRY_READY;
             sd_level_count++;
 
             if (sd_level_count >= MAX_SD_LEVELS) break;
 
-            output_log("Found folder: %s %llu\n", pent->d_name, pent->d_stat.st_size);
+            output_log_level(LOG_DEBUG, "Found folder: %s %llu\n", pent->d_name, pent->d_stat.st_size);
         } }
     }
     closedir(level_dir);
+    free(index);
+
+    // New and changed levels are read by the loader thread, which saves the
+    // index once they are all known. Removed levels only need it rewritten.
+    menu_loader_folder_changed(directory, indexed != index_count);
+    unlock_menu_loader();
 }
 
 void go_back_directory(char *path) {
@@ -324,43 +371,34 @@ int menu_loop() {
         return TRUE;
 	}
 
+    start_menu_loader();
     load_folder(current_directory);
 
 	closedir(pdir);
     
-    // Read first gmd
-    char *level_data = read_file(sd_level_paths[level_id].name, &outsize);
-    if (level_data) {
-        char *level_name = get_level_name(level_data);
-        char *author_name = get_author_name(level_data);
-        snprintf(current_level_name, 255, "%s - by %s", level_name, author_name);
-        free(level_name);
-        free(author_name);
-
-        free(level_data);
-    }
+    refresh_sdcard_levels();
 
     size_t size;
     char *menuLoop = load_song("menuLoop.mp3", &size);
 
     button_count = 0;
 
-    menu_top_bar = GRRLIB_LoadTexturePNG(top_bar_png);
-    menu_corner_squares = GRRLIB_LoadTexturePNG(corner_squares_png);
-    menu_arrow = GRRLIB_LoadTexturePNG(arrow_png);
-    gradient_texture = GRRLIB_LoadTexturePNG(gradient_png);
-    ground_line_texture = GRRLIB_LoadTexturePNG(ground_line_png);
-    menu_ground = GRRLIB_LoadTexturePNG(g_01_png); //groundgroundgroundgourng
+    menu_top_bar = load_texture(top_bar_png);
+    menu_corner_squares = load_texture(corner_squares_png);
+    menu_arrow = load_texture(arrow_png);
+    gradient_texture = load_texture(gradient_png);
+    ground_line_texture = load_texture(ground_line_png);
+    menu_ground = load_texture(g_01_png); //groundgroundgroundgourng
     
 
     //difficultty faces
-    difficulty_faces[0] = GRRLIB_LoadTexturePNG(easy_png);
-    difficulty_faces[1] = GRRLIB_LoadTexturePNG(normal_png);
-    difficulty_faces[2] = GRRLIB_LoadTexturePNG(hard_png);
-    difficulty_faces[3] = GRRLIB_LoadTexturePNG(harder_png);
-    difficulty_faces[4] = GRRLIB_LoadTexturePNG(insane_png);
-    difficulty_faces[5] = GRRLIB_LoadTexturePNG(demon_png);
-    difficulty_faces[6] = GRRLIB_LoadTexturePNG(auto_png);
+    difficulty_faces[0] = load_texture(easy_png);
+    difficulty_faces[1] = load_texture(normal_png);
+    difficulty_faces[2] = load_texture(hard_png);
+    difficulty_faces[3] = load_texture(harder_png);
+    difficulty_faces[4] = load_texture(insane_png);
+    difficulty_faces[5] = load_texture(demon_png);
+    difficulty_faces[6] = load_texture(auto_png);
 
     create_main_menu_buttons();
 
@@ -390,19 +428,9 @@ int menu_loop() {
             create_main_menu_buttons();
 
             if (level_mode == 1) {
-                // Read first gmd
-                char *level_data = read_file(sd_level_paths[level_id].name, &outsize);
-                if (level_data) {
-                    char *level_name = get_level_name(level_data);
-                    char *author_name = get_author_name(level_data);
-                    snprintf(current_level_name, 255, "%s - by %s", level_name, author_name);
-                    free(level_name);
-                    free(author_name);
-                    
-                    check_custom_song(level_data);
-                    
-                    free(level_data);
-                }
+                refresh_sdcard_levels();
+            } else {
+                menu_loader_select(-1);
             }
             
             draw_menu();
@@ -439,6 +467,7 @@ int menu_loop() {
         GRRLIB_FreeTexture(difficulty_faces[i]);
     }
     if (menuLoop) free(menuLoop);
+    stop_menu_loader();
     
     if (level_info.song_offset > 0) {
         int textOffset = (get_text_length(big_font, 0.5, "Loading..."));
@@ -450,32 +479,48 @@ int menu_loop() {
     return exit_code;
 }
 
-void refresh_sdcard_levels() {
+// Set while the loader thread hasn't read the highlighted level yet
+bool level_text_pending = FALSE;
+
+// Everything comes from the folder index or the loader thread, so scrolling
+// doesn't touch the SD card
+void update_level_text() {
     memset(current_level_name, 0, 255);
-    error_code = 0;
-                
-    if (sd_level_paths[level_id].is_dir) {
-        snprintf(current_level_name, 255, "%s", sd_level_paths[level_id].name);
+    custom_song_id = -1;
+    custom_song_found = FALSE;
+    level_text_pending = FALSE;
+
+    if (level_id >= sd_level_count) return;
+
+    lock_menu_loader();
+    FileOrFolder *entry = &sd_level_paths[level_id];
+    if (entry->is_dir) {
+        snprintf(current_level_name, 255, "%s", entry->name);
+    } else if (entry->state == ENTRY_NEEDS_METADATA) {
+        snprintf(current_level_name, 255, "Loading...");
+        level_text_pending = TRUE;
+    } else {
+        snprintf(current_level_name, 255, "%s - by %s", entry->meta.level_name, entry->meta.author);
+        custom_song_id = entry->meta.song_id;
+        custom_song_found = entry->song_found;
+        // Still waiting for the song check
+        level_text_pending = (entry->state != ENTRY_READY);
     }
+    unlock_menu_loader();
+}
 
-    char *level_data = read_file(sd_level_paths[level_id].name, &outsize);
-    if (level_data) {
-        char *level_name = get_level_name(level_data);
-        char *author_name = get_author_name(level_data);
-        snprintf(current_level_name, 255, "%s - by %s", level_name, author_name);
-        free(level_name);
-        free(author_name);
-        
-        check_custom_song(level_data);
-
-        free(level_data);
-    }
+void refresh_sdcard_levels() {
+    error_code = 0;
+    menu_loader_select(level_id);
+    update_level_text();
 }
 
 int sdcard_levels() {
     GRRLIB_FillScreen(RGBA(0, 127, 0, 255));
             
     draw_text(big_font, big_font_text, 0, 400, 0.5, "Press 1 to switch to main levels.");
+
+    if (level_text_pending) update_level_text();
     
     if (sd_level_count > 0) {
         char text[269];
@@ -524,19 +569,22 @@ int sdcard_levels() {
                 // Start level
                 gameRoutine = ROUTINE_GAME;
                 MP3Player_Stop();
-                PlayOgg(playSound_01_ogg, playSound_01_ogg_size, 0, OGG_ONE_TIME);
-                for (int i = 0; i < 90; i++) {
-                    update_input();
-                    VIDEO_WaitVSync();
-                }
+                play_sfx(SFX_PLAY_LEVEL);
                 
-                char *level = read_file(sd_level_paths[level_id].name, &outsize);
-                int code = load_level(level, TRUE);
-                free(level);
+                // Most of the time the menu loader has read it already,
+                // if not the level loader reads it behind the progress bar
+                char *level = take_prefetched_level(level_id, &outsize);
+
+                // Nothing else should compete with the level loader, its reads
+                // give up after the chunk in flight
+                stop_menu_loader();
+                start_level_file_loader(sd_level_paths[level_id].name, level);
+                int code = wait_for_level_loader();
 
                 if (!code) {
                     return 1;
                 }
+                start_menu_loader();
                 error_code = code;
                 return 0;
             }
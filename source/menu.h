@@ -3,6 +3,49 @@
 #define MAX_SD_LEVELS 128
 #define MAX_PATH_LEN 524
 
+// Name, author and song of every level in a folder, so browsing doesn't read the levels
+#define LEVEL_INDEX_FILE "levels.idx"
+#define LEVEL_INDEX_MAGIC "LIDX"
+#define LEVEL_INDEX_VERSION 1
+#define LEVEL_META_NAME_LEN 64
+
+#include <gctypes.h>
+
+// Saved in LEVEL_INDEX_FILE, a header and one of these per level
+typedef struct {
+    char file_name[256];
+    u32 size;
+    u32 mtime; // Size and time of the .gmd it was read from
+    char level_name[LEVEL_META_NAME_LEN];
+    char author[LEVEL_META_NAME_LEN];
+    s32 song_id;
+    s32 object_count;
+} LevelMetadata;
+
+typedef struct {
+    char magic[4];
+    u32 version;
+    u32 count;
+} LevelIndexHeader;
+
+// What the menu loader still has to do for an entry
+enum LevelEntryStates {
+    ENTRY_READY,
+    ENTRY_NEEDS_METADATA,
+    ENTRY_NEEDS_SONG_CHECK
+};
+
+typedef struct {
+    char name[MAX_PATH_LEN];
+    bool is_dir;
+    bool song_found;
+    int state;
+    LevelMetadata meta;
+} FileOrFolder;
+
+extern FileOrFolder sd_level_paths[MAX_SD_LEVELS];
+extern int sd_level_count;
+
 //textures
 #include "top_bar_png.h"
 #include "corner_squares_png.h"
@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/cond.h>
+
+#include "menu_loader.h"
+#include "main.h"
+#include "game.h"
+#include "filesystem.h"
+#include "level_loading.h"
+
+static u8 loader_stack[MENU_LOADER_STACK_SIZE] ATTRIBUTE_ALIGN(8);
+static lwp_t loader_thread = LWP_THREAD_NULL;
+static mutex_t loader_mutex;
+static cond_t loader_cond;
+static volatile bool loader_running = FALSE;
+
+static char loader_directory[MAX_PATH_LEN];
+static volatile u32 folder_generation = 0; // Bumped when sd_level_paths is rebuilt
+static bool index_dirty = FALSE;
+
+// Highlighted level and the copy of it read ahead
+static int selected_level = -1;
+static volatile u32 level_generation = 0;
+static int prefetched_id = -1;
+static char *prefetched_level = NULL;
+static size_t prefetched_size = 0;
+
+LevelMetadata *read_level_index(const char *directory, int *out_count) {
+    char path[MAX_PATH_LEN];
+    snprintf(path, sizeof(path), "%s/%s", directory, LEVEL_INDEX_FILE);
+
+    *out_count = 0;
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+
+    LevelIndexHeader header;
+    LevelMetadata *entries = NULL;
+    if (fread(&header, sizeof(header), 1, fp) == 1 &&
+        memcmp(header.magic, LEVEL_INDEX_MAGIC, 4) == 0 &&
+        header.version == LEVEL_INDEX_VERSION &&
+        header.count > 0 && header.count <= MAX_SD_LEVELS) {
+        entries = malloc(header.count * sizeof(LevelMetadata));
+        if (entries && fread(entries, sizeof(LevelMetadata), header.count, fp) == header.count) {
+            *out_count = header.count;
+        } else {
+            free(entries);
+            entries = NULL;
+        }
+    }
+    fclose(fp);
+    return entries;
+}
+
+static void write_level_index(const char *directory, LevelMetadata *entries, int count) {
+    char path[MAX_PATH_LEN];
+    snprintf(path, sizeof(path), "%s/%s", directory, LEVEL_INDEX_FILE);
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        output_log("Couldn't save the level index %s\n", path);
+        return;
+    }
+
+    LevelIndexHeader header;
+    memcpy(header.magic, LEVEL_INDEX_MAGIC, 4);
+    header.version = LEVEL_INDEX_VERSION;
+    header.count = count;
+
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(entries, sizeof(LevelMetadata), count, fp);
+    fclose(fp);
+}
+
+// Generation the read in progress belongs to, reads give up once it changes
+static u32 read_generation;
+
+static bool keep_reading_level(size_t read, size_t size) {
+    return loader_running && read_generation == level_generation;
+}
+
+static bool keep_reading_metadata(size_t read, size_t size) {
+    return loader_running && read_generation == folder_generation;
+}
+
+// Takes what the menu shows out of the level itself
+static void parse_level_metadata(char *level_data, LevelMetadata *meta) {
+    meta->level_name[0] = '\0';
+    meta->author[0] = '\0';
+    meta->song_id = -1;
+    meta->object_count = 0;
+
+    if (!level_data) return;
+
+    char *level_name = get_level_name(level_data);
+    char *author_name = get_author_name(level_data);
+    if (level_name) snprintf(meta->level_name, sizeof(meta->level_name), "%s", level_name);
+    if (author_name) snprintf(meta->author, sizeof(meta->author), "%s", author_name);
+    free(level_name);
+    free(author_name);
+
+    meta->song_id = get_custom_song_id(level_data);
+    meta->object_count = count_level_objects(level_data);
+}
+
+static void read_level_metadata(const char *path, u32 generation, LevelMetadata *meta) {
+    read_generation = generation;
+    char *level_data = read_file_chunked(path, MENU_LOADER_CHUNK_SIZE, keep_reading_metadata, NULL);
+    parse_level_metadata(level_data, meta);
+    free(level_data);
+}
+
+static int find_pending_entry() {
+    // Closest to the highlighted level first, those are the next ones shown
+    int center = MAX(selected_level, 0);
+    for (int distance = 0; distance < sd_level_count; distance++) {
+        int ids[2] = { center + distance, center - distance };
+        for (int i = 0; i < 2; i++) {
+            int id = ids[i];
+            if (id >= 0 && id < sd_level_count && sd_level_paths[id].state != ENTRY_READY) return id;
+        }
+    }
+    return -1;
+}
+
+static void *menu_loader_thread(void *arg) {
+    LWP_MutexLock(loader_mutex);
+    while (loader_running) {
+        // The highlighted level might be played next
+        if (selected_level >= 0 && prefetched_id != selected_level) {
+            int id = selected_level;
+            FileOrFolder *entry = &sd_level_paths[id];
+            u32 generation = level_generation;
+            u32 entry_generation = folder_generation;
+            bool needs_metadata = (entry->state == ENTRY_NEEDS_METADATA);
+            char path[MAX_PATH_LEN];
+            snprintf(path, sizeof(path), "%s", entry->name);
+            LWP_MutexUnlock(loader_mutex);
+
+            size_t size = 0;
+            read_generation = generation;
+            char *data = read_file_chunked(path, MENU_LOADER_CHUNK_SIZE, keep_reading_level, &size);
+
+            // Not in the index, take it from this copy instead of reading the level again
+            LevelMetadata meta;
+            bool song_found = FALSE;
+            if (needs_metadata && data) {
+                parse_level_metadata(data, &meta);
+                song_found = (meta.song_id >= 0 && check_song(meta.song_id));
+            }
+
+            LWP_MutexLock(loader_mutex);
+            if (needs_metadata && data && entry_generation == folder_generation && entry->state == ENTRY_NEEDS_METADATA) {
+                entry->meta = meta;
+                entry->song_found = song_found;
+                entry->state = ENTRY_READY;
+                index_dirty = TRUE;
+            }
+            if (generation == level_generation) {
+                // Even a failed read is kept, so it isn't retried in a loop
+                free(prefetched_level);
+                prefetched_level = data;
+                prefetched_size = size;
+                prefetched_id = id;
+            } else {
+                free(data);
+            }
+            LWP_CondBroadcast(loader_cond);
+            continue;
+        }
+
+        int id = find_pending_entry();
+        if (id >= 0) {
+            FileOrFolder *entry = &sd_level_paths[id];
+            u32 generation = folder_generation;
+            int state = entry->state;
+            LevelMetadata meta = entry->meta;
+            char path[MAX_PATH_LEN];
+            snprintf(path, sizeof(path), "%s", entry->name);
+            LWP_MutexUnlock(loader_mutex);
+
+            if (state == ENTRY_NEEDS_METADATA) read_level_metadata(path, generation, &meta);
+            bool song_found = (meta.song_id >= 0 && check_song(meta.song_id));
+
+            LWP_MutexLock(loader_mutex);
+            if (generation == folder_generation) {
+                entry->meta = meta;
+                entry->song_found = song_found;
+                entry->state = ENTRY_READY;
+                if (state == ENTRY_NEEDS_METADATA) index_dirty = TRUE;
+            }
+            LWP_CondBroadcast(loader_cond);
+            continue;
+        }
+
+        // Everything in the folder is known, save it for next time
+        if (index_dirty) {
+            char directory[MAX_PATH_LEN];
+            snprintf(directory, sizeof(directory), "%s", loader_directory);
+
+            LevelMetadata *entries = malloc(sd_level_count * sizeof(LevelMetadata));
+            int count = 0;
+            for (int i = 0; entries && i < sd_level_count; i++) {
+                if (!sd_level_paths[i].is_dir) entries[count++] = sd_level_paths[i].meta;
+            }
+            index_dirty = FALSE;
+            LWP_MutexUnlock(loader_mutex);
+
+            if (entries) write_level_index(directory, entries, count);
+            free(entries);
+
+            LWP_MutexLock(loader_mutex);
+            continue;
+        }
+
+        LWP_CondWait(loader_cond, loader_mutex);
+    }
+    LWP_MutexUnlock(loader_mutex);
+    return NULL;
+}
+
+void start_menu_loader() {
+    if (loader_thread != LWP_THREAD_NULL) return;
+
+    LWP_MutexInit(&loader_mutex, FALSE);
+    LWP_CondInit(&loader_cond);
+
+    selected_level = -1;
+    prefetched_id = -1;
+
+    loader_running = TRUE;
+    if (LWP_CreateThread(&loader_thread, menu_loader_thread, NULL, loader_stack, MENU_LOADER_STACK_SIZE, MENU_LOADER_PRIORITY) < 0) {
+        output_log("Couldn't start the menu loader thread\n");
+        loader_running = FALSE;
+        loader_thread = LWP_THREAD_NULL;
+    }
+}
+
+void stop_menu_loader() {
+    if (loader_thread == LWP_THREAD_NULL) return;
+
+    LWP_MutexLock(loader_mutex);
+    loader_running = FALSE;
+    LWP_CondBroadcast(loader_cond);
+    LWP_MutexUnlock(loader_mutex);
+
+    LWP_JoinThread(loader_thread, NULL);
+    loader_thread = LWP_THREAD_NULL;
+
+    LWP_CondDestroy(loader_cond);
+    LWP_MutexDestroy(loader_mutex);
+
+    free(prefetched_level);
+    prefetched_level = NULL;
+    prefetched_id = -1;
+}
+
+void lock_menu_loader() {
+    if (loader_thread != LWP_THREAD_NULL) LWP_MutexLock(loader_mutex);
+}
+
+void unlock_menu_loader() {
+    if (loader_thread != LWP_THREAD_NULL) LWP_MutexUnlock(loader_mutex);
+}
+
+// Call with the loader locked, after sd_level_paths was filled again
+void menu_loader_folder_changed(const char *directory, bool dirty) {
+    snprintf(loader_directory, sizeof(loader_directory), "%s", directory);
+    folder_generation++;
+    index_dirty = dirty;
+
+    level_generation++;
+    selected_level = -1;
+    free(prefetched_level);
+    prefetched_level = NULL;
+    prefetched_id = -1;
+
+    if (loader_thread != LWP_THREAD_NULL) LWP_CondBroadcast(loader_cond);
+}
+
+static void select_level(int id) {
+    // Folders have nothing to read ahead
+    if (id >= 0 && (id >= sd_level_count || sd_level_paths[id].is_dir)) id = -1;
+    if (id == selected_level) return;
+
+    selected_level = id;
+    if (prefetched_id != id) {
+        // Cancels a read of the level highlighted before
+        level_generation++;
+        free(prefetched_level);
+        prefetched_level = NULL;
+        prefetched_id = -1;
+    }
+    LWP_CondBroadcast(loader_cond);
+}
+
+void menu_loader_select(int id) {
+    if (loader_thread == LWP_THREAD_NULL) return;
+
+    LWP_MutexLock(loader_mutex);
+    select_level(id);
+    LWP_MutexUnlock(loader_mutex);
+}
+
+// Hands over the level if it was read ahead already. Otherwise it returns NULL
+// right away, the level loader reads it behind the progress bar.
+char *take_prefetched_level(int id, size_t *out_size) {
+    if (loader_thread == LWP_THREAD_NULL) return NULL;
+
+    char *data = NULL;
+
+    LWP_MutexLock(loader_mutex);
+    if (prefetched_id == id && prefetched_level) {
+        data = prefetched_level;
+        *out_size = prefetched_size;
+        prefetched_level = NULL;
+        prefetched_id = -1;
+        selected_level = -1;
+    }
+    LWP_MutexUnlock(loader_mutex);
+
+    return data;
+}
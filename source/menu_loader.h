@@ -0,0 +1,27 @@
+#pragma once
+#include <gctypes.h>
+#include <stddef.h>
+
+#include "menu.h"
+
+// Background thread of the SD level browser. It fills in the metadata of
+// levels missing from the folder index, nearest to the highlighted one
+// first, and reads the highlighted level ahead so loading it can skip the
+// SD card.
+#define MENU_LOADER_STACK_SIZE (32 * 1024)
+// Below the main thread, so it only runs while it waits for the retrace
+#define MENU_LOADER_PRIORITY 40
+// Levels are read in pieces so moving to another one cancels the read quickly
+#define MENU_LOADER_CHUNK_SIZE (64 * 1024)
+
+void start_menu_loader();
+void stop_menu_loader();
+
+// Held while the main thread changes or reads sd_level_paths
+void lock_menu_loader();
+void unlock_menu_loader();
+
+LevelMetadata *read_level_index(const char *directory, int *out_count);
+void menu_loader_folder_changed(const char *directory, bool index_dirty);
+void menu_loader_select(int id);
+char *take_prefetched_level(int id, size_t *out_size);
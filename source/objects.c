@@ -24,6 +24,8 @@
 #include "triggers.h"
 
 #include "groups.h"
+#include "profiler.h"
+#include "song_analysis.h"
 
 AnimationDefinition monster_1_anim;
 AnimationDefinition monster_2_anim;
@@ -41,6 +43,34 @@ FramesDefinition water_3_anim;
 FramesDefinition loading_1_anim;
 FramesDefinition loading_2_anim;
 
+// Animations are only loaded when a level uses an object that needs them
+typedef struct {
+    int object_id;
+    AnimationDefinition *anim;
+    AnimationDefinition (*prepare_anim)();
+    FramesDefinition *frames;
+    FramesDefinition (*prepare_frames)();
+    int refs;
+} ObjAnimationAsset;
+
+ObjAnimationAsset obj_animation_assets[] = {
+    { MONSTER_1,          &monster_1_anim,    prepare_monster_1_animation,    NULL,            NULL,                        0 },
+    { MONSTER_2,          &monster_2_anim,    prepare_monster_2_animation,    NULL,            NULL,                        0 },
+    { MONSTER_3,          &monster_3_anim,    prepare_monster_3_animation,    NULL,            NULL,                        0 },
+    { BLACK_SLUDGE,       &black_sludge_anim, prepare_black_sludge_animation, NULL,            NULL,                        0 },
+    { FIRE_1,             NULL,               NULL,                           &fire1_anim,     prepare_fire_1_animation,    0 },
+    { FIRE_2,             NULL,               NULL,                           &fire2_anim,     prepare_fire_2_animation,    0 },
+    { FIRE_3,             NULL,               NULL,                           &fire3_anim,     prepare_fire_3_animation,    0 },
+    { FIRE_4,             NULL,               NULL,                           &fire4_anim,     prepare_fire_4_animation,    0 },
+    { ANIMATED_WATER_1,   NULL,               NULL,                           &water_1_anim,   prepare_water_1_animation,   0 },
+    { ANIMATED_WATER_2,   NULL,               NULL,                           &water_2_anim,   prepare_water_2_animation,   0 },
+    { ANIMATED_WATER_3,   NULL,               NULL,                           &water_3_anim,   prepare_water_3_animation,   0 },
+    { ANIMATED_LOADING_1, NULL,               NULL,                           &loading_1_anim, prepare_loading_1_animation, 0 },
+    { ANIMATED_LOADING_2, NULL,               NULL,                           &loading_2_anim, prepare_loading_2_animation, 0 },
+};
+
+#define OBJ_ANIMATION_ASSET_COUNT (sizeof(obj_animation_assets) / sizeof(ObjAnimationAsset))
+
 GRRLIB_texImg *prev_tex = NULL;
 int prev_blending = GRRLIB_BLEND_ALPHA;
 
@@ -1023,109 +1053,68 @@ int current_fading_effect = FADE_NONE;
 
 bool p1_trail = FALSE;
 
-int find_existing_texture(const unsigned char *texture) {
-    for (s32 object = 1; object < OBJECT_COUNT; object++) {
-        for (s32 layer = 0; layer < MAX_OBJECT_LAYERS; layer++) {
-            const unsigned char *loaded_texture = objects[object].layers[layer].texture;
-            if (loaded_texture == texture) {
-                return (object * MAX_OBJECT_LAYERS) + layer;
-            }
-        }
-    }
-    return -1;
-}
+void load_spritesheet() {
+    // Load Textures 
+    ground_line = load_texture(ground_line_png);
+    level_complete_texture = load_texture(levelCompleteText_png);
 
-int find_existing_previous_texture(int current_object, const unsigned char *texture) {
-    for (s32 object = 1; object < current_object; object++) {
-        for (s32 layer = 0; layer < MAX_OBJECT_LAYERS; layer++) {
-            const unsigned char *loaded_texture = objects[object].layers[layer].texture;
-            if (loaded_texture == texture) {
-                return (object * MAX_OBJECT_LAYERS) + layer;
-            }
-        }
-    }
-    return -1;
+    load_icons();
 }
 
-void load_spritesheet() {
-    // Load Textures 
-    ground_line = GRRLIB_LoadTexturePNG(ground_line_png);
-    level_complete_texture = GRRLIB_LoadTexturePNG(levelCompleteText_png);
-    monster_1_anim = prepare_monster_1_animation();
-    monster_2_anim = prepare_monster_2_animation();
-    monster_3_anim = prepare_monster_3_animation();
-    black_sludge_anim = prepare_black_sludge_animation();
-    fire1_anim = prepare_fire_1_animation();
-    fire2_anim = prepare_fire_2_animation();
-    fire3_anim = prepare_fire_3_animation();
-    fire4_anim = prepare_fire_4_animation();
-    
-    water_1_anim = prepare_water_1_animation();
-    water_2_anim = prepare_water_2_animation();
-    water_3_anim = prepare_water_3_animation();
+void acquire_obj_animation(int object) {
+    for (u32 i = 0; i < OBJ_ANIMATION_ASSET_COUNT; i++) {
+        ObjAnimationAsset *asset = &obj_animation_assets[i];
+        if (asset->object_id != object) continue;
 
-    loading_1_anim = prepare_loading_1_animation();
-    loading_2_anim = prepare_loading_2_animation();
+        // First object that uses it loads it
+        if (asset->refs++ > 0) return;
 
-    load_icons();
+        output_log_level(LOG_DEBUG, "Loading animation of object %d\n", object);
+        if (asset->anim) {
+            *asset->anim = asset->prepare_anim();
+        } else {
+            *asset->frames = asset->prepare_frames();
+        }
+        return;
+    }
 }
 
-void load_layer_texture(const u8 *texture, int object, int layer) {
-    GRRLIB_texImg *image = GRRLIB_LoadTexturePNG((const u8 *) texture);
-    if (image == NULL || image->data == NULL) {
-        printf("Couldn't load texture of object %d layer %d\n", object, layer);
+static void unload_obj_animation(ObjAnimationAsset *asset) {
+    output_log_level(LOG_DEBUG, "Unloading animation of object %d\n", asset->object_id);
+    if (asset->anim) {
+        unload_animation_definition(*asset->anim);
+        memset(asset->anim, 0, sizeof(AnimationDefinition));
     } else {
-        GRRLIB_SetHandle(image, (image->w/2), (image->h/2));
-        object_images[object][layer] = image;
+        unload_frame_definition(*asset->frames);
+        memset(asset->frames, 0, sizeof(FramesDefinition));
     }
+    asset->refs = 0;
 }
 
-void load_obj_textures(int object) {
-    if (is_object_unimplemented(object)) return;
-
-    // Skip unused layers
-    for (s32 layer = 0; layer < MAX_OBJECT_LAYERS; layer++) {
-        const unsigned char *texture = objects[object].layers[layer].texture;
-        if (!texture) continue;
-
-        // Skip if already loaded
-        if (object_images[object][layer]) continue;
-        
-        int existing = find_existing_texture(texture);
+// Called as each object using it is freed, the last one unloads it
+void release_obj_animation(int object) {
+    for (u32 i = 0; i < OBJ_ANIMATION_ASSET_COUNT; i++) {
+        ObjAnimationAsset *asset = &obj_animation_assets[i];
+        if (asset->object_id != object) continue;
 
-        if (existing < 0) {
-            output_log("Loading texture of object %d layer %d\n", object, layer);
-            load_layer_texture((const u8 *) texture, object, layer);
-        } else {
-            int object_found = existing / MAX_OBJECT_LAYERS;
-            int layer_found = existing % MAX_OBJECT_LAYERS;
-
-            if (object_images[object_found][layer_found]) {
-                output_log("Found texture of object %d layer %d in object %d layer %d: %p\n", object, layer, object_found, layer_found, object_images[object_found][layer_found]);
-            } else {
-                const unsigned char *texture = objects[object_found].layers[layer_found].texture;
-                output_log("Loading texture of object %d layer %d\n", object_found, layer_found);
-                load_layer_texture((const u8 *) texture, object_found, layer_found);
-            }
-            object_images[object][layer] = object_images[object_found][layer_found];
-        }
+        if (asset->refs > 0 && --asset->refs == 0) unload_obj_animation(asset);
+        return;
     }
 }
 
-void unload_obj_textures() {
-    for (s32 object = 0; object < OBJECT_COUNT; object++) {
-        for (s32 layer = 0; layer < MAX_OBJECT_LAYERS; layer++) {
-            const unsigned char *texture = objects[object].layers[layer].texture;
-            if (!texture) continue;
+// Unloads what is still held, like the end wall animations loaded outside of the level data
+void release_obj_animations() {
+    for (u32 i = 0; i < OBJ_ANIMATION_ASSET_COUNT; i++) {
+        ObjAnimationAsset *asset = &obj_animation_assets[i];
+        if (asset->refs > 0) unload_obj_animation(asset);
+    }
+}
 
-            int existing = find_existing_previous_texture(object, texture);
-            // Dont double free textures
-            if (existing < 0) {
-                GRRLIB_FreeTexture(object_images[object][layer]);
-            }
-            object_images[object][layer] = NULL;
-        }
+ObjAnimationAsset *get_obj_animation_asset(int object) {
+    for (u32 i = 0; i < OBJ_ANIMATION_ASSET_COUNT; i++) {
+        if (obj_animation_assets[i].object_id == object) return &obj_animation_assets[i];
     }
+    return NULL;
 }
 
 void unload_spritesheet() {
@@ -1133,17 +1122,7 @@ void unload_spritesheet() {
     GRRLIB_FreeTexture(ground_line);
     GRRLIB_FreeTexture(big_font_text);
     
-    unload_animation_definition(monster_1_anim);
-    unload_animation_definition(black_sludge_anim);
-    unload_frame_definition(fire1_anim);
-    unload_frame_definition(fire2_anim);
-    unload_frame_definition(fire3_anim);
-    unload_frame_definition(fire4_anim);
-    unload_frame_definition(water_1_anim);
-    unload_frame_definition(water_2_anim);
-    unload_frame_definition(water_3_anim);
-    unload_frame_definition(loading_1_anim);
-    unload_frame_definition(loading_2_anim);
+    release_obj_animations();
 
     unload_icons();
 }
@@ -1451,7 +1430,7 @@ void get_fade_vars(GameObject *obj, float x, int *fade_x, int *fade_y, float *fa
     }
 }
 
-int layer_pulses(GameObject *obj, GDObjectLayer *layer) {
+int obj_pulses(GameObject *obj) {
     switch (*soa_id(obj)) {
         case YELLOW_ORB:
         case BLUE_ORB:
@@ -1476,19 +1455,27 @@ int layer_pulses(GameObject *obj, GDObjectLayer *layer) {
         case PULSING_BIG_SQUARE:
         case PULSING_BIG_SQUARE_OUTLINE:
         case PULSING_BIG_CIRCLE:
-            return 1;
         case ROD_BIG:
         case ROD_MEDIUM:
         case ROD_SMALL:
-            if (layer->layerNum == 1) {
-                return 1;
-            }
-            break;
+            return 1;
     }
 
     return 0;
 }
 
+int layer_pulses(GameObject *obj, GDObjectLayer *layer) {
+    switch (*soa_id(obj)) {
+        case ROD_BIG:
+        case ROD_MEDIUM:
+        case ROD_SMALL:
+            // Only the ball
+            return layer->layerNum == 1;
+    }
+
+    return obj_pulses(obj);
+}
+
 float get_object_pulse(float amplitude, GameObject *obj) {
     switch (*soa_id(obj)) {
         case YELLOW_ORB:
@@ -1532,6 +1519,7 @@ GRRLIB_texImg *get_randomized_texture(GRRLIB_texImg *image, GameObject *obj, GDO
         case ROD_MEDIUM:
         case ROD_SMALL:
             if (layer->layerNum == 1) {
+                touch_obj_textures(ROD_BIG);
                 return object_images[ROD_BIG][level_info.pulsing_type + 1]; // balls start at 1
             }
             break;
@@ -1553,9 +1541,9 @@ GRRLIB_texImg *get_coin_particle_texture() {
 void load_coin_texture() {
     for (s32 i = 0; i < NUM_COIN_FRAMES; i++) {
         if (level_info.level_is_custom) {
-            current_coin_texture[i] = GRRLIB_LoadTexturePNG(user_coin_layer[i].texture);
+            current_coin_texture[i] = load_texture(user_coin_layer[i].texture);
         } else {
-            current_coin_texture[i] = GRRLIB_LoadTexturePNG(secret_coin_layer[i].texture);
+            current_coin_texture[i] = load_texture(secret_coin_layer[i].texture);
         }
         GRRLIB_SetHandle(current_coin_texture[i], current_coin_texture[i]->w / 2, current_coin_texture[i]->h / 2);
     }
@@ -1816,13 +1804,15 @@ GRRLIB_texImg *get_animated_texture(GameObject *obj, int layer_num, float *scale
     return NULL;
 }
 
-void put_object_layer(GameObject *obj, float x, float y, GDObjectLayer *layer) {
+void put_object_layer(GameObject *obj, ObjRenderState *render, GDObjectLayer *layer) {
     int obj_id = *soa_id(obj);
 
     int layer_index = layer->layerNum;
 
     struct ObjectLayer *objectLayer = layer->layer;
 
+    touch_obj_textures(obj_id);
+
     GRRLIB_texImg *tex = get_randomized_texture(object_images[obj_id][layer_index], obj, layer);
     float default_scale = 1;
     bool flip_x = FALSE;
@@ -1831,6 +1821,8 @@ void put_object_layer(GameObject *obj, float x, float y, GDObjectLayer *layer) {
         tex = get_animated_texture(obj, layer->layerNum, &default_scale, &flip_x);
     }
 
+    if (!tex) return;
+
     int x_flip_mult = (obj->flippedH ^ flip_x ? -1 : 1);
     int y_flip_mult = (obj->flippedV ? -1 : 1);
 
@@ -1849,45 +1841,26 @@ void put_object_layer(GameObject *obj, float x, float y, GDObjectLayer *layer) {
         blending = GRRLIB_BLEND_ALPHA;
     }
 
-    int opacity = get_opacity(obj, x);
-    int unmodified_opacity = opacity;
-    
-    if (objects[obj_id].fades) {
-        opacity *= get_fading_obj_fade(obj, x, screenWidth);
-    }
+    int opacity = render->opacity;
 
     u32 color = get_layer_color(obj, objectLayer->color_type, col_channel, opacity, objectLayer->col_channel);
 
     // If it is invisible because of blending, skip
     if ((blending == GRRLIB_BLEND_ADD && !(color & ~0xff)) || opacity == 0) return;
-        
-    float angle_rad = DegToRad(obj->rotation); // Convert degrees to radians
-    float cos_a = cosf(angle_rad);
-    float sin_a = sinf(angle_rad);
-
-    float x_off_rot = (x_offset * cos_a - y_offset * sin_a) * state.mirror_mult;
-    float y_off_rot = x_offset * sin_a + y_offset * cos_a;
-
-    int fade_x = 0;
-    int fade_y = 0;
 
-    float fade_scale = 1.f;
+    float x_off_rot = (x_offset * render->cos_a - y_offset * render->sin_a) * state.mirror_mult;
+    float y_off_rot = x_offset * render->sin_a + y_offset * render->cos_a;
 
-    if (!obj->object.dont_enter) get_fade_vars(obj, x, &fade_x, &fade_y, &fade_scale);
+    float fade_scale = render->fade_scale;
 
     // Get scaling because of music
     if (layer_pulses(obj, layer)) {
-        if (level_info.custom_song_id <= 0) {
-            obj->ampl_scaling = ease_out(obj->ampl_scaling, get_object_pulse(amplitude, obj), 0.25f);
-        } else {
-            obj->ampl_scaling = get_object_pulse(amplitude, obj);
-        }
-        fade_scale *= obj->ampl_scaling;
+        fade_scale *= render->pulse_scale;
     }
 
     fade_scale *= default_scale;
 
-    float rotation = adjust_angle(obj->rotation, 0, state.mirror_mult < 0);
+    float rotation = render->rotation;
 
     // Handle rod ball spawn
     switch(obj_id) {
@@ -1901,18 +1874,8 @@ void put_object_layer(GameObject *obj, float x, float y, GDObjectLayer *layer) {
             }
     }
 
-    if (!obj->object.dont_enter) {
-        // Handle special fade types
-        if (obj->transition_applied == FADE_DOWN_STATIONARY || obj->transition_applied == FADE_UP_STATIONARY) {
-            if (unmodified_opacity < 255) {
-                if (x > screenWidth / 2) {
-                    x = screenWidth - FADE_WIDTH;
-                } else {
-                    x = FADE_WIDTH;
-                }
-            }
-        }
-    }
+    float x = render->draw_x;
+    float y = render->calc_y;
     
     if (prev_tex != tex) {
         prev_tex = tex;
@@ -1927,20 +1890,19 @@ void put_object_layer(GameObject *obj, float x, float y, GDObjectLayer *layer) {
 
 
     if (*soa_id(obj) == TEXT_OBJ) {
-        draw_rotated_text(
-            /* Font     */ *font_charsets[level_info.font_used], level_font, 
+        draw_rotated_text_layout(
+            /* Layout   */ obj->object.text_layout, level_font, 
             /* X        */ get_mirror_x(x, state.mirror_factor),
             /* Y        */ y,
             /* Rotation */ rotation,
             /* Scale X  */ BASE_SCALE * x_flip_mult * fade_scale * state.mirror_mult * obj->scale_x,
             /* Scale Y  */ BASE_SCALE * y_flip_mult * fade_scale * obj->scale_y, 
-            /* Color    */ color,
-            /* Text     */ obj->object.text
+            /* Color    */ color
         );
     } else {
         custom_drawImg(
-            /* X        */ get_mirror_x(x, state.mirror_factor) + 6 - (width/2) + x_off_rot + fade_x,
-            /* Y        */ y + 6 - (height/2) + y_off_rot + fade_y,
+            /* X        */ get_mirror_x(x, state.mirror_factor) + 6 - (width/2) + x_off_rot + render->fade_x,
+            /* Y        */ y + 6 - (height/2) + y_off_rot + render->fade_y,
             /* Texture  */ tex, 
             /* Rotation */ rotation, 
             /* Scale X  */ BASE_SCALE * x_flip_mult * fade_scale * state.mirror_mult * obj->scale_x, 
@@ -1950,7 +1912,6 @@ void put_object_layer(GameObject *obj, float x, float y, GDObjectLayer *layer) {
     }
 }
 
-
 void draw_background_image(f32 x, f32 y, bool vflip) {
     for (s32 i = 0; i < BG_DIMENSIONS; i++) {
         float calc_x = i*BG_CHUNK - widthAdjust;
@@ -2172,6 +2133,209 @@ void handle_special_fading(GameObject *obj, float calc_x, float calc_y) {
     }   
 }
 
+ObjRenderState render_states[MAX_VISIBLE_LAYERS];
+int render_state_count = 0;
+int render_trig_calls = 0;
+
+ObjRenderState *get_render_state(GameObject *obj) {
+    if (obj->render_index < render_state_count && render_states[obj->render_index].obj == obj) {
+        return &render_states[obj->render_index];
+    }
+    return NULL;
+}
+
+// Distance from the center of the layer to its furthest corner, in screen pixels
+float get_layer_extent(float x_offset, float y_offset, int width, int height, float scale) {
+    return sqrtf(x_offset * x_offset + y_offset * y_offset) + sqrtf(width * width + height * height) * 0.5f * BASE_SCALE * scale;
+}
+
+float get_texture_extent(const u8 *texture, float x_offset, float y_offset, float scale) {
+    int width, height;
+    if (!texture || !get_texture_dimensions(texture, &width, &height)) return 0;
+    return get_layer_extent(x_offset, y_offset, width, height, scale);
+}
+
+float get_animation_extent(AnimationDefinition *definition) {
+    float extent = 0;
+    if (!definition->anim) return 0;
+
+    Animation *anim = definition->anim;
+    for (int frame = 0; frame < anim->frameCount; frame++) {
+        for (int i = 0; i < definition->part_count; i++) {
+            AnimationPart *part = &definition->parts[i];
+            const SpritePart *sprite = &anim->frames[frame * anim->partCount + part->part_id];
+            if (!part->texture) continue;
+
+            // Part offsets are in level units
+            float part_scale = MAX(fabsf(sprite->sx), fabsf(sprite->sy));
+            extent = MAX(extent, get_layer_extent(sprite->x * SCALE, sprite->y * SCALE, part->texture->w, part->texture->h, part_scale));
+        }
+    }
+    return extent;
+}
+
+float get_frames_extent(int obj_id, FramesDefinition *definition) {
+    float extent = 0;
+    for (int frame = 0; frame < definition->frame_count; frame++) {
+        for (int i = 0; i < definition->frames[frame].layer_count; i++) {
+            FrameLayer *layer = &definition->frames[frame].layers[i];
+            if (!layer->texture) continue;
+
+            const struct ObjectLayer *object_layer = &objects[obj_id].layers[layer->layer_num];
+            extent = MAX(extent, get_layer_extent(object_layer->x_offset, object_layer->y_offset, layer->texture->w, layer->texture->h, layer->scale));
+        }
+    }
+    return extent;
+}
+
+float get_hitbox_extent(GameObject *obj) {
+    ObjectHitbox *hitbox = (ObjectHitbox *) &objects[*soa_id(obj)].hitbox;
+
+    float half_size;
+    if (objects[*soa_id(obj)].is_slope) {
+        half_size = sqrtf(obj->width * obj->width + obj->height * obj->height) * 0.5f;
+    } else if (hitbox->radius != 0) {
+        half_size = hitbox->radius;
+    } else {
+        half_size = sqrtf(hitbox->width * hitbox->width + hitbox->height * hitbox->height) * 0.5f;
+    }
+
+    return (sqrtf(hitbox->x_off * hitbox->x_off + hitbox->y_off * hitbox->y_off) + half_size) * SCALE;
+}
+
+void compute_cull_radius(GameObject *obj) {
+    int obj_id = *soa_id(obj);
+    float extent = 0;
+
+    ObjAnimationAsset *asset = get_obj_animation_asset(obj_id);
+
+    if (obj_id == TEXT_OBJ) {
+        // Text is centered on the object
+        TextLayout *layout = obj->object.text_layout;
+        float length = (layout ? layout->length * BASE_SCALE : 0) * 0.5f;
+        float height = 32 * BASE_SCALE;
+        extent = sqrtf(length * length + height * height);
+    } else if (asset && asset->anim) {
+        extent = get_animation_extent(asset->anim);
+    } else if (asset && asset->frames) {
+        extent = get_frames_extent(obj_id, asset->frames);
+    } else if (obj_id == SECRET_COIN) {
+        extent = get_texture_extent(secret_coin_layer[0].texture, 0, 0, 1.f);
+    } else {
+        for (int layer = 0; layer < MAX_OBJECT_LAYERS; layer++) {
+            const struct ObjectLayer *object_layer = &objects[obj_id].layers[layer];
+            extent = MAX(extent, get_texture_extent(object_layer->texture, object_layer->x_offset, object_layer->y_offset, 1.f));
+        }
+
+        // The rod ball comes from the big rod
+        if (obj_id == ROD_MEDIUM || obj_id == ROD_SMALL) {
+            for (int layer = 1; layer < MAX_OBJECT_LAYERS; layer++) {
+                const struct ObjectLayer *object_layer = &objects[ROD_BIG].layers[layer];
+                extent = MAX(extent, get_texture_extent(object_layer->texture, objects[obj_id].layers[1].x_offset, objects[obj_id].layers[1].y_offset, 1.f));
+            }
+        }
+    }
+
+    if (obj_pulses(obj)) extent *= 1.2f;
+
+    extent *= MAX(1.f, MAX(fabsf(obj->scale_x), fabsf(obj->scale_y)));
+
+    // The hitbox display uses the same radius
+    extent = MAX(extent, get_hitbox_extent(obj) * MAX(fabsf(obj->scale_x), fabsf(obj->scale_y)));
+
+    // Layers are drawn 6 pixels to the bottom right of the object
+    *soa_cull_radius(obj) = extent + CULL_DRAW_MARGIN;
+}
+
+static inline bool obj_in_view(GameObject *obj, float calc_x, float calc_y) {
+    float radius = *soa_cull_radius(obj);
+
+    // Fade transitions move and scale the layers
+    if (obj->transition_applied != FADE_NONE) radius = radius * CULL_FADE_SCALE + CULL_FADE_OFFSET;
+
+    return calc_x > -radius && calc_x < screenWidth + radius &&
+           calc_y > -radius && calc_y < screenHeight + radius;
+}
+
+void update_object_render_state(GameObject *obj) {
+    int obj_id = *soa_id(obj);
+
+    ObjRenderState *render = &render_states[render_state_count];
+    obj->render_index = render_state_count++;
+    render->obj = obj;
+
+    float calc_x = ((*soa_x(obj) - state.camera_x) * SCALE) - widthAdjust;
+    float calc_y = screenHeight - ((*soa_y(obj) - state.camera_y) * SCALE);
+
+    int fade_val = get_fade_value(calc_x, screenWidth);
+    bool fade_edge = (fade_val == 255 || fade_val == 0);
+
+    // Fade objects
+    if (fade_edge) handle_special_fading(obj, calc_x, calc_y);
+    // If saw, rotate
+    if ((objects[obj_id].is_saw || obj_id == GREEN_ORB) && !state.paused) {
+        obj->rotation += (((obj->random & 1) ? -get_rotation_speed(obj) : get_rotation_speed(obj))) * dt ;
+    }
+
+    if (objects[obj_id].frame_animation) {
+        obj->object.animation_timer += dt;
+    }
+
+    if (obj->has_two_channels && channels[obj->object.main_col_channel].blending && channels[obj->object.detail_col_channel].blending) {
+        obj->both_channels_blending = TRUE;
+    } else {
+        obj->both_channels_blending = FALSE;
+    }
+
+    render->calc_x = calc_x;
+    render->calc_y = calc_y;
+    render->fade_value = fade_val;
+
+    int opacity = get_opacity(obj, calc_x);
+    int unmodified_opacity = opacity;
+
+    if (objects[obj_id].fades) {
+        opacity *= get_fading_obj_fade(obj, calc_x, screenWidth);
+    }
+    render->opacity = opacity;
+
+    float angle_rad = DegToRad(obj->rotation); // Convert degrees to radians
+    render->cos_a = cosf(angle_rad);
+    render->sin_a = sinf(angle_rad);
+    trig_calls += 2;
+    render->rotation = adjust_angle(obj->rotation, 0, state.mirror_mult < 0);
+
+    render->fade_x = 0;
+    render->fade_y = 0;
+    render->fade_scale = 1.f;
+
+    if (!obj->object.dont_enter) get_fade_vars(obj, calc_x, &render->fade_x, &render->fade_y, &render->fade_scale);
+
+    // Get scaling because of music
+    if (obj_pulses(obj)) {
+        if (level_info.custom_song_id <= 0) {
+            obj->ampl_scaling = ease_out(obj->ampl_scaling, get_object_pulse(amplitude, obj), 0.25f);
+        } else {
+            obj->ampl_scaling = get_object_pulse(amplitude, obj);
+        }
+    }
+    render->pulse_scale = obj->ampl_scaling;
+
+    render->draw_x = calc_x;
+    if (!obj->object.dont_enter) {
+        // Handle special fade types
+        if (obj->transition_applied == FADE_DOWN_STATIONARY || obj->transition_applied == FADE_UP_STATIONARY) {
+            if (unmodified_opacity < 255) {
+                if (calc_x > screenWidth / 2) {
+                    render->draw_x = screenWidth - FADE_WIDTH;
+                } else {
+                    render->draw_x = FADE_WIDTH;
+                }
+            }
+        }
+    }
+}
+
 int layersDrawn = 0;
 
 int compare_by_layer_index(const void *a, const void *b) {
@@ -2188,19 +2352,19 @@ int compare_by_layer_index(const void *a, const void *b) {
     return la->originalIndex - lb->originalIndex;
 }
 
-void play_object_animation(GameObject *obj) {
+void play_object_animation(GameObject *obj, ObjRenderState *render) {
     switch (*soa_id(obj)) {
         case MONSTER_1:
-            playObjAnimation(obj, monster_1_anim, obj->object.animation_timer);
+            playObjAnimation(obj, render, monster_1_anim, obj->object.animation_timer);
             break;
         case MONSTER_2:
-            playObjAnimation(obj, monster_2_anim, obj->object.animation_timer);
+            playObjAnimation(obj, render, monster_2_anim, obj->object.animation_timer);
             break;
         case MONSTER_3:
-            playObjAnimation(obj, monster_3_anim, obj->object.animation_timer);
+            playObjAnimation(obj, render, monster_3_anim, obj->object.animation_timer);
             break;
         case BLACK_SLUDGE:
-            playObjAnimation(obj, black_sludge_anim, obj->object.animation_timer);
+            playObjAnimation(obj, render, black_sludge_anim, obj->object.animation_timer);
             break;
     }
     obj->object.animation_timer += dt;
@@ -2279,6 +2443,8 @@ static inline void insertion_sort_by_layer(GDLayerSortable **arr, int n) {
 #undef MASK
 
 void draw_all_object_layers() {
+    PROFILE_SCOPE("draw_all_object_layers");
+    PROFILE_BEGIN("sort_layers");
     u64 t0 = gettime();
     if (GRRLIB_Settings.antialias == false) {
         GX_SetCopyFilter(GX_FALSE, rmode->sample_pattern, GX_FALSE, rmode->vfilter);
@@ -2306,25 +2472,11 @@ void draw_all_object_layers() {
                 
                 float calc_x = ((*soa_x(obj) - state.camera_x) * SCALE) - widthAdjust;
                 float calc_y = screenHeight - ((*soa_y(obj) - state.camera_y) * SCALE);  
-                
-                int offscreen_area = 90;
-
-                // Those are way bigger
-                switch (*soa_id(obj)) {
-                    case RAINBOW_ARC_SMALL:
-                        offscreen_area = 120;
-                        break;
-                    case RAINBOW_ARC_BIG:
-                        offscreen_area = 240;
-                        break;
-                }
 
-                if (!obj->toggled && calc_x > -offscreen_area && calc_x < screenWidth + offscreen_area) {        
-                    if (calc_y > -offscreen_area && calc_y < screenHeight + offscreen_area) {    
-                        if (visible_count < MAX_VISIBLE_LAYERS) {
-                            // Add to visible layers, as it can be seen
-                            visible_layers[visible_count++] = sec->layers[i];
-                        }
+                if (!obj->toggled && obj_in_view(obj, calc_x, calc_y)) {
+                    if (visible_count < MAX_VISIBLE_LAYERS) {
+                        // Add to visible layers, as it can be seen
+                        visible_layers[visible_count++] = sec->layers[i];
                     }
                 }
             }
@@ -2392,6 +2544,20 @@ void draw_all_object_layers() {
     
     u64 t1 = gettime();
     layer_sorting = ticks_to_microsecs(t1 - t0) / 1000.f;
+    PROFILE_END();
+    
+    // Compute what all layers of an object share once, layers just add their offsets
+    render_state_count = 0;
+    int trig_calls_start = trig_calls;
+    for (int i = 0; i < visible_count; i++) {
+        GameObject *obj = entries[i].ptr->layer->obj;
+        int obj_id = *soa_id(obj);
+
+        if (obj_id == PLAYER_OBJECT || obj_id >= OBJECT_COUNT) continue;
+        if (get_render_state(obj)) continue;
+
+        update_object_render_state(obj);
+    }
     
     draw_particles(GLITTER_EFFECT);
     layersDrawn = visible_count;
@@ -2408,6 +2574,7 @@ void draw_all_object_layers() {
         if (obj_id == PLAYER_OBJECT) {
             // Draw player related stuff
             u64 t2 = gettime();
+            PROFILE_BEGIN("draw_player");
             draw_particles(DEATH_CIRCLE);
             draw_particles(DEATH_PARTICLES);
             draw_particles(CUBE_DRAG);
@@ -2444,6 +2611,7 @@ void draw_all_object_layers() {
             }
             draw_particles(SHIP_DRAG);
             draw_particles(COIN_OBJ);
+            PROFILE_END();
             u64 t3 = gettime();
             player_draw_time = ticks_to_microsecs(t3 - t2) / 1000.f;
 
@@ -2452,43 +2620,20 @@ void draw_all_object_layers() {
             GRRLIB_SetBlend(prev_blending);
         } else if (obj_id < OBJECT_COUNT) {
             u64 t0 = gettime();
-            float calc_x = ((*soa_x(obj) - state.camera_x) * SCALE) - widthAdjust;
-            float calc_y = screenHeight - ((*soa_y(obj) - state.camera_y) * SCALE);  
-
-            int fade_val = get_fade_value(calc_x, screenWidth);
-            bool fade_edge = (fade_val == 255 || fade_val == 0);
+            ObjRenderState *render = get_render_state(obj);
             bool is_layer0 = (layer->layerNum == 0);
 
-            if (is_layer0) {
-                // Fade objects
-                if (fade_edge) handle_special_fading(obj, calc_x, calc_y);
-                // If saw, rotate
-                if ((objects[obj_id].is_saw || *soa_id(obj) == GREEN_ORB) && !state.paused) {
-                    obj->rotation += (((obj->random & 1) ? -get_rotation_speed(obj) : get_rotation_speed(obj))) * dt ;
-                }
-
-                if (objects[obj_id].frame_animation) {
-                    obj->object.animation_timer += dt;
-                }
-
-                if (obj->has_two_channels && channels[obj->object.main_col_channel].blending && channels[obj->object.detail_col_channel].blending) {
-                    obj->both_channels_blending = TRUE;
-                } else {
-                    obj->both_channels_blending = FALSE;
-                }
-            } 
-
             handle_pre_draw_object_particles(obj, layer); 
             u64 t1 = gettime();
             obj_particles_time += t1 - t0;
 
             t0 = gettime();
             if (is_layer0 && objects[*soa_id(obj)].has_movement) {
-                play_object_animation(obj);
+                play_object_animation(obj, render);
                 set_texture(prev_tex);
                 GRRLIB_SetBlend(prev_blending);
             }
-            else if (!obj->hide_sprite) put_object_layer(obj, calc_x, calc_y, layer);
+            else if (!obj->hide_sprite) put_object_layer(obj, render, layer);
             t1 = gettime();
             draw_time += t1 - t0;
             
@@ -2505,9 +2650,6 @@ void draw_all_object_layers() {
     prev_blending = GRRLIB_BLEND_ALPHA;
     GRRLIB_SetBlend(GRRLIB_BLEND_ALPHA);
 
-    float screen_x_max = screenWidth + 90.0f;
-    float screen_y_max = screenHeight + 90.0f;
-
     if (state.hitbox_display) { 
         GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
         GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
@@ -2520,10 +2662,8 @@ void draw_all_object_layers() {
                     
                     float calc_x = ((*soa_x(obj) - state.camera_x) * SCALE) - widthAdjust;
                     float calc_y = screenHeight - ((*soa_y(obj) - state.camera_y) * SCALE);  
-                    if (calc_x > -90 && calc_x < screen_x_max) {        
-                        if (calc_y > -90 && calc_y < screen_y_max) {    
-                            draw_hitbox(obj);
-                        }
+                    if (obj_in_view(obj, calc_x, calc_y)) {
+                        draw_hitbox(obj);
                     }
                 }
             }
@@ -2543,25 +2683,25 @@ void draw_all_object_layers() {
 
     draw_time = ticks_to_microsecs(draw_time) / 1000.f;
     obj_particles_time = ticks_to_microsecs(obj_particles_time) / 1000.f;
+    render_trig_calls = trig_calls - trig_calls_start;
     
     free(entries);
     
     GX_LoadPosMtxImm(GXmodelView2D, GX_PNMTX0);
 }
 
-u64 last_beat_time = 0;
+int last_beat = -1;
 int pulse_frames_left = 0;
 int beat_pulse = 0;
 
 void update_beat() {
-    const float beat_interval_ms = 60000.f / songs[level_info.song_id].tempo;
-
-    u64 now = gettime();
-    u64 elapsed_ms = ticks_to_millisecs(now - last_beat_time);
+    // Beats follow the song as it is heard, not the wall clock
+    float song_time = song_position;
+    int beat = (int) (song_time * songs[level_info.song_id].tempo / 60.f);
 
     // Check if we've hit the next beat
-    if (elapsed_ms >= beat_interval_ms) {
-        last_beat_time = now;
+    if (beat != last_beat) {
+        last_beat = beat;
         pulse_frames_left = 20;
         beat_pulse = true;
     }
@@ -2574,7 +2714,10 @@ void update_beat() {
         beat_pulse = false;
     }
 
-    if (MP3Player_GetAmplitude() < 0.05f) {
+    if (song_envelope_ready()) {
+        // Nothing hit in the last half second, the song is quiet
+        if (!get_song_onset(song_time - 0.5f, song_time)) beat_pulse = false;
+    } else if (MP3Player_GetAmplitude() < 0.05f) {
         beat_pulse = false;
     }
 }
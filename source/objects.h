@@ -5,6 +5,7 @@
 #include "math.h"
 #include "level_loading.h"
 #include "animation.h"
+#include "textures.h"
 
 #define BACKGROUND_SCALE 0.9
 #define BG_DIMENSIONS 4
@@ -1723,6 +1724,12 @@ typedef struct {
 
 #define MAX_VISIBLE_LAYERS 4096
 
+// Extra pixels added to every object's culling radius
+#define CULL_DRAW_MARGIN 10.f
+// Fade transitions scale layers up to 1.5x and move them up to 127 pixels
+#define CULL_FADE_SCALE 1.5f
+#define CULL_FADE_OFFSET 128.f
+
 #define COMPLETE_TEXT_IN_TIME 0.5f
 
 #define NUM_COIN_FRAMES 4
@@ -1755,8 +1762,10 @@ extern AnimationDefinition monster_1_anim;
 extern AnimationDefinition monster_2_anim;
 extern AnimationDefinition monster_3_anim;
 
-void load_obj_textures(int object);
-void unload_obj_textures();
+void acquire_obj_animation(int object);
+void compute_cull_radius(GameObject *obj);
+void release_obj_animation(int object);
+void release_obj_animations();
 
 void update_beat();
 void draw_end_wall();
@@ -1797,5 +1806,8 @@ void run_trigger(GameObject *obj);
 AnimationDefinition prepare_monster_1_animation();
 AnimationDefinition prepare_monster_2_animation();
 AnimationDefinition prepare_monster_3_animation();
-void put_object_layer(GameObject *obj, float x, float y, GDObjectLayer *layer);
+void put_object_layer(GameObject *obj, ObjRenderState *render, GDObjectLayer *layer);
+
+extern int render_state_count;
+extern int render_trig_calls;
 u32 get_layer_color(GameObject *obj, int color_type, int col_channel, float opacity, int def_col_channel);
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <math.h>
 #include "main.h"
@@ -7,6 +8,8 @@
 #include "game.h"
 #include <stdio.h>
 #include "easing.h"
+#include "rng.h"
+#include <ogc/lwp_watchdog.h>
 GRRLIB_texImg *particleTex = NULL;
 
 ParticleTemplate particle_templates[] = {
@@ -729,51 +732,161 @@ ParticleTemplate particle_templates[] = {
     },
 };
 
+int particles_scanned = 0;
+int particles_drawn = 0;
+
+int particle_capacity = MAX_PARTICLES;
+int particle_evictions = 0;
+float particle_evictions_per_second = 0;
+int evictions_this_second = 0;
+u64 evictions_window_start = 0;
+
+void particle_list_append(ParticleList *list, s16 *next, s16 *prev, int i) {
+    if (list->count == 0) {
+        list->head = i;
+    } else {
+        next[list->tail] = i;
+        prev[i] = list->tail;
+    }
+    list->tail = i;
+    list->count++;
+}
+
+void particle_list_remove(ParticleList *list, s16 *next, s16 *prev, int i) {
+    if (list->head == i) {
+        list->head = next[i];
+    } else {
+        next[prev[i]] = next[i];
+    }
+
+    if (list->tail == i) {
+        list->tail = prev[i];
+    } else {
+        prev[next[i]] = prev[i];
+    }
+    list->count--;
+}
+
+int find_particle_bucket(ParticlePool *pool, GameObject *parent_obj, int group_id, bool create) {
+    u32 hash = (((u32) parent_obj >> 3) * 31 + group_id) & (PARTICLE_BUCKET_COUNT - 1);
+
+    for (int probe = 0; probe < PARTICLE_BUCKET_COUNT; probe++) {
+        ParticleBucket *bucket = &pool->parent_buckets[hash];
+
+        if (bucket->parent_obj == parent_obj && bucket->group_id == group_id) return hash;
+
+        if (bucket->parent_obj == NULL) {
+            if (!create) return -1;
+            bucket->parent_obj = parent_obj;
+            bucket->group_id = group_id;
+            bucket->list.count = 0;
+            return hash;
+        }
+
+        hash = (hash + 1) & (PARTICLE_BUCKET_COUNT - 1);
+    }
+    return -1;
+}
+
+void link_particle(ParticlePool *pool, int i) {
+    particle_list_append(&pool->groups[pool->group_id[i]], pool->group_next, pool->group_prev, i);
+
+    pool->parent_bucket[i] = -1;
+    if (pool->parent_obj[i]) {
+        int bucket = find_particle_bucket(pool, pool->parent_obj[i], pool->group_id[i], TRUE);
+        if (bucket >= 0) {
+            particle_list_append(&pool->parent_buckets[bucket].list, pool->parent_next, pool->parent_prev, i);
+            pool->parent_bucket[i] = bucket;
+        } else {
+            if (pool->unbucketed == 0) output_log_level(LOG_WARNING, "Particle bucket table is full, scanning groups instead\n");
+            pool->unbucketed++;
+        }
+    }
+}
+
+void unlink_particle(ParticlePool *pool, int i) {
+    particle_list_remove(&pool->groups[pool->group_id[i]], pool->group_next, pool->group_prev, i);
+
+    int bucket = pool->parent_bucket[i];
+    if (bucket >= 0) {
+        particle_list_remove(&pool->parent_buckets[bucket].list, pool->parent_next, pool->parent_prev, i);
+    } else if (pool->parent_obj[i]) {
+        pool->unbucketed--;
+    }
+}
+
+// Particles move around when the pool gets compacted, so relink everything
+void rebuild_particle_lists(ParticlePool *pool) {
+    memset(pool->groups, 0, sizeof(pool->groups));
+    memset(pool->parent_buckets, 0, sizeof(pool->parent_buckets));
+    pool->unbucketed = 0;
+
+    for (int i = 0; i < pool->count; i++) {
+        link_particle(pool, i);
+    }
+}
+
 void add_particle(int i, int group_id, float x, float y, GameObject *parent_obj) {
     ParticleTemplate *tpl = &particle_templates[group_id];
-    Particle *particles = state.particles;
+    ParticlePool *pool = &state.particles;
 
-    float angle = tpl->angle + tpl->angleVar * random_float(-1, 1);
-    float speed = tpl->speed + tpl->speedVar * random_float(-1, 1);
+    // Draw all the random values of the particle at once
+    float rnd[PARTICLE_RANDOM_VALUES];
+    int r = 0;
+    random_fill_floats(RNG_COSMETIC, rnd, PARTICLE_RANDOM_VALUES, -1, 1);
+
+    float angle = tpl->angle + tpl->angleVar * rnd[r++];
+    float speed = tpl->speed + tpl->speedVar * rnd[r++];
 
     angle = positive_fmod(angle, 360);
 
-    particles[i].velocity_angle = angle;
-    particles[i].velocity_magnitude = speed;
-    particles[i].rotate_per_second = tpl->rotatePerSecond + tpl->rotatePerSecondVariance * random_float(-1, 1);
+    float cos_angle = cosf(DegToRad(angle));
+    float sin_angle = sinf(DegToRad(angle));
+
+    pool->velocity_angle[i] = angle;
+    pool->rotate_per_second[i] = tpl->rotatePerSecond + tpl->rotatePerSecondVariance * rnd[r++];
 
-    float vx = cosf(DegToRad(angle)) * speed;
-    float vy = sinf(DegToRad(angle)) * speed;
+    float vx = cos_angle * speed;
+    float vy = sin_angle * speed;
     
     float radius = tpl->minRadius;
     if (tpl->maxRadius > tpl->minRadius) {
-        radius += (tpl->maxRadius - tpl->minRadius) * random_float(0, 1);
+        radius += (tpl->maxRadius - tpl->minRadius) * random_float_stream(RNG_COSMETIC, 0, 1);
     }
 
-    float angled_var_x = tpl->sourcePosVarY * cosf(DegToRad(angle)) - tpl->sourcePosVarX * sinf(DegToRad(angle));
-    float angled_var_y = tpl->sourcePosVarY * sinf(DegToRad(angle)) + tpl->sourcePosVarX * cosf(DegToRad(angle));
+    float angled_var_x = tpl->sourcePosVarY * cos_angle - tpl->sourcePosVarX * sin_angle;
+    float angled_var_y = tpl->sourcePosVarY * sin_angle + tpl->sourcePosVarX * cos_angle;
 
-    float px = x + radius * cosf(DegToRad(angle)) + angled_var_x * random_float(-1, 1);
-    float py = y + radius * sinf(DegToRad(angle)) + angled_var_y * random_float(-1, 1);
+    float px = x + radius * cos_angle + angled_var_x * rnd[r++];
+    float py = y + radius * sin_angle + angled_var_y * rnd[r++];
 
-    float life = tpl->life + tpl->lifeVar * random_float(-1, 1);
+    float life = tpl->life + tpl->lifeVar * rnd[r++];
+    life = MAX(life, PARTICLE_MIN_LIFE);
 
     ColorAlpha sc = tpl->start_color;
     ColorAlpha scv = tpl->start_colorVar;
     ColorAlpha ec = tpl->end_color;
     ColorAlpha ecv = tpl->end_colorVar;
 
-    particles[i].group_id = group_id;
-    particles[i].x = px;
-    particles[i].y = py;
-    particles[i].vx = vx;
-    particles[i].vy = vy;
-    particles[i].ax = 0;
-    particles[i].ay = 0;
-    particles[i].gravity_x = tpl->gravity_x;
-    particles[i].gravity_y = tpl->gravity_y;
-    particles[i].life = life;
-    particles[i].elapsed = 0;
+    pool->group_id[i] = group_id;
+    pool->x[i] = px;
+    pool->y[i] = py;
+    pool->vx[i] = vx;
+    pool->vy[i] = vy;
+    pool->gravity_x[i] = tpl->gravity_x;
+    pool->gravity_y[i] = tpl->gravity_y;
+    pool->life[i] = life;
+    pool->inv_life[i] = 1.f / life;
+    pool->elapsed[i] = 0;
+
+    // Relative gravity only has to be rotated again if the particle rotates
+    if (tpl->rel_gravity) {
+        pool->accel_x[i] = tpl->gravity_y * cos_angle - tpl->gravity_x * sin_angle;
+        pool->accel_y[i] = tpl->gravity_y * sin_angle + tpl->gravity_x * cos_angle;
+    } else {
+        pool->accel_x[i] = tpl->gravity_x;
+        pool->accel_y[i] = tpl->gravity_y;
+    }
 
     float opacity = 1.f;
 
@@ -782,116 +895,238 @@ void add_particle(int i, int group_id, float x, float y, GameObject *parent_obj)
     }
 
     // Color interpolation
-    particles[i].start_color.r = sc.r + scv.r * random_float(-1, 1);
-    particles[i].start_color.g = sc.g + scv.g * random_float(-1, 1);
-    particles[i].start_color.b = sc.b + scv.b * random_float(-1, 1);
-    particles[i].start_color.a = (sc.a + scv.a * random_float(-1, 1)) * opacity;
-    particles[i].end_color.r = ec.r + ecv.r * random_float(-1, 1);
-    particles[i].end_color.g = ec.g + ecv.g * random_float(-1, 1);
-    particles[i].end_color.b = ec.b + ecv.b * random_float(-1, 1);
-    particles[i].end_color.a = (ec.a + ecv.a * random_float(-1, 1)) * opacity;
-
-    particles[i].color = particles[i].start_color;
-    particles[i].color_delta.r = (particles[i].end_color.r - particles[i].start_color.r) / life;
-    particles[i].color_delta.g = (particles[i].end_color.g - particles[i].start_color.g) / life;
-    particles[i].color_delta.b = (particles[i].end_color.b - particles[i].start_color.b) / life;
-    particles[i].color_delta.a = (particles[i].end_color.a - particles[i].start_color.a) / life;
+    float start_r = sc.r + scv.r * rnd[r++];
+    float start_g = sc.g + scv.g * rnd[r++];
+    float start_b = sc.b + scv.b * rnd[r++];
+    float start_a = (sc.a + scv.a * rnd[r++]) * opacity;
+    float end_r = ec.r + ecv.r * rnd[r++];
+    float end_g = ec.g + ecv.g * rnd[r++];
+    float end_b = ec.b + ecv.b * rnd[r++];
+    float end_a = (ec.a + ecv.a * rnd[r++]) * opacity;
+
+    pool->r[i] = start_r;
+    pool->g[i] = start_g;
+    pool->b[i] = start_b;
+    pool->a[i] = start_a;
+    pool->delta_r[i] = (end_r - start_r) / life;
+    pool->delta_g[i] = (end_g - start_g) / life;
+    pool->delta_b[i] = (end_b - start_b) / life;
+    pool->start_a[i] = start_a;
+    pool->end_a[i] = end_a;
 
     // Scale interpolation
-    particles[i].start_scale = (tpl->start_scale + tpl->start_scaleVar * random_float(-1, 1)) * screen_factor_y;
-    particles[i].end_scale = (tpl->end_scale + tpl->end_scaleVar * random_float(-1, 1)) * screen_factor_y;
-    particles[i].scale = particles[i].start_scale;
-    particles[i].scale_delta = (particles[i].end_scale - particles[i].start_scale) / life;
+    pool->start_scale[i] = (tpl->start_scale + tpl->start_scaleVar * rnd[r++]) * screen_factor_y;
+    pool->end_scale[i] = (tpl->end_scale + tpl->end_scaleVar * rnd[r++]) * screen_factor_y;
+    pool->scale[i] = pool->start_scale[i];
+
+    pool->blending[i] = tpl->blending;
+    pool->rel_gravity[i] = tpl->rel_gravity;
+    pool->parent_obj[i] = parent_obj;
 
-    particles[i].blending = tpl->blending;
-    particles[i].active = TRUE;
-    particles[i].rel_gravity = tpl->rel_gravity;
-    particles[i].parent_obj = parent_obj;
+    pool->trifading[i] = tpl->trifading;
 
-    particles[i].trifading = tpl->trifading;
+    pool->texture_id[i] = tpl->texture_id;
+    pool->lock_to_player[i] = tpl->lock_to_player;
+    pool->player_id[i] = state.current_player;
 
-    particles[i].texture_id = tpl->texture_id;
-    particles[i].lock_to_player = tpl->lock_to_player;
-    particles[i].player_id = state.current_player;
+    pool->rotation[i] = 0;
 
-    particles[i].priority = tpl->priority;
+    if (group_id == P1_TRAIL) pool->rotation[i] = state.player.lerp_rotation;
 
-    particles[i].rotation = 0;
+    link_particle(pool, i);
+}
+
+// Groups sorted from lowest to highest priority, for picking what to evict
+int groups_by_priority[PARTICLE_GROUP_COUNT];
+bool groups_sorted = FALSE;
+
+void sort_groups_by_priority() {
+    for (int i = 0; i < PARTICLE_GROUP_COUNT; i++) {
+        int group = i;
+        int j = i - 1;
+        while (j >= 0 && particle_templates[groups_by_priority[j]].priority > particle_templates[group].priority) {
+            groups_by_priority[j + 1] = groups_by_priority[j];
+            j--;
+        }
+        groups_by_priority[j + 1] = group;
+    }
+    groups_sorted = TRUE;
+}
 
-    if (group_id == P1_TRAIL) particles[i].rotation = state.player.lerp_rotation;
+// Oldest particle of the lowest priority group below the given priority
+int find_evictable_particle(ParticlePool *pool, int priority) {
+    if (!groups_sorted) sort_groups_by_priority();
+
+    for (int i = 0; i < PARTICLE_GROUP_COUNT; i++) {
+        int group = groups_by_priority[i];
+        if (particle_templates[group].priority >= priority) break;
+        if (pool->groups[group].count > 0) return pool->groups[group].head;
+    }
+    return -1;
 }
 
 void spawn_particle(int group_id, float x, float y, GameObject *parent_obj) {
     if (state.paused) return;
 
     ParticleTemplate *tpl = &particle_templates[group_id];
-    Particle *particles = state.particles;
-
-    float priority = tpl->priority;
-    int lowest = priority;
-    int lowest_index = -1;
+    ParticlePool *pool = &state.particles;
 
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        if (!particles[i].active) {
-            add_particle(i, group_id, x, y, parent_obj);
-            return;
-        } else if (particles[i].priority < priority && particles[i].priority < lowest) {
-            // Set as new lowest priority
-            lowest = particles[i].priority;
-            lowest_index = i;
-        }
+    // Free slots are always at the end
+    if (pool->count < particle_capacity) {
+        add_particle(pool->count++, group_id, x, y, parent_obj);
+        return;
     }
+
     // If all full, replace lowest priority
-    if (lowest_index >= 0) {
-        add_particle(lowest_index, group_id, x, y, parent_obj);
+    int evicted = find_evictable_particle(pool, tpl->priority);
+    if (evicted >= 0) {
+        unlink_particle(pool, evicted);
+        add_particle(evicted, group_id, x, y, parent_obj);
+        particle_evictions++;
+        evictions_this_second++;
+    }
+}
+
+void move_particle(ParticlePool *pool, int to, int from) {
+    pool->x[to] = pool->x[from];
+    pool->y[to] = pool->y[from];
+    pool->vx[to] = pool->vx[from];
+    pool->vy[to] = pool->vy[from];
+    pool->accel_x[to] = pool->accel_x[from];
+    pool->accel_y[to] = pool->accel_y[from];
+    pool->velocity_angle[to] = pool->velocity_angle[from];
+    pool->rotate_per_second[to] = pool->rotate_per_second[from];
+    pool->elapsed[to] = pool->elapsed[from];
+    pool->inv_life[to] = pool->inv_life[from];
+    pool->scale[to] = pool->scale[from];
+    pool->start_scale[to] = pool->start_scale[from];
+    pool->end_scale[to] = pool->end_scale[from];
+    pool->r[to] = pool->r[from];
+    pool->g[to] = pool->g[from];
+    pool->b[to] = pool->b[from];
+    pool->a[to] = pool->a[from];
+    pool->delta_r[to] = pool->delta_r[from];
+    pool->delta_g[to] = pool->delta_g[from];
+    pool->delta_b[to] = pool->delta_b[from];
+    pool->start_a[to] = pool->start_a[from];
+    pool->end_a[to] = pool->end_a[from];
+    pool->life[to] = pool->life[from];
+    pool->gravity_x[to] = pool->gravity_x[from];
+    pool->gravity_y[to] = pool->gravity_y[from];
+    pool->rotation[to] = pool->rotation[from];
+    pool->parent_obj[to] = pool->parent_obj[from];
+    pool->group_id[to] = pool->group_id[from];
+    pool->texture_id[to] = pool->texture_id[from];
+    pool->player_id[to] = pool->player_id[from];
+    pool->rel_gravity[to] = pool->rel_gravity[from];
+    pool->lock_to_player[to] = pool->lock_to_player[from];
+    pool->trifading[to] = pool->trifading[from];
+    pool->blending[to] = pool->blending[from];
+}
+
+// Remove dead particles, keeping the rest packed and in spawn order
+void compact_particles(ParticlePool *pool) {
+    int count = pool->count;
+    int alive = 0;
+    for (int i = 0; i < count; i++) {
+        if (pool->elapsed[i] >= pool->life[i]) continue;
+        if (alive != i) move_particle(pool, alive, i);
+        alive++;
+    }
+    if (alive != count) {
+        pool->count = alive;
+        rebuild_particle_lists(pool);
     }
 }
 
 void update_particles() {
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        Particle *p = &state.particles[i];
-        if (p->active) {
-            p->velocity_angle += p->rotate_per_second * dt;
-            if (p->rel_gravity) {
-                p->vx += (p->gravity_y * cosf(DegToRad(p->velocity_angle)) - p->gravity_x * sinf(DegToRad(p->velocity_angle))) * dt;
-                p->vy += (p->gravity_y * sinf(DegToRad(p->velocity_angle)) + p->gravity_x * cosf(DegToRad(p->velocity_angle))) * dt;
-            } else {
-                p->vx += p->gravity_x * dt;
-                p->vy += p->gravity_y * dt;
-            }
-
-            p->x += p->vx * dt;
-            p->y += p->vy * dt;
-
-            if (p->lock_to_player) {
-                if (p->player_id == 0) {
-                    p->x = state.player.x;
-                    p->y = state.player.y;
-                } else {
-                    p->x = state.player2.x;
-                    p->y = state.player2.y;
-                }
-            }
-
-            p->scale = easeValue(EASE_OUT, p->start_scale, p->end_scale, p->elapsed, p->life, 2.f);
-            p->color.r += p->color_delta.r * dt;
-            p->color.g += p->color_delta.g * dt;
-            p->color.b += p->color_delta.b * dt;
-            if (p->trifading) {
-                if (p->elapsed / p->life < 0.5f) {
-                    p->color.a = easeValue(EASE_IN, p->start_color.a, p->end_color.a, p->elapsed, p->life / 2, 2.f);
-                } else {
-                    p->color.a = easeValue(EASE_OUT, p->end_color.a, p->start_color.a, p->elapsed - (p->life / 2), p->life / 2, 2.f);
-                }
-            } else {
-                p->color.a = easeValue(EASE_OUT, p->start_color.a, p->end_color.a, p->elapsed, p->life, 2.f);
-            }
-            p->elapsed += dt;
-            if (p->elapsed >= p->life) {
-                p->active = FALSE;
-            }
+    ParticlePool *pool = &state.particles;
+    int count = pool->count;
+
+    // Only rotating particles with relative gravity need their gravity rotated again
+    for (int i = 0; i < count; i++) {
+        pool->velocity_angle[i] += pool->rotate_per_second[i] * dt;
+        if (pool->rel_gravity[i] && pool->rotate_per_second[i] != 0) {
+            float cos_angle = cosf(DegToRad(pool->velocity_angle[i]));
+            float sin_angle = sinf(DegToRad(pool->velocity_angle[i]));
+            pool->accel_x[i] = pool->gravity_y[i] * cos_angle - pool->gravity_x[i] * sin_angle;
+            pool->accel_y[i] = pool->gravity_y[i] * sin_angle + pool->gravity_x[i] * cos_angle;
+        }
+    }
+
+    // Branchless so the compiler can vectorize it
+    for (int i = 0; i < count; i++) {
+        pool->vx[i] += pool->accel_x[i] * dt;
+        pool->vy[i] += pool->accel_y[i] * dt;
+        pool->x[i] += pool->vx[i] * dt;
+        pool->y[i] += pool->vy[i] * dt;
+
+        float t = pool->elapsed[i] * pool->inv_life[i];
+        t = (t > 1.f) ? 1.f : t;
+
+        // EASE_OUT with a rate of 2 is a square root
+        float ease_out = sqrtf(t);
+        pool->scale[i] = pool->start_scale[i] + (pool->end_scale[i] - pool->start_scale[i]) * ease_out;
+
+        pool->r[i] += pool->delta_r[i] * dt;
+        pool->g[i] += pool->delta_g[i] * dt;
+        pool->b[i] += pool->delta_b[i] * dt;
+
+        float start_a = pool->start_a[i];
+        float end_a = pool->end_a[i];
+        float fade_alpha = start_a + (end_a - start_a) * ease_out;
+
+        // Trifading eases in to the end color on the first half, then back out
+        float half_t = t * 2;
+        float in_t = (half_t > 1.f) ? 1.f : half_t;
+        float out_t = (half_t > 1.f) ? half_t - 1.f : 0.f;
+        float trifade_in = start_a + (end_a - start_a) * (in_t * in_t);
+        float trifade_out = end_a + (start_a - end_a) * sqrtf(out_t);
+        float trifade_alpha = (t < 0.5f) ? trifade_in : trifade_out;
+
+        pool->a[i] = pool->trifading[i] ? trifade_alpha : fade_alpha;
+        pool->elapsed[i] += dt;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (pool->lock_to_player[i]) {
+            Player *player = (pool->player_id[i] == 0) ? &state.player : &state.player2;
+            pool->x[i] = player->x;
+            pool->y[i] = player->y;
+        }
+    }
+
+    compact_particles(pool);
+
+    u64 now = gettime();
+    float elapsed = ticks_to_secs_float(now - evictions_window_start);
+    if (elapsed >= 1.f) {
+        particle_evictions_per_second = evictions_this_second / elapsed;
+        evictions_this_second = 0;
+        evictions_window_start = now;
+    }
+}
+
+void set_particle_capacity(int capacity) {
+    ParticlePool *pool = &state.particles;
+    particle_capacity = CLAMP(capacity, 1, MAX_PARTICLES);
+
+    // Kill the lowest priority particles that don't fit anymore
+    int excess = pool->count - particle_capacity;
+    if (excess <= 0) return;
+
+    if (!groups_sorted) sort_groups_by_priority();
+
+    for (int i = 0; i < PARTICLE_GROUP_COUNT && excess > 0; i++) {
+        ParticleList *list = &pool->groups[groups_by_priority[i]];
+        int index = list->head;
+        for (int n = 0; n < list->count && excess > 0; n++, index = pool->group_next[index]) {
+            pool->elapsed[index] = pool->life[index];
+            excess--;
         }
     }
+
+    compact_particles(pool);
 }
 
 void draw_particles(int group_id) {
@@ -901,100 +1136,80 @@ void draw_particles(int group_id) {
     GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
     GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
 
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        Particle *p = &state.particles[i];
-
-        if (p->group_id == group_id && p->active) {
-            float calc_x = ((p->x - state.camera_x) * SCALE) - widthAdjust;
-            float calc_y = screenHeight - ((p->y - state.camera_y) * SCALE);
-
-            if (p->blending) {
-                GRRLIB_SetBlend(GRRLIB_BLEND_ADD);
-            }
-            switch(p->texture_id) { 
-                case PARTICLE_SQUARE:
-                    custom_rectangle(
-                        get_mirror_x(calc_x, state.mirror_factor), calc_y,
-                        p->scale * 32, p->scale * 32,
-                        RGBA(
-                            p->color.r,
-                            p->color.g,
-                            p->color.b,
-                            p->color.a
-                        ),
-                        TRUE
-                    );
-                    break;
-                case PARTICLE_CIRCLE:
-                    custom_circle(
-                        get_mirror_x(calc_x, state.mirror_factor), calc_y,
-                        p->scale,
-                        RGBA(
-                            p->color.r,
-                            p->color.g,
-                            p->color.b,
-                            p->color.a
-                        )
-                    );
-                    break;
-                case PARTICLE_CIRCUNFERENCE:
-                    custom_circunference(
-                        get_mirror_x(calc_x, state.mirror_factor), calc_y,
-                        p->scale,
-                        RGBA(
-                            p->color.r,
-                            p->color.g,
-                            p->color.b,
-                            p->color.a
-                        ),
-                        2.f
-                    );
-                    break;
-                case PARTICLE_P1_TRAIL:
-                    set_texture(p1TrailTex);
-                    GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
-                    GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
-                    custom_drawImg(
-                        get_mirror_x(calc_x, state.mirror_factor) + 6 - (p1TrailTex->w/2), calc_y + 6 - (p1TrailTex->h/2),
-                        p1TrailTex,
-                        p->rotation * state.mirror_mult,
-                        p->scale * state.mirror_mult, p->scale,
-                        RGBA(
-                            p->color.r,
-                            p->color.g,
-                            p->color.b,
-                            p->color.a
-                        )
-                    
-                    );
-                    GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
-                    GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
-                    break;
-                case PARTICLE_COIN:
-                    GRRLIB_texImg *coin_tex = get_coin_particle_texture();
-                    set_texture(coin_tex);
-                    GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
-                    GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
-                    custom_drawImg(
-                        get_mirror_x(calc_x, state.mirror_factor) + 6 - (coin_tex->w/2), calc_y + 6 - (coin_tex->h/2),
-                        coin_tex,
-                        p->rotation * state.mirror_mult,
-                        p->scale * state.mirror_mult, p->scale,
-                        RGBA(
-                            p->color.r,
-                            p->color.g,
-                            p->color.b,
-                            p->color.a
-                        )
-                    
-                    );
-                    GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
-                    GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
-                    break;
-            }
-            
-            GRRLIB_SetBlend(GRRLIB_BLEND_ALPHA);
+    ParticlePool *pool = &state.particles;
+    ParticleList *list = &pool->groups[group_id];
+    int i = list->head;
+    for (int n = 0; n < list->count; n++, i = pool->group_next[i]) {
+        particles_scanned++;
+
+        if (pool->a[i] <= 0) continue;
+        particles_drawn++;
+
+        float calc_x = ((pool->x[i] - state.camera_x) * SCALE) - widthAdjust;
+        float calc_y = screenHeight - ((pool->y[i] - state.camera_y) * SCALE);
+        u32 color = RGBA(pool->r[i], pool->g[i], pool->b[i], pool->a[i]);
+
+        if (pool->blending[i]) {
+            GRRLIB_SetBlend(GRRLIB_BLEND_ADD);
+        }
+        switch(pool->texture_id[i]) { 
+            case PARTICLE_SQUARE:
+                custom_rectangle(
+                    get_mirror_x(calc_x, state.mirror_factor), calc_y,
+                    pool->scale[i] * 32, pool->scale[i] * 32,
+                    color,
+                    TRUE
+                );
+                break;
+            case PARTICLE_CIRCLE:
+                custom_circle(
+                    get_mirror_x(calc_x, state.mirror_factor), calc_y,
+                    pool->scale[i],
+                    color
+                );
+                break;
+            case PARTICLE_CIRCUNFERENCE:
+                custom_circunference(
+                    get_mirror_x(calc_x, state.mirror_factor), calc_y,
+                    pool->scale[i],
+                    color,
+                    2.f
+                );
+                break;
+            case PARTICLE_P1_TRAIL:
+                set_texture(p1TrailTex);
+                GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
+                GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
+                custom_drawImg(
+                    get_mirror_x(calc_x, state.mirror_factor) + 6 - (p1TrailTex->w/2), calc_y + 6 - (p1TrailTex->h/2),
+                    p1TrailTex,
+                    pool->rotation[i] * state.mirror_mult,
+                    pool->scale[i] * state.mirror_mult, pool->scale[i],
+                    color
+                
+                );
+                GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
+                GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+                break;
+            case PARTICLE_COIN:
+                GRRLIB_texImg *coin_tex = get_coin_particle_texture();
+                set_texture(coin_tex);
+                GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
+                GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
+                custom_drawImg(
+                    get_mirror_x(calc_x, state.mirror_factor) + 6 - (coin_tex->w/2), calc_y + 6 - (coin_tex->h/2),
+                    coin_tex,
+                    pool->rotation[i] * state.mirror_mult,
+                    pool->scale[i] * state.mirror_mult, pool->scale[i],
+                    color
+                
+                );
+                GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
+                GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+                break;
         }
+        
+        GRRLIB_SetBlend(GRRLIB_BLEND_ALPHA);
     }
     set_texture(prev_tex);
     GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
@@ -1011,98 +1226,106 @@ void draw_obj_particles(int group_id, GameObject *parent_obj) {
     float x = ((*soa_x(parent_obj) - state.camera_x) * SCALE) - widthAdjust;
     get_fade_vars(parent_obj, x, &fade_x, &fade_y, &fade_scale);
 
+    ParticlePool *pool = &state.particles;
+    ParticleList *list = &pool->groups[group_id];
+    s16 *next = pool->group_next;
+    bool filter_parent = FALSE;
+    if (parent_obj) {
+        int bucket = find_particle_bucket(pool, parent_obj, group_id, FALSE);
+        if (bucket >= 0) {
+            list = &pool->parent_buckets[bucket].list;
+            next = pool->parent_next;
+        } else if (pool->unbucketed > 0) {
+            // Didn't get a bucket, look for them in the whole group
+            filter_parent = TRUE;
+        } else {
+            return;
+        }
+    }
+
+    int fade_value = get_fade_value(x, screenWidth);
+
     GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
     GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
-    for (int i = 0; i < MAX_PARTICLES; i++) {
-        Particle *p = &state.particles[i];
-
-        bool condition = (parent_obj == NULL ? TRUE : parent_obj == p->parent_obj);
-
-        if (p->group_id == group_id && condition && p->active) {
-            float calc_x = ((p->x - state.camera_x) * SCALE) - widthAdjust;
-            float calc_y = screenHeight - ((p->y - state.camera_y) * SCALE);
-
-            if (p->blending) {
-                GRRLIB_SetBlend(GRRLIB_BLEND_ADD);
-            }
-
-            switch(p->texture_id) { 
-                case PARTICLE_SQUARE:
-                    custom_rectangle(
-                        get_mirror_x(calc_x, state.mirror_factor) + 6 + fade_x, calc_y + 6 + fade_y,
-                        p->scale * 32, p->scale * 32,
-                        RGBA(
-                            p->color.r,
-                            p->color.g,
-                            p->color.b,
-                            p->color.a * (get_fade_value(x, screenWidth) / 255.f)
-                        ), TRUE
-                    );
-                    break;
-                case PARTICLE_CIRCLE:
-                    custom_circle(
-                        get_mirror_x(calc_x, state.mirror_factor) + 6 + fade_x, calc_y + 6 + fade_y,
-                        p->scale,
-                        RGBA(
-                            p->color.r,
-                            p->color.g,
-                            p->color.b,
-                            p->color.a * (get_fade_value(x, screenWidth) / 255.f)
-                        )
-                    );
-                    break;
-                case PARTICLE_CIRCUNFERENCE:
-                    custom_circunference(
-                        get_mirror_x(calc_x, state.mirror_factor) + 6 + fade_x, calc_y + 6 + fade_y,
-                        p->scale,
-                        RGBA(
-                            p->color.r,
-                            p->color.g,
-                            p->color.b,
-                            p->color.a * (get_fade_value(x, screenWidth) / 255.f)
-                        ),
-                        2
-                    );
-                    break;
-                case PARTICLE_KEY:
-                    GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
-                    GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
-                    int col_channel;
-                    u32 color;
-
-                    GRRLIB_texImg *key_tex = object_images[KEY_OBJ][0]; // First layer
-                    if (!key_tex) break;
-
-                    col_channel = parent_obj->object.main_col_channel;
-                    color = get_layer_color(parent_obj, COLOR_MAIN, col_channel, 255, 1);
-                    set_texture(key_tex);
-                    custom_drawImg(
-                        get_mirror_x(calc_x, state.mirror_factor) + 6 - (key_tex->w/2), calc_y + 6 - (key_tex->h/2),
-                        key_tex,
-                        p->rotation * state.mirror_mult,
-                        p->scale * state.mirror_mult, p->scale,
-                        color
-                    );
-                    key_tex = object_images[KEY_OBJ][1]; // Second layer
-                    if (!key_tex) break;
-
-                    col_channel = parent_obj->object.detail_col_channel;
-                    color = get_layer_color(parent_obj, COLOR_DETAIL, col_channel, 255, WHITE);
-
-                    set_texture(key_tex);
-                    custom_drawImg(
-                        get_mirror_x(calc_x, state.mirror_factor) + 6 - (key_tex->w/2), calc_y + 6 - (key_tex->h/2),
-                        key_tex,
-                        p->rotation * state.mirror_mult,
-                        p->scale * state.mirror_mult, p->scale,
-                        color
-                    );
-                    GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
-                    GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
-                    break;
-            }
-            GRRLIB_SetBlend(GRRLIB_BLEND_ALPHA);
+
+    int i = list->head;
+    for (int n = 0; n < list->count; n++, i = next[i]) {
+        particles_scanned++;
+        if (filter_parent && pool->parent_obj[i] != parent_obj) continue;
+
+        // Keys use the object color instead
+        if ((pool->a[i] <= 0 || fade_value == 0) && pool->texture_id[i] != PARTICLE_KEY) continue;
+        particles_drawn++;
+
+        float calc_x = ((pool->x[i] - state.camera_x) * SCALE) - widthAdjust;
+        float calc_y = screenHeight - ((pool->y[i] - state.camera_y) * SCALE);
+        u32 color = RGBA(pool->r[i], pool->g[i], pool->b[i], pool->a[i] * (fade_value / 255.f));
+
+        if (pool->blending[i]) {
+            GRRLIB_SetBlend(GRRLIB_BLEND_ADD);
+        }
+
+        switch(pool->texture_id[i]) { 
+            case PARTICLE_SQUARE:
+                custom_rectangle(
+                    get_mirror_x(calc_x, state.mirror_factor) + 6 + fade_x, calc_y + 6 + fade_y,
+                    pool->scale[i] * 32, pool->scale[i] * 32,
+                    color, TRUE
+                );
+                break;
+            case PARTICLE_CIRCLE:
+                custom_circle(
+                    get_mirror_x(calc_x, state.mirror_factor) + 6 + fade_x, calc_y + 6 + fade_y,
+                    pool->scale[i],
+                    color
+                );
+                break;
+            case PARTICLE_CIRCUNFERENCE:
+                custom_circunference(
+                    get_mirror_x(calc_x, state.mirror_factor) + 6 + fade_x, calc_y + 6 + fade_y,
+                    pool->scale[i],
+                    color,
+                    2
+                );
+                break;
+            case PARTICLE_KEY:
+                GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
+                GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
+                int col_channel;
+
+                touch_obj_textures(KEY_OBJ);
+                GRRLIB_texImg *key_tex = object_images[KEY_OBJ][0]; // First layer
+                if (!key_tex) break;
+
+                col_channel = parent_obj->object.main_col_channel;
+                color = get_layer_color(parent_obj, COLOR_MAIN, col_channel, 255, 1);
+                set_texture(key_tex);
+                custom_drawImg(
+                    get_mirror_x(calc_x, state.mirror_factor) + 6 - (key_tex->w/2), calc_y + 6 - (key_tex->h/2),
+                    key_tex,
+                    pool->rotation[i] * state.mirror_mult,
+                    pool->scale[i] * state.mirror_mult, pool->scale[i],
+                    color
+                );
+                key_tex = object_images[KEY_OBJ][1]; // Second layer
+                if (!key_tex) break;
+
+                col_channel = parent_obj->object.detail_col_channel;
+                color = get_layer_color(parent_obj, COLOR_DETAIL, col_channel, 255, WHITE);
+
+                set_texture(key_tex);
+                custom_drawImg(
+                    get_mirror_x(calc_x, state.mirror_factor) + 6 - (key_tex->w/2), calc_y + 6 - (key_tex->h/2),
+                    key_tex,
+                    pool->rotation[i] * state.mirror_mult,
+                    pool->scale[i] * state.mirror_mult, pool->scale[i],
+                    color
+                );
+                GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
+                GX_SetVtxDesc(GX_VA_TEX0,   GX_NONE);
+                break;
         }
+        GRRLIB_SetBlend(GRRLIB_BLEND_ALPHA);
     }
     GX_SetVtxDesc(GX_VA_TEX0,   GX_DIRECT);
     GX_SetTevOp(GX_TEVSTAGE0, GX_MODULATE);
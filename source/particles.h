@@ -4,32 +4,119 @@
 
 #define MAX_PARTICLES 512
 
+// Random values used to spawn a particle
+#define PARTICLE_RANDOM_VALUES 16
+
+// Avoids dividing by zero on particles with no lifetime
+#define PARTICLE_MIN_LIFE 0.0001f
+
+enum ParticleGroupID {
+    CUBE_DRAG,
+    SHIP_TRAIL,
+    HOLDING_SHIP_TRAIL,
+    SHIP_DRAG,
+    ORB_PARTICLES,
+    PAD_PARTICLES,
+    GLITTER_EFFECT,
+    PORTAL_PARTICLES,
+    USE_EFFECT,
+    ORB_HITBOX_EFFECT,
+    P1_TRAIL,
+    UFO_JUMP,
+    UFO_TRAIL,
+    DEATH_PARTICLES,
+    DEATH_CIRCLE,
+    BREAKABLE_BRICK_PARTICLES,
+    COIN_PARTICLES,
+    COIN_OBJ,
+    SPEED_PORTAL_AMBIENT,
+    SPEEDUP,
+    DUAL_BALL_HITBOX_EFFECT,
+    END_WALL_PARTICLES,
+    END_WALL_COLL_CIRCLE,
+    END_WALL_COLL_CIRCUNFERENCE,
+    END_WALL_COMPLETE_CIRCLES,
+    END_WALL_FIREWORK,
+    END_WALL_TEXT_EFFECT,
+    ROBOT_JUMP_PARTICLES,
+    KEY_OBJ_PART,
+    KEY_PARTICLES,
+    PARTICLE_GROUP_COUNT
+};
+
+// Hash table size for the per object particle lists, at least twice MAX_PARTICLES
+#define PARTICLE_BUCKET_COUNT 1024
+
+// Intrusive list of particle indices, only the first count links are valid
+typedef struct {
+    s16 head;
+    s16 tail;
+    u16 count;
+} ParticleList;
+
+// Particles of a single group spawned by a single object
 typedef struct {
-    int group_id;
     GameObject *parent_obj;
-    float x, y;
-    float vx, vy;
-    float ax, ay;
-    float gravity_x, gravity_y;
-    float rotation;
-    float life;
-    bool active;
-    bool rel_gravity;
-    ColorAlpha color, start_color, end_color;
-    ColorAlpha color_delta;
-    float scale, start_scale, end_scale, scale_delta;
-    float vscale;
-    float velocity_angle; 
-    float velocity_magnitude;
-    float rotate_per_second;
-    int texture_id;
-    bool blending;
-    bool lock_to_player;
-    bool trifading;
-    int priority;
-    float elapsed;
-    int player_id;
-} Particle;
+    int group_id;
+    ParticleList list;
+} ParticleBucket;
+
+// Active particles are kept packed at the start of the arrays,
+// so updating them is a straight loop over [0, count) and the
+// next free slot is always count
+typedef struct {
+    // Updated every frame
+    float x[MAX_PARTICLES];
+    float y[MAX_PARTICLES];
+    float vx[MAX_PARTICLES];
+    float vy[MAX_PARTICLES];
+    float accel_x[MAX_PARTICLES];
+    float accel_y[MAX_PARTICLES];
+    float velocity_angle[MAX_PARTICLES];
+    float rotate_per_second[MAX_PARTICLES];
+    float elapsed[MAX_PARTICLES];
+    float inv_life[MAX_PARTICLES];
+    float scale[MAX_PARTICLES];
+    float start_scale[MAX_PARTICLES];
+    float end_scale[MAX_PARTICLES];
+    float r[MAX_PARTICLES];
+    float g[MAX_PARTICLES];
+    float b[MAX_PARTICLES];
+    float a[MAX_PARTICLES];
+    float delta_r[MAX_PARTICLES];
+    float delta_g[MAX_PARTICLES];
+    float delta_b[MAX_PARTICLES];
+    float start_a[MAX_PARTICLES];
+    float end_a[MAX_PARTICLES];
+
+    // Set on spawn
+    float life[MAX_PARTICLES];
+    float gravity_x[MAX_PARTICLES];
+    float gravity_y[MAX_PARTICLES];
+    float rotation[MAX_PARTICLES];
+    GameObject *parent_obj[MAX_PARTICLES];
+    int group_id[MAX_PARTICLES];
+    u8 texture_id[MAX_PARTICLES];
+    u8 player_id[MAX_PARTICLES];
+    u8 rel_gravity[MAX_PARTICLES];
+    u8 lock_to_player[MAX_PARTICLES];
+    u8 trifading[MAX_PARTICLES];
+    u8 blending[MAX_PARTICLES];
+
+    // Lists so drawing a group or an object's particles doesn't scan the whole pool
+    s16 group_next[MAX_PARTICLES];
+    s16 group_prev[MAX_PARTICLES];
+    s16 parent_next[MAX_PARTICLES];
+    s16 parent_prev[MAX_PARTICLES];
+    s16 parent_bucket[MAX_PARTICLES];
+    ParticleList groups[PARTICLE_GROUP_COUNT];
+    ParticleBucket parent_buckets[PARTICLE_BUCKET_COUNT];
+    // Particles with a parent that found the bucket table full, drawn by
+    // scanning their group list instead
+    int unbucketed;
+
+    int count;
+} ParticlePool;
 
 typedef struct {
     float angle, angleVar;
@@ -66,44 +153,19 @@ enum ParticleTextures {
     PARTICLE_KEY,
 };
 
-enum ParticleGroupID {
-    CUBE_DRAG,
-    SHIP_TRAIL,
-    HOLDING_SHIP_TRAIL,
-    SHIP_DRAG,
-    ORB_PARTICLES,
-    PAD_PARTICLES,
-    GLITTER_EFFECT,
-    PORTAL_PARTICLES,
-    USE_EFFECT,
-    ORB_HITBOX_EFFECT,
-    P1_TRAIL,
-    UFO_JUMP,
-    UFO_TRAIL,
-    DEATH_PARTICLES,
-    DEATH_CIRCLE,
-    BREAKABLE_BRICK_PARTICLES,
-    COIN_PARTICLES,
-    COIN_OBJ,
-    SPEED_PORTAL_AMBIENT,
-    SPEEDUP,
-    DUAL_BALL_HITBOX_EFFECT,
-    END_WALL_PARTICLES,
-    END_WALL_COLL_CIRCLE,
-    END_WALL_COLL_CIRCUNFERENCE,
-    END_WALL_COMPLETE_CIRCLES,
-    END_WALL_FIREWORK,
-    END_WALL_TEXT_EFFECT,
-    ROBOT_JUMP_PARTICLES,
-    KEY_OBJ_PART,
-    KEY_PARTICLES
-};
-
 extern ParticleTemplate particle_templates[];
 extern GRRLIB_texImg *particleCircleTex;
 extern GRRLIB_texImg *particleTex;
 
+extern int particles_scanned;
+extern int particles_drawn;
+
+extern int particle_capacity;
+extern int particle_evictions;
+extern float particle_evictions_per_second;
+
 void spawn_particle(int group_id, float x, float y, GameObject *parent_obj);
 void update_particles();
+void set_particle_capacity(int capacity);
 void draw_particles(int group_id);
 void draw_obj_particles(int group_id, GameObject *parent_obj);
@@ -13,12 +13,12 @@
 #include "custom_mp3player.h"
 #include "trail.h"
 #include "objects.h"
-#include "oggplayer.h"
-#include "explode_11_ogg.h"
+#include "sfx.h"
 
 #include "animation.h"
 
 #include "easing.h"
+#include "profiler.h"
 
 GRRLIB_texImg *icon_l1;
 GRRLIB_texImg *icon_l2;
@@ -1122,7 +1122,9 @@ void handle_player(Player *player) {
     player->just_teleported = FALSE;
 
     u32 t0 = gettime();
+    PROFILE_BEGIN("collide_with_objects");
     if (player->cutscene_timer == 0) collide_with_objects(player);
+    PROFILE_END();
     u32 t1 = gettime();
     collision_time = ticks_to_microsecs(t1 - t0) / 1000.f * 4.f;
     
@@ -1152,7 +1154,9 @@ void handle_player(Player *player) {
         }
     } 
     
+    PROFILE_BEGIN("run_player");
     run_player(player);
+    PROFILE_END();
     
     t1 = gettime();
     player_time = ticks_to_microsecs(t1 - t0) / 1000.f * 4.f;
@@ -1311,32 +1315,32 @@ void handle_death() {
     }
 
     MP3Player_Volume(0);
-    PlayOgg(explode_11_ogg, explode_11_ogg_size, 0, OGG_ONE_TIME);
+    play_sfx(SFX_EXPLODE);
 }
 
 void load_icons() {
-    icon_l1 = GRRLIB_LoadTexturePNG(player_01_001_png);
-    icon_l2 = GRRLIB_LoadTexturePNG(player_01_2_001_png);
-    ship_l1 = GRRLIB_LoadTexturePNG(ship_01_001_png);
-    ship_l2 = GRRLIB_LoadTexturePNG(ship_01_2_001_png);
-    ball_l1 = GRRLIB_LoadTexturePNG(player_ball_01_001_png);
-    ball_l2 = GRRLIB_LoadTexturePNG(player_ball_01_2_001_png);
-    ufo_l1 = GRRLIB_LoadTexturePNG(bird_01_001_png);
-    ufo_l2 = GRRLIB_LoadTexturePNG(bird_01_2_001_png);
-    ufo_dome = GRRLIB_LoadTexturePNG(bird_01_3_001_png);
-    wave_l1 = GRRLIB_LoadTexturePNG(dart_01_001_png);
-    wave_l2 = GRRLIB_LoadTexturePNG(dart_01_2_001_png);
+    icon_l1 = load_texture(player_01_001_png);
+    icon_l2 = load_texture(player_01_2_001_png);
+    ship_l1 = load_texture(ship_01_001_png);
+    ship_l2 = load_texture(ship_01_2_001_png);
+    ball_l1 = load_texture(player_ball_01_001_png);
+    ball_l2 = load_texture(player_ball_01_2_001_png);
+    ufo_l1 = load_texture(bird_01_001_png);
+    ufo_l2 = load_texture(bird_01_2_001_png);
+    ufo_dome = load_texture(bird_01_3_001_png);
+    wave_l1 = load_texture(dart_01_001_png);
+    wave_l2 = load_texture(dart_01_2_001_png);
     
-    robot_1_l1 = GRRLIB_LoadTexturePNG(robot_01_01_001_png);
-    robot_1_l2 = GRRLIB_LoadTexturePNG(robot_01_01_2_001_png);
-    robot_2_l1 = GRRLIB_LoadTexturePNG(robot_01_02_001_png);
-    robot_2_l2 = GRRLIB_LoadTexturePNG(robot_01_02_2_001_png);
-    robot_3_l1 = GRRLIB_LoadTexturePNG(robot_01_03_001_png);
-    robot_3_l2 = GRRLIB_LoadTexturePNG(robot_01_03_2_001_png);
-    robot_4_l1 = GRRLIB_LoadTexturePNG(robot_01_04_001_png);
-    robot_4_l2 = GRRLIB_LoadTexturePNG(robot_01_04_2_001_png);
-
-    trail_tex = GRRLIB_LoadTexturePNG(trail_png);
+    robot_1_l1 = load_texture(robot_01_01_001_png);
+    robot_1_l2 = load_texture(robot_01_01_2_001_png);
+    robot_2_l1 = load_texture(robot_01_02_001_png);
+    robot_2_l2 = load_texture(robot_01_02_2_001_png);
+    robot_3_l1 = load_texture(robot_01_03_001_png);
+    robot_3_l2 = load_texture(robot_01_03_2_001_png);
+    robot_4_l1 = load_texture(robot_01_04_001_png);
+    robot_4_l2 = load_texture(robot_01_04_2_001_png);
+
+    trail_tex = load_texture(trail_png);
 
     p1.r = 0;
     p1.g = 255;
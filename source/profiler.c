@@ -0,0 +1,126 @@
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include <stdio.h>
+#include <string.h>
+#include <ogc/lwp.h>
+#include <ogc/irq.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "main.h"
+
+typedef struct {
+    lwp_t thread;
+    u32 head; // Zones written since the last dump
+    int depth;
+    const char *open_names[PROFILER_MAX_DEPTH];
+    u64 open_starts[PROFILER_MAX_DEPTH];
+    ProfileZone zones[PROFILER_RING_SIZE];
+} ProfilerThread;
+
+ProfilerThread profiler_threads[PROFILER_MAX_THREADS];
+int profiler_thread_count = 0;
+
+static ProfilerThread *get_profiler_thread() {
+    lwp_t self = LWP_GetSelf();
+    for (int i = 0; i < profiler_thread_count; i++) {
+        if (profiler_threads[i].thread == self) return &profiler_threads[i];
+    }
+
+    // First zone of this thread, the audio threads might be doing the same
+    ProfilerThread *thread = NULL;
+    u32 level;
+    _CPU_ISR_Disable(level);
+    if (profiler_thread_count < PROFILER_MAX_THREADS) {
+        thread = &profiler_threads[profiler_thread_count];
+        thread->thread = self;
+        profiler_thread_count++;
+    }
+    _CPU_ISR_Restore(level);
+    return thread;
+}
+
+void profiler_begin(const char *name) {
+    ProfilerThread *thread = get_profiler_thread();
+    if (!thread) return;
+
+    // Too deep, still count it so the ends match
+    if (thread->depth < PROFILER_MAX_DEPTH) {
+        thread->open_names[thread->depth] = name;
+        thread->open_starts[thread->depth] = gettime();
+    }
+    thread->depth++;
+}
+
+void profiler_end() {
+    u64 end = gettime();
+
+    ProfilerThread *thread = get_profiler_thread();
+    if (!thread || thread->depth == 0) return;
+
+    int depth = --thread->depth;
+    if (depth >= PROFILER_MAX_DEPTH) return;
+
+    ProfileZone *zone = &thread->zones[thread->head & (PROFILER_RING_SIZE - 1)];
+    zone->name = thread->open_names[depth];
+    zone->start = thread->open_starts[depth];
+    zone->duration = end - zone->start;
+    zone->depth = depth;
+    thread->head++;
+}
+
+void profiler_end_scope(int *scope) {
+    profiler_end();
+}
+
+void profiler_dump() {
+    char path[278];
+    snprintf(path, sizeof(path), "%s/%s", launch_dir, PROFILER_FILE);
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        output_log("Couldn't open %s for the profile\n", path);
+        return;
+    }
+
+    // Timestamps start at the oldest zone still in the rings
+    u64 base = 0;
+    for (int i = 0; i < profiler_thread_count; i++) {
+        ProfilerThread *thread = &profiler_threads[i];
+        u32 first = (thread->head > PROFILER_RING_SIZE) ? thread->head - PROFILER_RING_SIZE : 0;
+        if (first == thread->head) continue;
+
+        u64 start = thread->zones[first & (PROFILER_RING_SIZE - 1)].start;
+        if (base == 0 || start < base) base = start;
+    }
+
+    fprintf(fp, "{\"traceEvents\":[\n");
+
+    int written = 0;
+    for (int i = 0; i < profiler_thread_count; i++) {
+        ProfilerThread *thread = &profiler_threads[i];
+
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            (written++ > 0) ? ",\n" : "", i, (i == 0) ? "main" : "worker");
+
+        u32 first = (thread->head > PROFILER_RING_SIZE) ? thread->head - PROFILER_RING_SIZE : 0;
+        for (u32 n = first; n < thread->head; n++) {
+            ProfileZone *zone = &thread->zones[n & (PROFILER_RING_SIZE - 1)];
+            fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%llu,\"dur\":%llu}",
+                zone->name, i,
+                (unsigned long long) ticks_to_microsecs(zone->start - base),
+                (unsigned long long) ticks_to_microsecs((u64) zone->duration));
+            written++;
+        }
+
+        thread->head = 0;
+    }
+
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    output_log("Wrote %d profiler zones to %s\n", written - profiler_thread_count, path);
+}
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+#include <gctypes.h>
+
+// Scoped zone profiler, build with -DENABLE_PROFILER to use it.
+// Zones are kept in a ring per thread and dumped as Chrome trace events
+// (open the file in chrome://tracing or ui.perfetto.dev).
+
+#define PROFILER_MAX_THREADS 4
+#define PROFILER_RING_SIZE 4096 // Must be a power of two
+#define PROFILER_MAX_DEPTH 16
+#define PROFILER_FILE "profile.json"
+
+#ifdef ENABLE_PROFILER
+
+typedef struct {
+    const char *name;
+    u64 start;
+    u32 duration;
+    u32 depth;
+} ProfileZone;
+
+void profiler_begin(const char *name);
+void profiler_end();
+void profiler_end_scope(int *scope);
+void profiler_dump();
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_BEGIN(name) profiler_begin(name)
+#define PROFILE_END() profiler_end()
+// Ends when the enclosing block does
+#define PROFILE_SCOPE(name) \
+    int PROFILE_CONCAT(profile_scope_, __LINE__) __attribute__((cleanup(profiler_end_scope), unused)) = (profiler_begin(name), 0)
+#define PROFILE_DUMP() profiler_dump()
+
+#else
+
+#define PROFILE_BEGIN(name) do {} while (0)
+#define PROFILE_END() do {} while (0)
+#define PROFILE_SCOPE(name) do {} while (0)
+#define PROFILE_DUMP() do {} while (0)
+
+#endif
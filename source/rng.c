@@ -0,0 +1,100 @@
+#include "rng.h"
+
+// Bytes of the level data hashed for its seed
+#define LEVEL_SEED_BYTES 4096
+
+RandomState random_streams[RNG_STREAM_COUNT];
+
+u32 level_random_seed = 0;
+u32 attempt_number = 0;
+
+static inline u32 rotl(const u32 x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+static inline u32 next_random(RandomState *state) {
+    u32 *s = state->s;
+    const u32 result = rotl(s[1] * 5, 7) * 9;
+    const u32 t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+
+    return result;
+}
+
+static u32 splitmix32(u32 *x) {
+    u32 z = (*x += 0x9E3779B9);
+    z = (z ^ (z >> 16)) * 0x85EBCA6B;
+    z = (z ^ (z >> 13)) * 0xC2B2AE35;
+    return z ^ (z >> 16);
+}
+
+void seed_random_stream(int stream, u32 seed) {
+    // Spread the seed so streams with close seeds don't look alike
+    u32 x = seed ^ (stream * 0x632BE59B);
+    for (int i = 0; i < 4; i++) {
+        random_streams[stream].s[i] = splitmix32(&x);
+    }
+}
+
+void seed_level_random(u32 level_seed) {
+    level_random_seed = level_seed;
+    attempt_number = 0;
+
+    for (int stream = 0; stream < RNG_STREAM_COUNT; stream++) {
+        seed_random_stream(stream, level_seed);
+    }
+}
+
+void seed_attempt_random() {
+    // Attempt N of a level always gets the same sequence
+    attempt_number++;
+    u32 x = level_random_seed ^ attempt_number;
+    u32 seed = splitmix32(&x);
+
+    for (int stream = 0; stream < RNG_STREAM_COUNT; stream++) {
+        seed_random_stream(stream, seed);
+    }
+}
+
+u32 hash_level_seed(const char *data) {
+    // FNV-1a over the start of the level
+    u32 hash = 0x811C9DC5;
+    for (int i = 0; i < LEVEL_SEED_BYTES && data[i]; i++) {
+        hash ^= (u8) data[i];
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+u32 random_u32(int stream) {
+    return next_random(&random_streams[stream]);
+}
+
+float random_float_stream(int stream, float min, float max) {
+    // Top 24 bits fit exactly in a float
+    return (next_random(&random_streams[stream]) >> 8) * (1.f / 16777216.f) * (max - min) + min;
+}
+
+int random_int_stream(int stream, int min, int max) {
+    u32 range = max + 1 - min;
+    return min + (int) (((u64) next_random(&random_streams[stream]) * range) >> 32);
+}
+
+void random_fill_floats(int stream, float *out, int count, float min, float max) {
+    // Work on a copy so the state stays in registers
+    RandomState state = random_streams[stream];
+    float scale = (max - min) * (1.f / 16777216.f);
+
+    for (int i = 0; i < count; i++) {
+        out[i] = (next_random(&state) >> 8) * scale + min;
+    }
+
+    random_streams[stream] = state;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <gctypes.h>
+
+// Independent random streams, so cosmetic effects never change
+// the values gameplay code gets
+enum RandomStreams {
+    RNG_GAMEPLAY,
+    RNG_COSMETIC,
+    RNG_STREAM_COUNT
+};
+
+// xoshiro128** state
+typedef struct {
+    u32 s[4];
+} RandomState;
+
+void seed_random_stream(int stream, u32 seed);
+void seed_level_random(u32 level_seed);
+void seed_attempt_random();
+u32 hash_level_seed(const char *data);
+
+u32 random_u32(int stream);
+float random_float_stream(int stream, float min, float max);
+int random_int_stream(int stream, int min, int max);
+void random_fill_floats(int stream, float *out, int count, float min, float max);
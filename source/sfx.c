@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <asndlib.h>
+#include <ogc/cache.h>
+#include <tremor/ivorbiscodec.h>
+#include <tremor/ivorbisfile.h>
+
+#include "sfx.h"
+#include "main.h"
+#include "game.h"
+
+#include "playSound_01_ogg.h"
+#include "explode_11_ogg.h"
+#include "endStart_02_ogg.h"
+
+typedef struct {
+    const u8 *data;
+    u32 size;
+    u32 pos;
+} SfxSource;
+
+static const struct {
+    const u8 *data;
+    const u32 *size;
+} sfx_sources[SFX_COUNT] = {
+    [SFX_PLAY_LEVEL] = { playSound_01_ogg, &playSound_01_ogg_size },
+    [SFX_EXPLODE]    = { explode_11_ogg,   &explode_11_ogg_size },
+    [SFX_END_START]  = { endStart_02_ogg,  &endStart_02_ogg_size },
+};
+
+SoundEffect sound_effects[SFX_COUNT];
+
+static int next_sfx_voice = 0;
+
+static size_t sfx_read(void *ptr, size_t size, size_t nmemb, void *datasource) {
+    SfxSource *src = datasource;
+    size_t bytes = MIN(size * nmemb, src->size - src->pos);
+    memcpy(ptr, src->data + src->pos, bytes);
+    src->pos += bytes;
+    return bytes / size;
+}
+
+static int sfx_seek(void *datasource, ogg_int64_t offset, int whence) {
+    SfxSource *src = datasource;
+    s64 pos;
+    switch (whence) {
+        case SEEK_SET: pos = offset; break;
+        case SEEK_CUR: pos = src->pos + offset; break;
+        case SEEK_END: pos = src->size + offset; break;
+        default: return -1;
+    }
+    if (pos < 0 || pos > src->size) return -1;
+    src->pos = pos;
+    return 0;
+}
+
+static long sfx_tell(void *datasource) {
+    return ((SfxSource *) datasource)->pos;
+}
+
+static const ov_callbacks sfx_callbacks = {
+    sfx_read,
+    sfx_seek,
+    NULL,
+    sfx_tell
+};
+
+static bool decode_sfx(SoundEffect *sfx, const u8 *data, u32 size) {
+    SfxSource src = { data, size, 0 };
+    OggVorbis_File vf;
+
+    if (ov_open_callbacks(&src, &vf, NULL, 0, sfx_callbacks) < 0) return FALSE;
+
+    vorbis_info *vi = ov_info(&vf, -1);
+    sfx->rate = vi->rate;
+    sfx->stereo = (vi->channels == 2);
+
+    u32 capacity = ov_pcm_total(&vf, -1) * vi->channels * sizeof(s16);
+    if ((s32) capacity <= 0) capacity = 64 * 1024;
+    u8 *pcm = malloc(capacity);
+    u32 len = 0;
+
+    int section;
+    while (pcm) {
+        if (len == capacity) {
+            capacity *= 2;
+            u8 *new_pcm = realloc(pcm, capacity);
+            if (!new_pcm) {
+                free(pcm);
+                pcm = NULL;
+                break;
+            }
+            pcm = new_pcm;
+        }
+
+        long read = ov_read(&vf, (char *) pcm + len, capacity - len, &section);
+        if (read == OV_HOLE) continue;
+        if (read <= 0) break;
+        len += read;
+    }
+    ov_clear(&vf);
+
+    if (!pcm || len == 0) {
+        free(pcm);
+        return FALSE;
+    }
+
+    // ASND wants the samples 32 byte aligned and flushed to memory
+    sfx->size = (len + 31) & ~31;
+    sfx->pcm = memalign(32, sfx->size);
+    if (!sfx->pcm) {
+        free(pcm);
+        return FALSE;
+    }
+    memcpy(sfx->pcm, pcm, len);
+    memset((u8 *) sfx->pcm + len, 0, sfx->size - len);
+    DCFlushRange(sfx->pcm, sfx->size);
+
+    free(pcm);
+    return TRUE;
+}
+
+void init_sfx() {
+    for (int i = 0; i < SFX_COUNT; i++) {
+        if (!decode_sfx(&sound_effects[i], sfx_sources[i].data, *sfx_sources[i].size)) {
+            output_log("Couldn't decode sound effect %d\n", i);
+            sound_effects[i].pcm = NULL;
+        }
+    }
+}
+
+void play_sfx(int id) {
+    SoundEffect *sfx = &sound_effects[id];
+    if (!sfx->pcm) return;
+
+    // Take a free voice, or cut the one that started the longest ago
+    int voice = -1;
+    for (int i = 0; i < SFX_VOICES; i++) {
+        int candidate = SFX_FIRST_VOICE + (next_sfx_voice + i) % SFX_VOICES;
+        if (ASND_StatusVoice(candidate) == SND_UNUSED) {
+            voice = candidate;
+            break;
+        }
+    }
+    if (voice < 0) {
+        voice = SFX_FIRST_VOICE + next_sfx_voice;
+        ASND_StopVoice(voice);
+    }
+    next_sfx_voice = (voice - SFX_FIRST_VOICE + 1) % SFX_VOICES;
+
+    ASND_SetVoice(voice, sfx->stereo ? VOICE_STEREO_16BIT : VOICE_MONO_16BIT, sfx->rate, 0,
+        sfx->pcm, sfx->size, MAX_VOLUME, MAX_VOLUME, NULL);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <gctypes.h>
+
+// Sound effects are decoded once at boot and played straight from memory,
+// each on its own ASND voice so they can overlap.
+#define MUSIC_VOICE 0 // The mp3 player's, set in main()
+#define SFX_FIRST_VOICE 1
+#define SFX_VOICES 4
+
+enum SoundEffects {
+    SFX_PLAY_LEVEL,
+    SFX_EXPLODE,
+    SFX_END_START,
+    SFX_COUNT
+};
+
+typedef struct {
+    s16 *pcm;
+    u32 size; // In bytes, padded to 32
+    int rate;
+    int stereo;
+} SoundEffect;
+
+void init_sfx();
+void play_sfx(int id);
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <mad.h>
+#include <ogc/lwp.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "song_analysis.h"
+#include "main.h"
+#include "game.h"
+
+#define ANALYSIS_INPUT_SIZE (16 * 1024)
+
+static u8 *envelope = NULL;
+static u8 *onsets = NULL;
+static u32 envelope_count = 0;
+static u32 envelope_capacity = 0;
+static volatile bool envelope_ready = FALSE;
+
+// Analysis state, the decoder structs are too big for the thread stack
+static struct mad_stream analysis_stream;
+static struct mad_frame analysis_frame;
+static struct mad_synth analysis_synth;
+static u8 analysis_input[ANALYSIS_INPUT_SIZE + MAD_BUFFER_GUARD];
+
+static char analysis_path[278];
+static u32 analysis_file_size = 0;
+static u8 analysis_stack[SONG_ANALYSIS_STACK_SIZE] ATTRIBUTE_ALIGN(8);
+static lwp_t analysis_thread = LWP_THREAD_NULL;
+static volatile bool analysis_running = FALSE;
+
+static float window_sum = 0.f;
+static u32 window_samples = 0;
+static u32 window_phase = 0;
+static float rms_history[SONG_ONSET_LAG];
+static float pulse = 0.f;
+static float pulse_decay = 0.f;
+
+static bool push_envelope_window(float rms) {
+    if (envelope_count == envelope_capacity) {
+        u32 capacity = envelope_capacity ? envelope_capacity * 2 : SONG_ENVELOPE_RATE * 120;
+        u8 *new_envelope = realloc(envelope, capacity);
+        if (!new_envelope) return FALSE;
+        envelope = new_envelope;
+
+        u8 *new_onsets = realloc(onsets, (capacity + 7) / 8);
+        if (!new_onsets) return FALSE;
+        memset(new_onsets + (envelope_capacity + 7) / 8, 0, (capacity + 7) / 8 - (envelope_capacity + 7) / 8);
+        onsets = new_onsets;
+
+        envelope_capacity = capacity;
+    }
+
+    // Same pulse the player makes live in update_pulse(), but against
+    // the window an mp3 frame ago and with the decay per window
+    float *prev = &rms_history[envelope_count % SONG_ONSET_LAG];
+    float delta = rms - *prev;
+    if (delta > SONG_ONSET_THRESHOLD) {
+        pulse += powf(delta, 0.6f) * 4.0f / SONG_ONSET_LAG;
+        onsets[envelope_count / 8] |= 1 << (envelope_count % 8);
+    }
+    pulse = CLAMP(pulse * pulse_decay, 0.f, 1.f);
+    *prev = rms;
+
+    envelope[envelope_count++] = pulse * 255.f;
+    return TRUE;
+}
+
+static bool analyze_pcm(struct mad_pcm *pcm) {
+    for (int i = 0; i < pcm->length; i++) {
+        float sample = (float) pcm->samples[0][i] / MAD_F_ONE;
+        if (pcm->channels == 2) sample = (sample + (float) pcm->samples[1][i] / MAD_F_ONE) / 2;
+
+        window_sum += sample * sample;
+        window_samples++;
+
+        // Windows are a 240th of a second at any sample rate
+        window_phase += SONG_ENVELOPE_RATE;
+        if (window_phase >= pcm->samplerate) {
+            window_phase -= pcm->samplerate;
+            if (!push_envelope_window(sqrtf(window_sum / window_samples))) return FALSE;
+            window_sum = 0.f;
+            window_samples = 0;
+        }
+    }
+    return TRUE;
+}
+
+static void save_song_envelope(const char *path) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        output_log("Couldn't save the song envelope %s\n", path);
+        return;
+    }
+
+    SongEnvelopeHeader header;
+    memcpy(header.magic, SONG_ENVELOPE_MAGIC, 4);
+    header.version = SONG_ENVELOPE_VERSION;
+    header.file_size = analysis_file_size;
+    header.rate = SONG_ENVELOPE_RATE;
+    header.count = envelope_count;
+
+    fwrite(&header, sizeof(header), 1, fp);
+    fwrite(envelope, 1, envelope_count, fp);
+    fwrite(onsets, 1, (envelope_count + 7) / 8, fp);
+    fclose(fp);
+}
+
+static bool read_song_envelope(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return FALSE;
+
+    SongEnvelopeHeader header;
+    bool ok = (fread(&header, sizeof(header), 1, fp) == 1 &&
+               memcmp(header.magic, SONG_ENVELOPE_MAGIC, 4) == 0 &&
+               header.version == SONG_ENVELOPE_VERSION &&
+               header.file_size == analysis_file_size &&
+               header.rate == SONG_ENVELOPE_RATE &&
+               header.count > 0);
+
+    if (ok) {
+        envelope = malloc(header.count);
+        onsets = malloc((header.count + 7) / 8);
+        ok = envelope && onsets &&
+             fread(envelope, 1, header.count, fp) == header.count &&
+             fread(onsets, 1, (header.count + 7) / 8, fp) == (header.count + 7) / 8;
+    }
+    fclose(fp);
+
+    if (!ok) {
+        free(envelope);
+        free(onsets);
+        envelope = NULL;
+        onsets = NULL;
+        return FALSE;
+    }
+
+    envelope_count = envelope_capacity = header.count;
+    return TRUE;
+}
+
+static void *song_analysis_thread(void *arg) {
+    FILE *fp = fopen(analysis_path, "rb");
+    if (!fp) return NULL;
+
+    u64 start = gettime();
+    bool at_end = FALSE;
+    bool ok = TRUE;
+
+    mad_stream_init(&analysis_stream);
+    mad_frame_init(&analysis_frame);
+    mad_synth_init(&analysis_synth);
+
+    while (analysis_running && ok) {
+        if (analysis_stream.buffer == NULL || analysis_stream.error == MAD_ERROR_BUFLEN) {
+            if (at_end) break;
+
+            size_t remaining = 0;
+            if (analysis_stream.next_frame != NULL) {
+                remaining = analysis_stream.bufend - analysis_stream.next_frame;
+                memmove(analysis_input, analysis_stream.next_frame, remaining);
+            }
+
+            size_t read = fread(analysis_input + remaining, 1, ANALYSIS_INPUT_SIZE - remaining, fp);
+            if (read == 0) {
+                memset(analysis_input + remaining, 0, MAD_BUFFER_GUARD);
+                read = MAD_BUFFER_GUARD;
+                at_end = TRUE;
+            }
+            mad_stream_buffer(&analysis_stream, analysis_input, remaining + read);
+        }
+
+        if (mad_frame_decode(&analysis_frame, &analysis_stream)) {
+            if (MAD_RECOVERABLE(analysis_stream.error) || analysis_stream.error == MAD_ERROR_BUFLEN) continue;
+            break;
+        }
+
+        mad_synth_frame(&analysis_synth, &analysis_frame);
+        ok = analyze_pcm(&analysis_synth.pcm);
+    }
+
+    mad_synth_finish(&analysis_synth);
+    mad_frame_finish(&analysis_frame);
+    mad_stream_finish(&analysis_stream);
+    fclose(fp);
+
+    // Stopped early or ran out of memory, try again next time
+    if (!analysis_running || !ok || envelope_count == 0) return NULL;
+
+    char env_path[283];
+    snprintf(env_path, sizeof(env_path), "%s.env", analysis_path);
+    save_song_envelope(env_path);
+
+    output_log("Analyzed %s in %.2f s\n", analysis_path, ticks_to_microsecs(gettime() - start) / 1000000.f);
+    envelope_ready = TRUE;
+    return NULL;
+}
+
+void load_song_envelope(const char *song_path) {
+    free_song_envelope();
+
+    FILE *fp = fopen(song_path, "rb");
+    if (!fp) return;
+    fseek(fp, 0, SEEK_END);
+    analysis_file_size = ftell(fp);
+    fclose(fp);
+
+    snprintf(analysis_path, sizeof(analysis_path), "%s", song_path);
+
+    char env_path[283];
+    snprintf(env_path, sizeof(env_path), "%s.env", song_path);
+    if (read_song_envelope(env_path)) {
+        envelope_ready = TRUE;
+        return;
+    }
+
+    window_sum = 0.f;
+    window_samples = 0;
+    window_phase = 0;
+    pulse = 0.f;
+    memset(rms_history, 0, sizeof(rms_history));
+    // update_pulse() decays 5% every mp3 frame
+    pulse_decay = powf(0.95f, 38.28125f / SONG_ENVELOPE_RATE);
+
+    analysis_running = TRUE;
+    if (LWP_CreateThread(&analysis_thread, song_analysis_thread, NULL, analysis_stack, SONG_ANALYSIS_STACK_SIZE, SONG_ANALYSIS_PRIORITY) < 0) {
+        output_log("Couldn't start the song analysis thread\n");
+        analysis_running = FALSE;
+        analysis_thread = LWP_THREAD_NULL;
+    }
+}
+
+void free_song_envelope() {
+    if (analysis_thread != LWP_THREAD_NULL) {
+        analysis_running = FALSE;
+        LWP_JoinThread(analysis_thread, NULL);
+        analysis_thread = LWP_THREAD_NULL;
+    }
+
+    envelope_ready = FALSE;
+    free(envelope);
+    free(onsets);
+    envelope = NULL;
+    onsets = NULL;
+    envelope_count = envelope_capacity = 0;
+}
+
+bool song_envelope_ready() {
+    return envelope_ready;
+}
+
+float get_song_envelope(float seconds) {
+    if (!envelope_ready) return 0.f;
+
+    int index = CLAMP((int) (seconds * SONG_ENVELOPE_RATE), 0, (int) envelope_count - 1);
+    return envelope[index] / 255.f;
+}
+
+bool get_song_onset(float from, float to) {
+    if (!envelope_ready) return FALSE;
+
+    int start = MAX((int) (from * SONG_ENVELOPE_RATE), 0);
+    int end = MIN((int) (to * SONG_ENVELOPE_RATE), (int) envelope_count);
+    for (int i = start; i < end; i++) {
+        if (onsets[i / 8] & (1 << (i % 8))) return TRUE;
+    }
+    return FALSE;
+}
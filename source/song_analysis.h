@@ -0,0 +1,33 @@
+#pragma once
+#include <gctypes.h>
+
+// Pulse envelope and onsets of a song, sampled at SONG_ENVELOPE_RATE and
+// cached next to it as <song>.env. tools/song2env.py writes the same file
+// on the host, otherwise it is made on a background thread the first time
+// the song is played.
+#define SONG_ENVELOPE_RATE 240
+#define SONG_ENVELOPE_MAGIC "SENV"
+#define SONG_ENVELOPE_VERSION 1
+
+// Windows between the RMS values compared to find onsets, about an mp3 frame
+#define SONG_ONSET_LAG 6
+#define SONG_ONSET_THRESHOLD 0.02f
+
+#define SONG_ANALYSIS_STACK_SIZE (16 * 1024)
+// Below the main thread, so it only runs while it waits for the retrace
+#define SONG_ANALYSIS_PRIORITY 40
+
+// File layout: header, u8 envelope[count], onset bits[(count + 7) / 8]
+typedef struct {
+    char magic[4];
+    u32 version;
+    u32 file_size; // Of the mp3, to notice a replaced song
+    u32 rate;
+    u32 count;
+} SongEnvelopeHeader;
+
+void load_song_envelope(const char *song_path);
+void free_song_envelope();
+bool song_envelope_ready();
+float get_song_envelope(float seconds);
+bool get_song_onset(float from, float to);
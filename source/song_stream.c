@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <string.h>
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/cond.h>
+
+#include "song_stream.h"
+#include "main.h"
+#include "game.h"
+
+typedef struct {
+    u8 data[SONG_STREAM_CHUNK_SIZE];
+    s32 len; // 0 while it is waiting to be filled
+    s32 pos;
+} SongStreamChunk;
+
+static SongStreamChunk stream_chunks[2] ATTRIBUTE_ALIGN(32);
+static u8 stream_stack[SONG_STREAM_STACK_SIZE] ATTRIBUTE_ALIGN(8);
+static lwp_t stream_thread = LWP_THREAD_NULL;
+static mutex_t stream_mutex;
+static cond_t stream_cond;
+
+static FILE *stream_file = NULL;
+static u32 stream_size = 0;
+static u32 stream_next_offset = 0; // Next byte the thread reads
+static int stream_read_chunk = 0;
+static int stream_fill_chunk = 0;
+static u32 stream_generation = 0; // Bumped on seek, so a read in flight is dropped
+static bool stream_primed = FALSE;
+static volatile bool stream_running = FALSE;
+
+u32 song_stream_underruns = 0;
+u32 song_stream_bytes_read = 0;
+
+static void *song_stream_thread(void *arg) {
+    LWP_MutexLock(stream_mutex);
+    while (stream_running) {
+        SongStreamChunk *chunk = &stream_chunks[stream_fill_chunk];
+
+        // Both chunks full or the whole song is read
+        if (chunk->len != 0 || stream_next_offset >= stream_size) {
+            LWP_CondWait(stream_cond, stream_mutex);
+            continue;
+        }
+
+        u32 offset = stream_next_offset;
+        u32 generation = stream_generation;
+        LWP_MutexUnlock(stream_mutex);
+
+        // The chunk is empty so the reader won't touch it meanwhile
+        fseek(stream_file, offset, SEEK_SET);
+        s32 read = fread(chunk->data, 1, MIN(SONG_STREAM_CHUNK_SIZE, stream_size - offset), stream_file);
+
+        LWP_MutexLock(stream_mutex);
+        if (generation != stream_generation) continue;
+
+        if (read <= 0) {
+            output_log("Song stream read failed at %u\n", offset);
+            stream_next_offset = stream_size;
+        } else {
+            chunk->len = read;
+            chunk->pos = 0;
+            stream_next_offset = offset + read;
+            stream_fill_chunk ^= 1;
+            song_stream_bytes_read += read;
+        }
+        LWP_CondBroadcast(stream_cond);
+    }
+    LWP_MutexUnlock(stream_mutex);
+    return NULL;
+}
+
+bool open_song_stream(const char *path) {
+    close_song_stream();
+
+    stream_file = fopen(path, "rb");
+    if (!stream_file) {
+        output_log("Failed to open song: %s\n", path);
+        return FALSE;
+    }
+    fseek(stream_file, 0, SEEK_END);
+    stream_size = ftell(stream_file);
+
+    stream_chunks[0].len = stream_chunks[1].len = 0;
+    stream_chunks[0].pos = stream_chunks[1].pos = 0;
+    stream_read_chunk = stream_fill_chunk = 0;
+    stream_next_offset = 0;
+    stream_primed = FALSE;
+    song_stream_underruns = 0;
+    song_stream_bytes_read = 0;
+
+    LWP_MutexInit(&stream_mutex, FALSE);
+    LWP_CondInit(&stream_cond);
+
+    stream_running = TRUE;
+    if (LWP_CreateThread(&stream_thread, song_stream_thread, NULL, stream_stack, SONG_STREAM_STACK_SIZE, SONG_STREAM_PRIORITY) < 0) {
+        output_log("Couldn't start the song stream thread\n");
+        stream_running = FALSE;
+        stream_thread = LWP_THREAD_NULL;
+        LWP_CondDestroy(stream_cond);
+        LWP_MutexDestroy(stream_mutex);
+        fclose(stream_file);
+        stream_file = NULL;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void close_song_stream() {
+    if (stream_thread == LWP_THREAD_NULL) return;
+
+    LWP_MutexLock(stream_mutex);
+    stream_running = FALSE;
+    LWP_CondBroadcast(stream_cond);
+    LWP_MutexUnlock(stream_mutex);
+
+    LWP_JoinThread(stream_thread, NULL);
+    stream_thread = LWP_THREAD_NULL;
+
+    LWP_CondDestroy(stream_cond);
+    LWP_MutexDestroy(stream_mutex);
+
+    if (song_stream_underruns > 0) {
+        output_log("Song stream ran dry %u times\n", song_stream_underruns);
+    }
+
+    fclose(stream_file);
+    stream_file = NULL;
+}
+
+void song_stream_seek(u32 offset) {
+    if (stream_thread == LWP_THREAD_NULL) return;
+
+    LWP_MutexLock(stream_mutex);
+    stream_generation++;
+    stream_chunks[0].len = stream_chunks[1].len = 0;
+    stream_chunks[0].pos = stream_chunks[1].pos = 0;
+    stream_read_chunk = stream_fill_chunk = 0;
+    stream_next_offset = MIN(offset, stream_size);
+    stream_primed = FALSE;
+    LWP_CondBroadcast(stream_cond);
+    LWP_MutexUnlock(stream_mutex);
+}
+
+// Reader for MP3Player_PlayFile, runs on the decoder thread
+s32 song_stream_read(void *cb_data, void *dst, s32 len) {
+    s32 copied = 0;
+    bool waited = FALSE;
+
+    if (stream_thread == LWP_THREAD_NULL) return 0;
+
+    LWP_MutexLock(stream_mutex);
+    while (copied < len && stream_running) {
+        SongStreamChunk *chunk = &stream_chunks[stream_read_chunk];
+
+        if (chunk->len == 0) {
+            // Chunks are filled in order, so the other one is empty too
+            if (stream_next_offset >= stream_size) break;
+            if (copied > 0) break;
+
+            // Waiting right after opening or seeking is expected
+            if (stream_primed && !waited) song_stream_underruns++;
+            waited = TRUE;
+            LWP_CondWait(stream_cond, stream_mutex);
+            continue;
+        }
+
+        s32 n = MIN(len - copied, chunk->len - chunk->pos);
+        memcpy((u8 *) dst + copied, chunk->data + chunk->pos, n);
+        chunk->pos += n;
+        copied += n;
+        stream_primed = TRUE;
+
+        if (chunk->pos == chunk->len) {
+            chunk->len = 0;
+            chunk->pos = 0;
+            stream_read_chunk ^= 1;
+            LWP_CondBroadcast(stream_cond);
+        }
+    }
+    LWP_MutexUnlock(stream_mutex);
+
+    return copied;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <gctypes.h>
+
+// Songs are streamed from the SD card by a prefetch thread that keeps
+// two chunks ahead of the mp3 decoder.
+#define SONG_STREAM_CHUNK_SIZE (32 * 1024)
+#define SONG_STREAM_STACK_SIZE (16 * 1024)
+// Above the mp3 decoder so a chunk is refilled as soon as it is consumed
+#define SONG_STREAM_PRIORITY 81
+
+// Times the decoder had to wait for the SD card since the song was opened
+extern u32 song_stream_underruns;
+extern u32 song_stream_bytes_read;
+
+bool open_song_stream(const char *path);
+void close_song_stream();
+void song_stream_seek(u32 offset);
+s32 song_stream_read(void *cb_data, void *dst, s32 len);
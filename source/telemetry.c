@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "telemetry.h"
+#include "main.h"
+#include "game.h"
+#include "objects.h"
+
+FrameSample frame_samples[FRAME_TELEMETRY_SIZE];
+u32 frame_sample_count = 0;
+
+// Sorted from slowest
+FrameSample worst_frames[FRAME_TELEMETRY_WORST];
+int worst_frame_count = 0;
+
+u32 frame_time_histogram[FRAME_TIME_BUCKETS];
+
+int physics_steps = 0;
+int active_triggers = 0;
+
+// Song time heard minus physics time, and the jumps made to fix it
+float audio_drift_ms = 0.f;
+int audio_resyncs = 0;
+static float max_audio_drift_ms = 0.f;
+
+void reset_frame_telemetry() {
+    frame_sample_count = 0;
+    worst_frame_count = 0;
+    audio_resyncs = 0;
+    max_audio_drift_ms = 0.f;
+    memset(frame_time_histogram, 0, sizeof(frame_time_histogram));
+}
+
+static void insert_worst_frame(FrameSample *sample) {
+    if (worst_frame_count == FRAME_TELEMETRY_WORST && sample->cpu_time_us <= worst_frames[FRAME_TELEMETRY_WORST - 1].cpu_time_us) return;
+
+    int i = MIN(worst_frame_count, FRAME_TELEMETRY_WORST - 1);
+    while (i > 0 && worst_frames[i - 1].cpu_time_us < sample->cpu_time_us) {
+        worst_frames[i] = worst_frames[i - 1];
+        i--;
+    }
+    worst_frames[i] = *sample;
+    if (worst_frame_count < FRAME_TELEMETRY_WORST) worst_frame_count++;
+}
+
+void record_frame_telemetry() {
+    u32 cpu_time_us = ticks_to_microsecs(gettime() - start_frame);
+
+    FrameSample *sample = &frame_samples[frame_sample_count & (FRAME_TELEMETRY_SIZE - 1)];
+    sample->frame = frame_sample_count;
+    sample->cpu_time_us = cpu_time_us;
+    sample->player_x = state.player.x;
+    sample->audio_drift_ms = audio_drift_ms;
+    sample->layers_drawn = MIN(layersDrawn, 0xFFFF);
+    sample->collision_checks = MIN(number_of_collisions_checks, 0xFFFF);
+    sample->active_triggers = MIN(active_triggers, 0xFFFF);
+    sample->particles = state.particles.count;
+    sample->physics_steps = MIN(physics_steps, 0xFF);
+    sample->frame_skipped = MIN(frame_skipped, 0xFF);
+    frame_sample_count++;
+
+    frame_time_histogram[MIN(cpu_time_us / FRAME_TIME_BUCKET_US, FRAME_TIME_BUCKETS - 1)]++;
+    insert_worst_frame(sample);
+
+    if (fabsf(audio_drift_ms) > fabsf(max_audio_drift_ms)) max_audio_drift_ms = audio_drift_ms;
+}
+
+static float get_frame_time_percentile(float percentile) {
+    u32 target = frame_sample_count * percentile;
+    u32 seen = 0;
+    for (int i = 0; i < FRAME_TIME_BUCKETS; i++) {
+        seen += frame_time_histogram[i];
+        if (seen > target) return (i + 1) * FRAME_TIME_BUCKET_US / 1000.f;
+    }
+    return FRAME_TIME_BUCKETS * FRAME_TIME_BUCKET_US / 1000.f;
+}
+
+void write_frame_telemetry() {
+    if (frame_sample_count == 0) return;
+
+    output_log("Frame time over %u frames: p50 %.1f ms, p95 %.1f ms, p99 %.1f ms\n", frame_sample_count,
+        get_frame_time_percentile(0.50f), get_frame_time_percentile(0.95f), get_frame_time_percentile(0.99f));
+    output_log("Music drift: max %.1f ms, %d resyncs\n", max_audio_drift_ms, audio_resyncs);
+
+    for (int i = 0; i < worst_frame_count; i++) {
+        FrameSample *sample = &worst_frames[i];
+        output_log("  Frame %u: %.2f ms at X %.0f (steps %d, skipped %d, layers %d, collisions %d, triggers %d, particles %d)\n",
+            sample->frame, sample->cpu_time_us / 1000.f, sample->player_x,
+            sample->physics_steps, sample->frame_skipped, sample->layers_drawn,
+            sample->collision_checks, sample->active_triggers, sample->particles);
+    }
+
+    char path[278];
+    snprintf(path, sizeof(path), "%s/%s", launch_dir, FRAME_TELEMETRY_FILE);
+
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        output_log("Couldn't open %s\n", path);
+        return;
+    }
+
+    fprintf(fp, "frame,cpu_ms,physics_steps,frame_skipped,layers_drawn,collision_checks,active_triggers,particles,player_x,audio_drift_ms\n");
+
+    // Only the last frames are still in the ring
+    u32 first = (frame_sample_count > FRAME_TELEMETRY_SIZE) ? frame_sample_count - FRAME_TELEMETRY_SIZE : 0;
+    for (u32 n = first; n < frame_sample_count; n++) {
+        FrameSample *sample = &frame_samples[n & (FRAME_TELEMETRY_SIZE - 1)];
+        fprintf(fp, "%u,%.3f,%d,%d,%d,%d,%d,%d,%.1f,%.2f\n",
+            sample->frame, sample->cpu_time_us / 1000.f,
+            sample->physics_steps, sample->frame_skipped, sample->layers_drawn,
+            sample->collision_checks, sample->active_triggers, sample->particles, sample->player_x,
+            sample->audio_drift_ms);
+    }
+
+    fclose(fp);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <gctypes.h>
+
+// Frames kept for the CSV, must be a power of two
+#define FRAME_TELEMETRY_SIZE 4096
+// Slowest frames listed in the summary
+#define FRAME_TELEMETRY_WORST 10
+// Frame time histogram, 0.1 ms per bucket up to 100 ms
+#define FRAME_TIME_BUCKET_US 100
+#define FRAME_TIME_BUCKETS 1000
+
+#define FRAME_TELEMETRY_FILE "frame_telemetry.csv"
+
+typedef struct {
+    u32 frame;
+    u32 cpu_time_us;
+    float player_x;
+    float audio_drift_ms;
+    u16 layers_drawn;
+    u16 collision_checks;
+    u16 active_triggers;
+    u16 particles;
+    u8 physics_steps;
+    u8 frame_skipped;
+} FrameSample;
+
+extern int physics_steps;
+extern int active_triggers;
+extern float audio_drift_ms;
+extern int audio_resyncs;
+
+void reset_frame_telemetry();
+void record_frame_telemetry();
+void write_frame_telemetry();
@@ -0,0 +1,282 @@
+#include <grrlib.h>
+#include <string.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "textures.h"
+#include "objects.h"
+#include "main.h"
+#include "math.h"
+#include "game.h"
+#include "player.h"
+
+// A texture that might be shared by the layers of several objects
+typedef struct {
+    const u8 *source;
+    GRRLIB_texImg *image;
+    u32 bytes;
+    u8 region;
+    u16 refs;
+} ResidentTexture;
+
+typedef struct {
+    float min_x;
+    float max_x;
+    u32 last_used;
+    bool registered;
+    bool resident;
+    bool pinned;
+} ObjectResidency;
+
+ResidentTexture resident_textures[MAX_RESIDENT_TEXTURES];
+int resident_texture_count = 0;
+
+ObjectResidency obj_residency[OBJECT_COUNT];
+
+TextureTelemetry texture_telemetry;
+
+const u32 texture_budget[REGION_COUNT] = {
+    TEXTURE_BUDGET_MEM1,
+    TEXTURE_BUDGET_MEM2,
+};
+
+u32 residency_frame = 0;
+int loads_this_second = 0;
+u64 loads_window_start = 0;
+
+int get_memory_region(void *ptr) {
+    // MEM2 is mapped from 0x90000000
+    return ((u32) ptr >= 0x90000000) ? REGION_MEM2 : REGION_MEM1;
+}
+
+ResidentTexture *find_resident_texture(const u8 *source) {
+    for (int i = 0; i < resident_texture_count; i++) {
+        if (resident_textures[i].source == source) return &resident_textures[i];
+    }
+    return NULL;
+}
+
+ResidentTexture *get_resident_texture(const u8 *source) {
+    ResidentTexture *entry = find_resident_texture(source);
+    if (entry) return entry;
+
+    if (resident_texture_count >= MAX_RESIDENT_TEXTURES) return NULL;
+
+    entry = &resident_textures[resident_texture_count++];
+    memset(entry, 0, sizeof(ResidentTexture));
+    entry->source = source;
+    return entry;
+}
+
+void make_obj_resident(int object) {
+    ObjectResidency *res = &obj_residency[object];
+    if (res->resident) return;
+
+    for (s32 layer = 0; layer < MAX_OBJECT_LAYERS; layer++) {
+        const u8 *texture = objects[object].layers[layer].texture;
+        if (!texture) continue;
+
+        ResidentTexture *entry = get_resident_texture(texture);
+        if (!entry) {
+            output_log_level(LOG_WARNING, "Too many textures, couldn't load object %d layer %d\n", object, layer);
+            continue;
+        }
+
+        if (!entry->image) {
+            GRRLIB_texImg *image = load_texture(texture);
+            if (image == NULL || image->data == NULL) {
+                output_log_level(LOG_ERROR, "Couldn't load texture of object %d layer %d\n", object, layer);
+                continue;
+            }
+            GRRLIB_SetHandle(image, (image->w/2), (image->h/2));
+
+            entry->image = image;
+            entry->bytes = GX_GetTexBufferSize(image->w, image->h, image->format, GX_FALSE, 0);
+            entry->region = get_memory_region(image->data);
+
+            texture_telemetry.bytes_resident[entry->region] += entry->bytes;
+            texture_telemetry.peak_bytes[entry->region] = MAX(texture_telemetry.peak_bytes[entry->region], texture_telemetry.bytes_resident[entry->region]);
+            texture_telemetry.textures_resident++;
+            texture_telemetry.loads++;
+            loads_this_second++;
+        }
+
+        entry->refs++;
+        object_images[object][layer] = entry->image;
+    }
+
+    res->resident = TRUE;
+    res->last_used = residency_frame;
+}
+
+// Returns the bytes freed, nothing if all its textures are shared with other objects
+u32 evict_obj_textures(int object) {
+    ObjectResidency *res = &obj_residency[object];
+    if (!res->resident) return 0;
+
+    u32 freed = 0;
+
+    for (s32 layer = 0; layer < MAX_OBJECT_LAYERS; layer++) {
+        const u8 *texture = objects[object].layers[layer].texture;
+        if (!texture) continue;
+
+        object_images[object][layer] = NULL;
+
+        ResidentTexture *entry = find_resident_texture(texture);
+        if (!entry || !entry->image) continue;
+
+        // Still used by other objects
+        if (--entry->refs > 0) continue;
+
+        texture_telemetry.bytes_resident[entry->region] -= entry->bytes;
+        texture_telemetry.textures_resident--;
+        GRRLIB_FreeTexture(entry->image);
+        entry->image = NULL;
+        freed += entry->bytes;
+    }
+
+    res->resident = FALSE;
+    if (freed > 0) texture_telemetry.evictions++;
+    return freed;
+}
+
+bool obj_uses_region(int object, int region) {
+    for (s32 layer = 0; layer < MAX_OBJECT_LAYERS; layer++) {
+        GRRLIB_texImg *image = object_images[object][layer];
+        if (image && get_memory_region(image->data) == region) return TRUE;
+    }
+    return FALSE;
+}
+
+bool obj_in_residency_window(ObjectResidency *res) {
+    float window_start = state.camera_x - TEXTURE_KEEP_BEHIND;
+    float window_end = state.camera_x + SCREEN_WIDTH_AREA + TEXTURE_LOOKAHEAD;
+    return res->max_x >= window_start && res->min_x <= window_end;
+}
+
+int find_lru_object(int region) {
+    int lru = -1;
+    u32 oldest = residency_frame;
+
+    for (int object = 1; object < OBJECT_COUNT; object++) {
+        ObjectResidency *res = &obj_residency[object];
+        if (!res->resident || res->pinned) continue;
+
+        // It would be loaded right back next frame
+        if (obj_in_residency_window(res)) continue;
+
+        // Don't evict stuff that was drawn this frame
+        if (res->last_used >= oldest) continue;
+        if (!obj_uses_region(object, region)) continue;
+
+        oldest = res->last_used;
+        lru = object;
+    }
+    return lru;
+}
+
+void register_obj_textures(int object, float x) {
+    if (is_object_unimplemented(object)) return;
+
+    acquire_obj_animation(object);
+
+    ObjectResidency *res = &obj_residency[object];
+    if (!res->registered) {
+        res->registered = TRUE;
+        res->min_x = x;
+        res->max_x = x;
+    } else {
+        res->min_x = MIN(res->min_x, x);
+        res->max_x = MAX(res->max_x, x);
+    }
+}
+
+void load_obj_textures(int object) {
+    if (is_object_unimplemented(object)) return;
+
+    acquire_obj_animation(object);
+
+    // Loaded outside of the level data, keep it for the whole level
+    ObjectResidency *res = &obj_residency[object];
+    res->registered = TRUE;
+    res->pinned = TRUE;
+    make_obj_resident(object);
+}
+
+void preload_obj_textures() {
+    for (int object = 1; object < OBJECT_COUNT; object++) {
+        ObjectResidency *res = &obj_residency[object];
+        if (!res->registered || res->pinned) continue;
+
+        if (obj_in_residency_window(res)) make_obj_resident(object);
+    }
+
+    loads_this_second = 0;
+    loads_window_start = gettime();
+}
+
+void touch_obj_textures(int object) {
+    ObjectResidency *res = &obj_residency[object];
+    res->last_used = residency_frame;
+
+    // Wasn't loaded ahead (moved by a trigger or just evicted), load it now
+    if (UNLIKELY(!res->resident)) {
+        texture_telemetry.misses++;
+        make_obj_resident(object);
+    }
+}
+
+void update_texture_residency() {
+    residency_frame++;
+
+    int loads = 0;
+    for (int object = 1; object < OBJECT_COUNT; object++) {
+        ObjectResidency *res = &obj_residency[object];
+        if (!res->registered || res->pinned) continue;
+
+        bool in_window = obj_in_residency_window(res);
+
+        if (!res->resident) {
+            if (in_window && loads < TEXTURE_LOADS_PER_FRAME) {
+                make_obj_resident(object);
+                loads++;
+            }
+        } else if (!in_window && residency_frame - res->last_used > TEXTURE_EVICT_FRAMES) {
+            evict_obj_textures(object);
+        }
+    }
+
+    // Over budget, evict the least recently drawn ones
+    for (int region = 0; region < REGION_COUNT; region++) {
+        while (texture_telemetry.bytes_resident[region] > texture_budget[region]) {
+            int object = find_lru_object(region);
+            if (object < 0) break;
+            // Shared textures stay, evicting more wouldn't get under budget either
+            if (evict_obj_textures(object) == 0) break;
+        }
+    }
+
+    u64 now = gettime();
+    float elapsed = ticks_to_secs_float(now - loads_window_start);
+    if (elapsed >= 1.f) {
+        texture_telemetry.loads_per_second = loads_this_second / elapsed;
+        loads_this_second = 0;
+        loads_window_start = now;
+    }
+}
+
+void unload_obj_textures() {
+    output_log("Textures: %d loads, %d misses, %d evictions, peak MEM1 %u MEM2 %u bytes\n",
+        texture_telemetry.loads, texture_telemetry.misses, texture_telemetry.evictions,
+        texture_telemetry.peak_bytes[REGION_MEM1], texture_telemetry.peak_bytes[REGION_MEM2]);
+
+    for (int i = 0; i < resident_texture_count; i++) {
+        if (resident_textures[i].image) GRRLIB_FreeTexture(resident_textures[i].image);
+    }
+    resident_texture_count = 0;
+
+    memset(object_images, 0, sizeof(object_images));
+    memset(obj_residency, 0, sizeof(obj_residency));
+    memset(&texture_telemetry, 0, sizeof(texture_telemetry));
+
+    release_obj_animations();
+}
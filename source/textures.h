@@ -0,0 +1,42 @@
+#pragma once
+#include <grrlib.h>
+
+// Max bytes of object textures kept on each memory region
+#define TEXTURE_BUDGET_MEM1 (8 * 1024 * 1024)
+#define TEXTURE_BUDGET_MEM2 (24 * 1024 * 1024)
+
+// How far past the right edge of the screen textures get loaded
+#define TEXTURE_LOOKAHEAD 900.f
+// How far behind the camera textures are kept
+#define TEXTURE_KEEP_BEHIND 300.f
+// Frames a texture has to go undrawn before it can be evicted
+#define TEXTURE_EVICT_FRAMES 120
+// Textures loaded ahead in a single frame, so it doesn't stutter
+#define TEXTURE_LOADS_PER_FRAME 4
+
+#define MAX_RESIDENT_TEXTURES 2048
+
+enum TextureRegions {
+    REGION_MEM1,
+    REGION_MEM2,
+    REGION_COUNT
+};
+
+typedef struct {
+    u32 bytes_resident[REGION_COUNT];
+    u32 peak_bytes[REGION_COUNT];
+    int textures_resident;
+    int loads;
+    int misses;
+    int evictions;
+    float loads_per_second;
+} TextureTelemetry;
+
+extern TextureTelemetry texture_telemetry;
+
+void register_obj_textures(int object, float x);
+void load_obj_textures(int object);
+void preload_obj_textures();
+void touch_obj_textures(int object);
+void update_texture_residency();
+void unload_obj_textures();
@@ -12,62 +12,50 @@
 
 #include "custom_mp3player.h"
 
-// Adds "thickness" to a line strip by generating a triangle strip
-void ccVertexLineToPolygon(const Vec2* points, float stroke, Vec2* outVerts, int offset, int count) {
-    if (count <= 0) return;
-
-    float halfStroke = stroke / 2.0f;
-
-    for (int i = offset; i < count; ++i) {
-        Vec2 p = points[i];
-        Vec2 dir;
-
-        if (i == 0) {
-            dir.x = points[i + 1].x - p.x;
-            dir.y = points[i + 1].y - p.y;
-        } else if (i == count - 1) {
-            dir.x = p.x - points[i - 1].x;
-            dir.y = p.y - points[i - 1].y;
-        } else {
-            dir.x = points[i + 1].x - points[i - 1].x;
-            dir.y = points[i + 1].y - points[i - 1].y;
-        }
+static inline float get_point_opacity(MotionTrail *trail, int idx) {
+    return 1.0f - (trail->fadeTime - trail->pointBirth[idx]);
+}
 
-        // Normalize direction
-        float len = sqrtf(dir.x * dir.x + dir.y * dir.y);
-        if (len == 0) len = 1.0f;
-        dir.x /= len;
-        dir.y /= len;
+// Adds "thickness" to the nth point of the line strip, generating its two triangle strip vertices
+static void build_trail_vertices(MotionTrail *trail, int n) {
+    int count = trail->nuPoints;
+    if (count < 2) return;
 
-        // Perpendicular vector
-        Vec2 perp;
-        perp.x = -dir.y;
-        perp.y = dir.x;
+    float halfStroke = trail->stroke / 2.0f;
 
-        // Offset left and right
-        outVerts[i * 2].x     = p.x + perp.x * halfStroke;
-        outVerts[i * 2].y     = p.y + perp.y * halfStroke;
+    int idx = TRAIL_INDEX(trail, n);
+    Vec2 p = trail->pointVertexes[idx];
+    Vec2 prev = (n > 0) ? trail->pointVertexes[TRAIL_INDEX(trail, n - 1)] : p;
+    Vec2 next = (n < count - 1) ? trail->pointVertexes[TRAIL_INDEX(trail, n + 1)] : p;
 
-        outVerts[i * 2 + 1].x = p.x - perp.x * halfStroke;
-        outVerts[i * 2 + 1].y = p.y - perp.y * halfStroke;
-    }
-}
-// Adds "vertical thickness" to a line strip by generating a triangle strip
-void ccVertexLineToPolygonWave(const Vec2* points, float stroke, Vec2* outVerts, int offset, int count) {
-    if (count <= 0) return;
+    Vec2 dir;
+    dir.x = next.x - prev.x;
+    dir.y = next.y - prev.y;
 
-    float halfStroke = stroke / 2.0f;
+    // Normalize direction
+    float len = sqrtf(dir.x * dir.x + dir.y * dir.y);
+    if (len == 0) len = 1.0f;
+    dir.x /= len;
+    dir.y /= len;
 
-    for (int i = offset; i < count; ++i) {
-        Vec2 p = points[i];
+    // Perpendicular vector
+    Vec2 perp;
+    perp.x = -dir.y;
+    perp.y = dir.x;
 
-        // Offset vertically only (same x for both vertices)
-        outVerts[i * 2].x     = p.x;
-        outVerts[i * 2].y     = p.y + halfStroke;
+    // Offset left and right
+    trail->vertices[idx * 2].x     = p.x + perp.x * halfStroke;
+    trail->vertices[idx * 2].y     = p.y + perp.y * halfStroke;
 
-        outVerts[i * 2 + 1].x = p.x;
-        outVerts[i * 2 + 1].y = p.y - halfStroke;
+    trail->vertices[idx * 2 + 1].x = p.x - perp.x * halfStroke;
+    trail->vertices[idx * 2 + 1].y = p.y - perp.y * halfStroke;
+}
+
+static void rebuild_trail_vertices(MotionTrail *trail) {
+    for (int n = 0; n < trail->nuPoints; n++) {
+        build_trail_vertices(trail, n);
     }
+    trail->builtStroke = trail->stroke;
 }
 
 static float getDistanceSq(const Vec2* a, const Vec2* b) {
@@ -78,7 +66,7 @@ static float getDistanceSq(const Vec2* a, const Vec2* b) {
 
 void MotionTrail_Clear(MotionTrail *trail) {
     trail->nuPoints = 0;
-    trail->previousNuPoints = 0;
+    trail->head = 0;
 }
 
 void MotionTrail_Init(MotionTrail* trail, float fade, float minSeg, float stroke, bool waveTrail, Color color, GRRLIB_texImg *tex) {
@@ -88,6 +76,7 @@ void MotionTrail_Init(MotionTrail* trail, float fade, float minSeg, float stroke
     trail->fadeDelta = 1.0f / fade;
     trail->minSeg = minSeg * minSeg;  // Compare squared distance
     trail->stroke = stroke;
+    trail->builtStroke = stroke;
     trail->displayedColor = color;
     trail->waveTrail = waveTrail;
     if (!waveTrail) trail->appendNewPoints = true;
@@ -99,8 +88,7 @@ void MotionTrail_ResumeStroke(MotionTrail* trail) {
         float dy = trail->positionR.y - trail->lastStopPosition.y;
 
         if (square_distance(0, 0, dx, dy) > (TRAIL_CLEAR_DISTANCE * TRAIL_CLEAR_DISTANCE)) {
-            trail->nuPoints = 0;
-            trail->previousNuPoints = 0;
+            MotionTrail_Clear(trail);
         }
         trail->wasStopped = false;
     }
@@ -119,99 +107,64 @@ void MotionTrail_Update(MotionTrail* trail, float delta) {
     if (trail->waveTrail) return;
     if (!trail->startingPositionInitialized) return;
 
-    delta *= trail->fadeDelta;
-
-    unsigned int newIdx, newIdx2, i, i2;
-    unsigned int mov = 0;
-
-    // Fade old points
-    for (i = 0; i < trail->nuPoints; i++) {
-        trail->pointState[i] -= delta;
-        if (trail->pointState[i] <= 0) {
-            mov++;
-        } else {
-            newIdx = i - mov;
-            if (mov > 0) {
-                trail->pointState[newIdx] = trail->pointState[i];
-                trail->pointVertexes[newIdx] = trail->pointVertexes[i];
-
-                i2 = i * 2;
-                newIdx2 = newIdx * 2;
-                trail->vertices[newIdx2] = trail->vertices[i2];
-                trail->vertices[newIdx2 + 1] = trail->vertices[i2 + 1];
-
-                i2 *= 4;
-                newIdx2 *= 4;
-                memcpy(&trail->colorPointer[newIdx2], &trail->colorPointer[i2], 8);
-            }
-
-            newIdx2 = newIdx * 8;
-            u8 op = (u8)(trail->pointState[newIdx] * 255.0f);
-            trail->colorPointer[newIdx2 + 3] = op;
-            trail->colorPointer[newIdx2 + 7] = op;
+    trail->fadeTime += delta * trail->fadeDelta;
+
+    // Every point fades at the same rate, so the ones that expire are always the oldest
+    int expired = 0;
+    while (trail->nuPoints > 0 && get_point_opacity(trail, trail->head) <= 0) {
+        trail->head = (trail->head + 1) & (MAX_TRAIL_POINTS - 1);
+        trail->nuPoints--;
+        expired++;
+    }
+
+    // Keep the fade time small so it doesn't lose precision
+    if (trail->fadeTime > TRAIL_REBASE_TIME) {
+        for (int n = 0; n < trail->nuPoints; n++) {
+            trail->pointBirth[TRAIL_INDEX(trail, n)] -= trail->fadeTime;
         }
+        trail->fadeTime = 0;
     }
 
-    trail->nuPoints -= mov;
+    if (trail->stroke != trail->builtStroke) {
+        // The size changed, so the whole strip has to be rebuilt
+        rebuild_trail_vertices(trail);
+    } else if (expired > 0) {
+        // The new oldest point is now an end of the strip
+        build_trail_vertices(trail, 0);
+    }
 
     // Append new point
     bool append = true;
     if (trail->nuPoints >= trail->maxPoints) {
         append = false;
     } else if (trail->nuPoints > 0) {
-        bool a1 = getDistanceSq(&trail->pointVertexes[trail->nuPoints - 1], &trail->positionR) < trail->minSeg;
-        bool a2 = (trail->nuPoints == 1) ? false : getDistanceSq(&trail->pointVertexes[trail->nuPoints - 2], &trail->positionR) < (trail->minSeg * 2.0f);
+        Vec2 *last = &trail->pointVertexes[TRAIL_INDEX(trail, trail->nuPoints - 1)];
+        bool a1 = getDistanceSq(last, &trail->positionR) < trail->minSeg;
+        bool a2 = (trail->nuPoints == 1) ? false : getDistanceSq(&trail->pointVertexes[TRAIL_INDEX(trail, trail->nuPoints - 2)], &trail->positionR) < (trail->minSeg * 2.0f);
         if (a1 || a2) append = false;
     }
 
     if (append && trail->appendNewPoints) {
-        unsigned int idx = trail->nuPoints;
+        int idx = TRAIL_INDEX(trail, trail->nuPoints);
 
         trail->pointVertexes[idx] = trail->positionR;
-        trail->pointState[idx] = 1.0f;
-
-        unsigned int offset = idx * 8;
-        trail->colorPointer[offset + 0] = trail->displayedColor.r;
-        trail->colorPointer[offset + 1] = trail->displayedColor.g;
-        trail->colorPointer[offset + 2] = trail->displayedColor.b;
-        trail->colorPointer[offset + 3] = 255;
-        trail->colorPointer[offset + 4] = trail->displayedColor.r;
-        trail->colorPointer[offset + 5] = trail->displayedColor.g;
-        trail->colorPointer[offset + 6] = trail->displayedColor.b;
-        trail->colorPointer[offset + 7] = 255;
+        trail->pointBirth[idx] = trail->fadeTime;
+        trail->pointColor[idx] = trail->displayedColor;
 
         trail->nuPoints++;
-        
-        if (trail->nuPoints > 1) {
-            ccVertexLineToPolygon(trail->pointVertexes, trail->stroke, trail->vertices, 0, trail->nuPoints);
-        }
 
-    }
-
-    if (!append || !trail->appendNewPoints) {
+        // Only the new point and the one before it change
         if (trail->nuPoints > 1) {
-            ccVertexLineToPolygon(trail->pointVertexes, trail->stroke, trail->vertices, 0, trail->nuPoints);
+            build_trail_vertices(trail, trail->nuPoints - 2);
+            build_trail_vertices(trail, trail->nuPoints - 1);
         }
     }
-
-    // Update tex coords
-    if (trail->nuPoints && trail->previousNuPoints != trail->nuPoints) {
-        float texDelta = 1.0f / trail->nuPoints;
-        for (i = 0; i < trail->nuPoints; i++) {
-            trail->texCoords[i * 2].u = 0;
-            trail->texCoords[i * 2].v = texDelta * i;
-            trail->texCoords[i * 2 + 1].u = 1;
-            trail->texCoords[i * 2 + 1].v = texDelta * i;
-        }
-        trail->previousNuPoints = trail->nuPoints;
-    }
 }
+
 void MotionTrail_UpdateWaveTrail(MotionTrail* trail, float delta) {
     if (!trail->waveTrail) return;
     if (!trail->startingPositionInitialized) return;
 
-    unsigned int mov = 0;
-    unsigned int startIdx = 0;
     trail->offscreenCount = 0;
     
     // Update stroke width
@@ -223,8 +176,8 @@ void MotionTrail_UpdateWaveTrail(MotionTrail* trail, float delta) {
     }
     
     // Get offscreen points
-    for (unsigned int i = 0; i < trail->actualNuPoints; i++) {
-        float x = trail->pointVertexes[i].x;
+    for (int n = 0; n < trail->actualNuPoints; n++) {
+        float x = trail->pointVertexes[TRAIL_INDEX(trail, n)].x;
         float calc_x = ((x - state.camera_x) * SCALE) + 6 * state.mirror_mult - widthAdjust;  
 
         if (calc_x < 0) trail->offscreenCount++;
@@ -232,77 +185,31 @@ void MotionTrail_UpdateWaveTrail(MotionTrail* trail, float delta) {
 
     // Remove the first point if two or more points are offscreen
     if (trail->offscreenCount >= 2 && trail->nuPoints > 1) {
-        startIdx = 1;
-        mov = 1;
+        trail->head = (trail->head + 1) & (MAX_TRAIL_POINTS - 1);
+        trail->nuPoints--;
     }
 
-    for (unsigned int i = startIdx; i < trail->nuPoints; ++i) {
-        unsigned int newIdx = i - mov;
-
-        if (mov > 0) {
-            trail->pointState[newIdx] = trail->pointState[i];
-            trail->pointVertexes[newIdx] = trail->pointVertexes[i];
-
-            unsigned int i2 = i * 2;
-            unsigned int newIdx2 = newIdx * 2;
-            trail->vertices[newIdx2] = trail->vertices[i2];
-            trail->vertices[newIdx2 + 1] = trail->vertices[i2 + 1];
-
-            i2 *= 4;
-            newIdx2 *= 4;
-            memcpy(&trail->colorPointer[newIdx2], &trail->colorPointer[i2], 8);
-        }
-
-        // Set opacity
-        unsigned int colorIdx = newIdx * 8;
-        trail->colorPointer[colorIdx + 3] = 255 * trail->opacity;
-        trail->colorPointer[colorIdx + 7] = 255 * trail->opacity;
-    }
-
-    trail->nuPoints -= mov;
-
     trail->actualNuPoints = trail->nuPoints + 1;
 
-    if (trail->actualNuPoints > 0) {
-        trail->pointVertexes[trail->nuPoints] = trail->positionR;
-    }
-
-    if (trail->actualNuPoints > 1) {
-        ccVertexLineToPolygonWave(trail->pointVertexes, trail->stroke, trail->vertices, 0, trail->actualNuPoints);
-        ccVertexLineToPolygonWave(trail->pointVertexes, trail->stroke * 0.4f, trail->centerVertices, 0, trail->actualNuPoints);
-    }
+    // The last point follows the player
+    int idx = TRAIL_INDEX(trail, trail->nuPoints);
+    trail->pointVertexes[idx] = trail->positionR;
+    trail->pointColor[idx] = trail->displayedColor;
 }
 
 void MotionTrail_AddWavePoint(MotionTrail* trail) {
     if (!trail->waveTrail) return;
     if (trail->actualNuPoints >= trail->maxPoints) return;
 
-    unsigned int idx = trail->nuPoints;
+    int idx = TRAIL_INDEX(trail, trail->nuPoints);
 
     trail->pointVertexes[idx] = trail->positionR;
     trail->startingPositionInitialized = TRUE;
-    trail->pointState[idx] = 1.0f;
-
-    unsigned int offset = idx * 8;
-    trail->colorPointer[offset + 0] = trail->displayedColor.r;
-    trail->colorPointer[offset + 1] = trail->displayedColor.g;
-    trail->colorPointer[offset + 2] = trail->displayedColor.b;
-    trail->colorPointer[offset + 3] = 255;
-    trail->colorPointer[offset + 4] = trail->displayedColor.r;
-    trail->colorPointer[offset + 5] = trail->displayedColor.g;
-    trail->colorPointer[offset + 6] = trail->displayedColor.b;
-    trail->colorPointer[offset + 7] = 255;
+    trail->pointColor[idx] = trail->displayedColor;
 
     trail->nuPoints++;
 
     //output_log("Added 1 - %d / %d\n", trail->nuPoints, trail->maxPoints);
-
-    if (trail->nuPoints > 1) {
-        ccVertexLineToPolygonWave(trail->pointVertexes, trail->stroke, trail->vertices, 0, trail->actualNuPoints);
-        ccVertexLineToPolygonWave(trail->pointVertexes, trail->stroke * 0.4f, trail->centerVertices, 0, trail->actualNuPoints);
-    }
-
-    trail->previousNuPoints = trail->nuPoints;
 }
 
 void MotionTrail_Draw(MotionTrail* trail) {
@@ -319,21 +226,27 @@ void MotionTrail_Draw(MotionTrail* trail) {
     GX_SetTexCoordGen(GX_TEXCOORD0, GX_TG_MTX2x4, GX_TG_TEX0, GX_IDENTITY);
     
     GX_SetTevOp  (GX_TEVSTAGE0, GX_MODULATE);
-    
-    GX_Begin(GX_TRIANGLESTRIP, GX_VTXFMT0, trail->nuPoints * 2);
-    for (int i = 0; i < trail->nuPoints * 2; i++) {
-        
-        Vec2 pos = trail->vertices[i];
-        
-        float calc_x = ((pos.x - state.camera_x) * SCALE) + 6 * state.mirror_mult - widthAdjust;  
-        float calc_y = screenHeight - ((pos.y - state.camera_y) * SCALE) + 6;
 
-        Tex2F tex = trail->texCoords[i];
-        
-        u8* color = &trail->colorPointer[i * 4];
-        GX_Position3f32(get_mirror_x(calc_x, state.mirror_factor), calc_y, 0.0f);  // Vertex position (X, Y, Z)
-        GX_Color4u8(color[0], color[1], color[2], color[3]); // Vertex color (R,G,B,A)
-        GX_TexCoord2f32(tex.u, tex.v); // Texture coordinate (U, V)
+    int count = trail->nuPoints;
+    float texDelta = (count > 0) ? 1.0f / count : 0;
+    
+    GX_Begin(GX_TRIANGLESTRIP, GX_VTXFMT0, count * 2);
+    for (int n = 0; n < count; n++) {
+        int idx = TRAIL_INDEX(trail, n);
+
+        Color color = trail->pointColor[idx];
+        u8 alpha = (u8)(get_point_opacity(trail, idx) * 255.0f);
+
+        for (int side = 0; side < 2; side++) {
+            Vec2 pos = trail->vertices[idx * 2 + side];
+            
+            float calc_x = ((pos.x - state.camera_x) * SCALE) + 6 * state.mirror_mult - widthAdjust;  
+            float calc_y = screenHeight - ((pos.y - state.camera_y) * SCALE) + 6;
+
+            GX_Position3f32(get_mirror_x(calc_x, state.mirror_factor), calc_y, 0.0f);  // Vertex position (X, Y, Z)
+            GX_Color4u8(color.r, color.g, color.b, alpha); // Vertex color (R,G,B,A)
+            GX_TexCoord2f32(side, texDelta * n); // Texture coordinate (U, V)
+        }
     }
 
     GX_End();
@@ -343,34 +256,40 @@ void MotionTrail_Draw(MotionTrail* trail) {
     GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
 }
 
-void MotionTrail_DrawWaveTrail(MotionTrail *trail) {
-    // Outer wide line
-    GX_SetVtxDesc(GX_VA_POS, GX_DIRECT);
-    GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
-    GX_SetVtxDesc(GX_VA_TEX0, GX_NONE);  // No texture
-    GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
+// Wave trails only get vertical thickness, and the stroke changes every frame with the music
+static void draw_wave_strip(MotionTrail *trail, float halfStroke, bool center) {
+    u8 alpha = 255 * trail->opacity;
 
     GX_Begin(GX_TRIANGLESTRIP, GX_VTXFMT0, trail->actualNuPoints * 2);
-    for (int i = 0; i < trail->actualNuPoints * 2; i++) {
-        Vec2 pos = trail->vertices[i];
+    for (int n = 0; n < trail->actualNuPoints; n++) {
+        int idx = TRAIL_INDEX(trail, n);
+        Vec2 pos = trail->pointVertexes[idx];
+        Color color = trail->pointColor[idx];
+
         float calc_x = ((pos.x - state.camera_x) * SCALE) + 6 * state.mirror_mult - widthAdjust;  
         float calc_y = screenHeight - ((pos.y - state.camera_y) * SCALE) + 6;
-        u8* color = &trail->colorPointer[i * 4];
+        float offset = halfStroke * SCALE;
+
+        GX_Position3f32(get_mirror_x(calc_x, state.mirror_factor), calc_y - offset, 0.0f);
+        if (center) GX_Color4u8(165, 165, 165, alpha);
+        else        GX_Color4u8(color.r, color.g, color.b, alpha);
 
-        GX_Position3f32(get_mirror_x(calc_x, state.mirror_factor), calc_y, 0.0f);
-        GX_Color4u8(color[0], color[1], color[2], color[3]);
+        GX_Position3f32(get_mirror_x(calc_x, state.mirror_factor), calc_y + offset, 0.0f);
+        if (center) GX_Color4u8(165, 165, 165, alpha);
+        else        GX_Color4u8(color.r, color.g, color.b, alpha);
     }
     GX_End();
+}
 
-    // Center thin line
-    GX_Begin(GX_TRIANGLESTRIP, GX_VTXFMT0, trail->actualNuPoints * 2);
-    for (int i = 0; i < trail->actualNuPoints * 2; i++) {
-        Vec2 pos = trail->centerVertices[i];
-        float calc_x = ((pos.x - state.camera_x) * SCALE) + 6 * state.mirror_mult - widthAdjust;  
-        float calc_y = screenHeight - ((pos.y - state.camera_y) * SCALE) + 6;
+void MotionTrail_DrawWaveTrail(MotionTrail *trail) {
+    GX_SetVtxDesc(GX_VA_POS, GX_DIRECT);
+    GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
+    GX_SetVtxDesc(GX_VA_TEX0, GX_NONE);  // No texture
+    GX_SetTevOp(GX_TEVSTAGE0, GX_PASSCLR);
 
-        GX_Position3f32(get_mirror_x(calc_x, state.mirror_factor), calc_y, 0.0f);
-        GX_Color4u8(165, 165, 165, 255 * trail->opacity);
-    }
-    GX_End();
+    // Outer wide line
+    draw_wave_strip(trail, trail->stroke / 2.0f, FALSE);
+
+    // Center thin line
+    draw_wave_strip(trail, trail->stroke * 0.4f / 2.0f, TRUE);
 }
@@ -8,24 +8,27 @@
 
 #include "objects.h"
 
+// Must be a power of two, points are stored in a ring buffer
 #define MAX_TRAIL_POINTS 128
 #define TRAIL_CLEAR_DISTANCE 30.f
 
+// Fade time after which point birth times get moved back to keep float precision
+#define TRAIL_REBASE_TIME 64.f
+
+// Physical slot of the nth oldest point
+#define TRAIL_INDEX(trail, n) (((trail)->head + (n)) & (MAX_TRAIL_POINTS - 1))
+
 typedef struct {
     float x, y;
 } Vec2;
 
-typedef struct {
-    float u, v;
-} Tex2F;
-
 typedef struct {
     bool appendNewPoints;
     bool startingPositionInitialized;
     bool waveTrail;
 
+    int head;
     int nuPoints;
-    int previousNuPoints;
     int actualNuPoints;
     int maxPoints;
     int offscreenCount;
@@ -34,19 +37,20 @@ typedef struct {
     float fadeDelta;
     float minSeg;
     float stroke;
+    float builtStroke;
+
+    // A point's opacity is 1 - (fadeTime - pointBirth)
+    float fadeTime;
 
     Vec2 positionR;
     Color displayedColor;
 
     GRRLIB_texImg *texture;
 
-    float pointState[MAX_TRAIL_POINTS];
+    float pointBirth[MAX_TRAIL_POINTS];
     Vec2 pointVertexes[MAX_TRAIL_POINTS];
-    Vec2 vertices[MAX_TRAIL_POINTS * 2];
-    u8 colorPointer[MAX_TRAIL_POINTS * 8]; // RGBA * 2 per point
-    Tex2F texCoords[MAX_TRAIL_POINTS * 2];
-    
-    Vec2 centerVertices[MAX_TRAIL_POINTS * 2];
+    Color pointColor[MAX_TRAIL_POINTS];
+    Vec2 vertices[MAX_TRAIL_POINTS * 2]; // Left and right edge per point
 
     Vec2 lastStopPosition;
     bool wasStopped;
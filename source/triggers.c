@@ -11,6 +11,7 @@
 #include <stdio.h>
 
 #include "math.h"
+#include "telemetry.h"
 
 #define MAX_DIRTY_OBJECTS 8192
 
@@ -38,6 +39,7 @@ void handle_copy_channels() {
 }
 
 void update_triggers() {
+    active_triggers = 0;
     handle_spawn_triggers();
     handle_col_triggers();
     handle_copy_channels();
@@ -66,6 +68,7 @@ void handle_pulse_triggers() {
         struct PulseTriggerBuffer *buffer = &pulse_trigger_buffer[i];
 
         if (buffer->active) {
+            active_triggers++;
             if (buffer->pulse_mode == PULSE_MODE_HSV) {
                 int id = buffer->copied_color_id;
                 if (id == 0) {
@@ -451,6 +454,7 @@ void handle_col_triggers() {
         struct ColTriggerBuffer *buffer = &col_trigger_buffer[chan];
 
         if (buffer->active) {
+            active_triggers++;
             Color lerped_color;
             Color color_to_lerp = buffer->new_color;
             float alpha_to_lerp = buffer->new_alpha;
@@ -656,6 +660,7 @@ void handle_move_triggers() {
         struct MoveTriggerBuffer* buffer = &move_trigger_buffer[slot];
         
         if (!buffer->active) continue;
+        active_triggers++;
 
         MovingGroup* group = &move_groups[buffer->target_group];
         if (!group->objects) {
@@ -802,6 +807,7 @@ void handle_spawn_triggers() {
         struct SpawnTriggerBuffer *buffer = &spawn_trigger_buffer[slot];
         
         if (buffer->active) {
+            active_triggers++;
             buffer->time_run += STEPS_DT;
             if (buffer->time_run > buffer->seconds) {
                 buffer->active = FALSE;
@@ -872,6 +878,7 @@ void handle_alpha_triggers() {
         struct AlphaTriggerBuffer *buffer = &alpha_trigger_buffer[slot];
         
         if (buffer->active) {
+            active_triggers++;
             Node *p = get_group(buffer->target_group);
             if (!p) continue;
 
@@ -0,0 +1,319 @@
+// Host benchmark of the offscreen test draw_all_object_layers() runs on every
+// layer of the sections around the camera: the fixed 90/120/240 pixel area
+// it used before against the per object radius obj_in_view() uses now.
+//
+// Usage: cull_bench level.gmd [radii.txt]
+//
+// Build: cc -O2 -o cull_bench cull_bench.c -lz -lm
+//
+// radii.txt has an "object_id radius layer_count" line per object, as
+// compute_cull_radius() works them out. They come from the object
+// definitions and texture sizes of the game build, which this can't read.
+// Without it every object keeps the old area and a single layer, so only
+// the cost of the test itself is compared.
+//
+// The camera moves through the level a quarter screen at a time at
+// y = 0 on a 640x480 screen, and no object has a fade transition. The
+// tests are copied from objects.c, keep them in sync with it. This runs
+// on the host CPU, so only compare the numbers against each other.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <zlib.h>
+
+#define OBJECT_COUNT 1329
+#define RAINBOW_ARC_SMALL 925
+#define RAINBOW_ARC_BIG 926
+
+#define GFX_SECTION_SIZE 128
+#define BLOCK_SIZE_PX 44.f
+#define SCALE (BLOCK_SIZE_PX / 30.0f)
+
+#define FADE_NONE 0
+#define CULL_FADE_SCALE 1.5f
+#define CULL_FADE_OFFSET 128.f
+
+#define REPEATS 200
+
+typedef uint64_t u64;
+
+typedef struct {
+    int id;
+    float x, y;
+    float cull_radius;
+    int transition_applied;
+} BenchObject;
+
+static const int screenWidth = 640;
+static const int screenHeight = 480;
+static const int widthAdjust = 0;
+
+static float object_radius[OBJECT_COUNT];
+static int object_layers[OBJECT_COUNT];
+
+static u64 now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Before
+static inline bool old_in_view(BenchObject *obj, float calc_x, float calc_y) {
+    int offscreen_area = 90;
+
+    // Those are way bigger
+    switch (obj->id) {
+        case RAINBOW_ARC_SMALL:
+            offscreen_area = 120;
+            break;
+        case RAINBOW_ARC_BIG:
+            offscreen_area = 240;
+            break;
+    }
+
+    if (calc_x > -offscreen_area && calc_x < screenWidth + offscreen_area) {
+        if (calc_y > -offscreen_area && calc_y < screenHeight + offscreen_area) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Now
+static inline bool obj_in_view(BenchObject *obj, float calc_x, float calc_y) {
+    float radius = obj->cull_radius;
+
+    // Fade transitions move and scale the layers
+    if (obj->transition_applied != FADE_NONE) radius = radius * CULL_FADE_SCALE + CULL_FADE_OFFSET;
+
+    return calc_x > -radius && calc_x < screenWidth + radius &&
+           calc_y > -radius && calc_y < screenHeight + radius;
+}
+
+static int base64_value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+' || c == '-') return 62;
+    if (c == '/' || c == '_') return 63;
+    return -1;
+}
+
+// The level string is gzipped and url safe base64 encoded
+static char *decode_level_string(const char *start, const char *end) {
+    size_t len = end - start;
+    unsigned char *raw = malloc(len);
+    size_t raw_len = 0;
+    unsigned int bits = 0;
+    int bit_count = 0;
+
+    for (const char *c = start; c < end; c++) {
+        int value = base64_value(*c);
+        if (value < 0) continue;
+        bits = (bits << 6) | value;
+        bit_count += 6;
+        if (bit_count >= 8) {
+            bit_count -= 8;
+            raw[raw_len++] = (bits >> bit_count) & 0xFF;
+        }
+    }
+
+    size_t out_size = raw_len * 16 + 1;
+    char *out = malloc(out_size);
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    inflateInit2(&zs, 15 + 32);
+    zs.next_in = raw;
+    zs.avail_in = raw_len;
+
+    int ret;
+    do {
+        zs.next_out = (unsigned char *) out + zs.total_out;
+        zs.avail_out = out_size - 1 - zs.total_out;
+        ret = inflate(&zs, Z_NO_FLUSH);
+        if (ret == Z_OK && zs.avail_out == 0) {
+            out_size *= 2;
+            out = realloc(out, out_size);
+        }
+    } while (ret == Z_OK);
+
+    out[zs.total_out] = '\0';
+    inflateEnd(&zs);
+    free(raw);
+
+    if (ret != Z_STREAM_END) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+static BenchObject *load_level(const char *path, int *out_count) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    size_t size = ftell(f);
+    rewind(f);
+    char *data = malloc(size + 1);
+    size_t read = fread(data, 1, size, f);
+    data[read] = '\0';
+    fclose(f);
+
+    const char *key = strstr(data, "<k>k4</k><s>");
+    const char *end = key ? strstr(key, "</s>") : NULL;
+    char *level_string = end ? decode_level_string(key + 12, end) : NULL;
+    free(data);
+    if (!level_string) return NULL;
+
+    int capacity = 1024, count = 0;
+    BenchObject *list = malloc(capacity * sizeof(BenchObject));
+
+    // Objects are separated by ';' after the level settings
+    char *saveptr;
+    char *object = strtok_r(level_string, ";", &saveptr);
+    while ((object = strtok_r(NULL, ";", &saveptr))) {
+        BenchObject obj = { 0 };
+        float scale = 1.f;
+
+        char *pairptr;
+        char *k = strtok_r(object, ",", &pairptr);
+        while (k) {
+            char *v = strtok_r(NULL, ",", &pairptr);
+            if (!v) break;
+            switch (atoi(k)) {
+                case 1: obj.id = atoi(v); break;
+                case 2: obj.x = atof(v); break;
+                case 3: obj.y = atof(v); break;
+                case 32: scale = atof(v); break;
+            }
+            k = strtok_r(NULL, ",", &pairptr);
+        }
+        if (obj.id <= 0 || obj.id >= OBJECT_COUNT) continue;
+
+        obj.cull_radius = object_radius[obj.id] * fmaxf(1.f, fabsf(scale));
+
+        if (count == capacity) {
+            capacity *= 2;
+            list = realloc(list, capacity * sizeof(BenchObject));
+        }
+        list[count++] = obj;
+    }
+
+    free(level_string);
+    *out_count = count;
+    return list;
+}
+
+static bool load_radii(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+
+    int id, layers;
+    float radius;
+    while (fscanf(f, "%d %f %d", &id, &radius, &layers) == 3) {
+        if (id <= 0 || id >= OBJECT_COUNT) continue;
+        object_radius[id] = radius;
+        object_layers[id] = layers;
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s level.gmd [radii.txt]\n", argv[0]);
+        return 1;
+    }
+
+    // Same as before unless the radii are given
+    for (int id = 0; id < OBJECT_COUNT; id++) {
+        object_radius[id] = (id == RAINBOW_ARC_BIG) ? 240 : (id == RAINBOW_ARC_SMALL) ? 120 : 90;
+        object_layers[id] = 1;
+    }
+    if (argc > 2 && !load_radii(argv[2])) {
+        fprintf(stderr, "Couldn't read %s\n", argv[2]);
+        return 1;
+    }
+
+    int object_count;
+    BenchObject *objects = load_level(argv[1], &object_count);
+    if (!objects) {
+        fprintf(stderr, "Couldn't read the level in %s\n", argv[1]);
+        return 1;
+    }
+
+    float last_x = 0;
+    for (int i = 0; i < object_count; i++) last_x = fmaxf(last_x, objects[i].x);
+
+    // Level units the screen covers, and the sections gathered around it
+    float screen_area = (screenWidth / BLOCK_SIZE_PX) * 30;
+    float gather_margin = ((int) (screen_area / 2) / GFX_SECTION_SIZE + 2) * GFX_SECTION_SIZE - screen_area / 2;
+
+    u64 old_ns = 0, new_ns = 0;
+    long tested = 0, old_passed = 0, new_passed = 0;
+    int frames = 0;
+
+    BenchObject **candidates = malloc(object_count * sizeof(BenchObject *));
+
+    for (float camera_x = 0; camera_x < last_x; camera_x += screen_area / 4, frames++) {
+        int candidate_count = 0;
+        for (int i = 0; i < object_count; i++) {
+            float x = objects[i].x;
+            if (x >= camera_x - gather_margin && x <= camera_x + screen_area + gather_margin) {
+                candidates[candidate_count++] = &objects[i];
+            }
+        }
+
+        // The test runs once per layer of every object in the gathered sections
+        int old_count = 0, new_count = 0;
+
+        u64 t0 = now_ns();
+        for (int r = 0; r < REPEATS; r++) {
+            old_count = 0;
+            for (int i = 0; i < candidate_count; i++) {
+                BenchObject *obj = candidates[i];
+                float calc_x = ((obj->x - camera_x) * SCALE) - widthAdjust;
+                float calc_y = screenHeight - (obj->y * SCALE);
+                for (int layer = 0; layer < object_layers[obj->id]; layer++) {
+                    if (old_in_view(obj, calc_x, calc_y)) old_count++;
+                }
+            }
+        }
+        u64 t1 = now_ns();
+        for (int r = 0; r < REPEATS; r++) {
+            new_count = 0;
+            for (int i = 0; i < candidate_count; i++) {
+                BenchObject *obj = candidates[i];
+                float calc_x = ((obj->x - camera_x) * SCALE) - widthAdjust;
+                float calc_y = screenHeight - (obj->y * SCALE);
+                for (int layer = 0; layer < object_layers[obj->id]; layer++) {
+                    if (obj_in_view(obj, calc_x, calc_y)) new_count++;
+                }
+            }
+        }
+        u64 t2 = now_ns();
+
+        for (int i = 0; i < candidate_count; i++) tested += object_layers[candidates[i]->id];
+        old_ns += t1 - t0;
+        new_ns += t2 - t1;
+        old_passed += old_count;
+        new_passed += new_count;
+    }
+
+    printf("%s: %d objects, %d camera positions, %.1f layers tested per frame\n",
+        argv[1], object_count, frames, (float) tested / frames);
+    printf("fixed area:      %7.2f us/frame  %7.1f layers kept\n",
+        old_ns / 1000.f / REPEATS / frames, (float) old_passed / frames);
+    printf("per object:      %7.2f us/frame  %7.1f layers kept\n",
+        new_ns / 1000.f / REPEATS / frames, (float) new_passed / frames);
+
+    free(candidates);
+    free(objects);
+    return 0;
+}
@@ -0,0 +1,357 @@
+// Host benchmark of update_particles() at MAX_PARTICLES: the array of
+// Particle structs it used to walk against the ParticlePool arrays it
+// walks now.
+//
+// Usage: particle_bench [live particles] [steps]
+//
+// Build: cc -O2 -o particle_bench particle_bench.c -lm
+//
+// Both updates are copied from particles.c, keep them in sync with it. The
+// particles never die while timing, so the new update's compaction only
+// scans. This runs on the host CPU, so only compare the numbers against
+// each other.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#define MAX_PARTICLES 512
+#define STEPS_HZ 240
+
+#define DegToRad(a) ((a) * 0.01745329252f)
+
+typedef uint8_t u8;
+typedef uint64_t u64;
+
+enum { EASE_IN, EASE_OUT };
+
+typedef struct {
+    float r, g, b, a;
+} ColorAlpha;
+
+typedef struct {
+    float x, y;
+} Player;
+
+static float dt = 1.f / STEPS_HZ;
+static Player player, player2;
+
+static u64 now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Same as easing.c, only the eases the particles use
+static float easeValue(int ease, float start, float end, float elapsed, float duration, float period) {
+    if (duration <= 0.0f) return end;
+
+    float t = elapsed / duration;
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+
+    float easedT = (ease == EASE_IN) ? powf(t, period) : powf(t, 1 / period);
+
+    return start + (end - start) * easedT;
+}
+
+/* Before: an array of structs, inactive slots included */
+
+typedef struct {
+    int group_id;
+    void *parent_obj;
+    float x, y;
+    float vx, vy;
+    float ax, ay;
+    float gravity_x, gravity_y;
+    float rotation;
+    float life;
+    bool active;
+    bool rel_gravity;
+    ColorAlpha color, start_color, end_color;
+    ColorAlpha color_delta;
+    float scale, start_scale, end_scale, scale_delta;
+    float vscale;
+    float velocity_angle;
+    float velocity_magnitude;
+    float rotate_per_second;
+    int texture_id;
+    bool blending;
+    bool lock_to_player;
+    bool trifading;
+    int priority;
+    float elapsed;
+    int player_id;
+} Particle;
+
+static Particle particles[MAX_PARTICLES];
+
+static void old_update_particles() {
+    for (int i = 0; i < MAX_PARTICLES; i++) {
+        Particle *p = &particles[i];
+        if (p->active) {
+            p->velocity_angle += p->rotate_per_second * dt;
+            if (p->rel_gravity) {
+                p->vx += (p->gravity_y * cosf(DegToRad(p->velocity_angle)) - p->gravity_x * sinf(DegToRad(p->velocity_angle))) * dt;
+                p->vy += (p->gravity_y * sinf(DegToRad(p->velocity_angle)) + p->gravity_x * cosf(DegToRad(p->velocity_angle))) * dt;
+            } else {
+                p->vx += p->gravity_x * dt;
+                p->vy += p->gravity_y * dt;
+            }
+
+            p->x += p->vx * dt;
+            p->y += p->vy * dt;
+
+            if (p->lock_to_player) {
+                if (p->player_id == 0) {
+                    p->x = player.x;
+                    p->y = player.y;
+                } else {
+                    p->x = player2.x;
+                    p->y = player2.y;
+                }
+            }
+
+            p->scale = easeValue(EASE_OUT, p->start_scale, p->end_scale, p->elapsed, p->life, 2.f);
+            p->color.r += p->color_delta.r * dt;
+            p->color.g += p->color_delta.g * dt;
+            p->color.b += p->color_delta.b * dt;
+            if (p->trifading) {
+                if (p->elapsed / p->life < 0.5f) {
+                    p->color.a = easeValue(EASE_IN, p->start_color.a, p->end_color.a, p->elapsed, p->life / 2, 2.f);
+                } else {
+                    p->color.a = easeValue(EASE_OUT, p->end_color.a, p->start_color.a, p->elapsed - (p->life / 2), p->life / 2, 2.f);
+                }
+            } else {
+                p->color.a = easeValue(EASE_OUT, p->start_color.a, p->end_color.a, p->elapsed, p->life, 2.f);
+            }
+            p->elapsed += dt;
+            if (p->elapsed >= p->life) {
+                p->active = false;
+            }
+        }
+    }
+}
+
+/* Now: a structure of arrays with the live particles packed at the start */
+
+typedef struct {
+    int count;
+
+    float x[MAX_PARTICLES];
+    float y[MAX_PARTICLES];
+    float vx[MAX_PARTICLES];
+    float vy[MAX_PARTICLES];
+    float accel_x[MAX_PARTICLES];
+    float accel_y[MAX_PARTICLES];
+    float velocity_angle[MAX_PARTICLES];
+    float rotate_per_second[MAX_PARTICLES];
+    float elapsed[MAX_PARTICLES];
+    float inv_life[MAX_PARTICLES];
+    float scale[MAX_PARTICLES];
+    float start_scale[MAX_PARTICLES];
+    float end_scale[MAX_PARTICLES];
+    float r[MAX_PARTICLES];
+    float g[MAX_PARTICLES];
+    float b[MAX_PARTICLES];
+    float a[MAX_PARTICLES];
+    float delta_r[MAX_PARTICLES];
+    float delta_g[MAX_PARTICLES];
+    float delta_b[MAX_PARTICLES];
+    float start_a[MAX_PARTICLES];
+    float end_a[MAX_PARTICLES];
+
+    float life[MAX_PARTICLES];
+    float gravity_x[MAX_PARTICLES];
+    float gravity_y[MAX_PARTICLES];
+    u8 player_id[MAX_PARTICLES];
+    u8 rel_gravity[MAX_PARTICLES];
+    u8 lock_to_player[MAX_PARTICLES];
+    u8 trifading[MAX_PARTICLES];
+} ParticlePool;
+
+static ParticlePool pool_storage;
+
+// Nothing dies while timing, so this is only the scan
+static void compact_particles(ParticlePool *pool) {
+    int count = pool->count;
+    int alive = 0;
+    for (int i = 0; i < count; i++) {
+        if (pool->elapsed[i] >= pool->life[i]) continue;
+        alive++;
+    }
+    if (alive != count) {
+        fprintf(stderr, "A particle died while timing\n");
+        exit(1);
+    }
+}
+
+static void update_particles() {
+    ParticlePool *pool = &pool_storage;
+    int count = pool->count;
+
+    // Only rotating particles with relative gravity need their gravity rotated again
+    for (int i = 0; i < count; i++) {
+        pool->velocity_angle[i] += pool->rotate_per_second[i] * dt;
+        if (pool->rel_gravity[i] && pool->rotate_per_second[i] != 0) {
+            float cos_angle = cosf(DegToRad(pool->velocity_angle[i]));
+            float sin_angle = sinf(DegToRad(pool->velocity_angle[i]));
+            pool->accel_x[i] = pool->gravity_y[i] * cos_angle - pool->gravity_x[i] * sin_angle;
+            pool->accel_y[i] = pool->gravity_y[i] * sin_angle + pool->gravity_x[i] * cos_angle;
+        }
+    }
+
+    // Branchless so the compiler can vectorize it
+    for (int i = 0; i < count; i++) {
+        pool->vx[i] += pool->accel_x[i] * dt;
+        pool->vy[i] += pool->accel_y[i] * dt;
+        pool->x[i] += pool->vx[i] * dt;
+        pool->y[i] += pool->vy[i] * dt;
+
+        float t = pool->elapsed[i] * pool->inv_life[i];
+        t = (t > 1.f) ? 1.f : t;
+
+        // EASE_OUT with a rate of 2 is a square root
+        float ease_out = sqrtf(t);
+        pool->scale[i] = pool->start_scale[i] + (pool->end_scale[i] - pool->start_scale[i]) * ease_out;
+
+        pool->r[i] += pool->delta_r[i] * dt;
+        pool->g[i] += pool->delta_g[i] * dt;
+        pool->b[i] += pool->delta_b[i] * dt;
+
+        float start_a = pool->start_a[i];
+        float end_a = pool->end_a[i];
+        float fade_alpha = start_a + (end_a - start_a) * ease_out;
+
+        // Trifading eases in to the end color on the first half, then back out
+        float half_t = t * 2;
+        float in_t = (half_t > 1.f) ? 1.f : half_t;
+        float out_t = (half_t > 1.f) ? half_t - 1.f : 0.f;
+        float trifade_in = start_a + (end_a - start_a) * (in_t * in_t);
+        float trifade_out = end_a + (start_a - end_a) * sqrtf(out_t);
+        float trifade_alpha = (t < 0.5f) ? trifade_in : trifade_out;
+
+        pool->a[i] = pool->trifading[i] ? trifade_alpha : fade_alpha;
+        pool->elapsed[i] += dt;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (pool->lock_to_player[i]) {
+            Player *p = (pool->player_id[i] == 0) ? &player : &player2;
+            pool->x[i] = p->x;
+            pool->y[i] = p->y;
+        }
+    }
+
+    compact_particles(pool);
+}
+
+static float random_float(float min, float max) {
+    return min + (max - min) * (rand() / (float) RAND_MAX);
+}
+
+// The same particles in both layouts, spread over the old array like spawns and deaths leave them
+static void spawn_particles(int live, int steps) {
+    ParticlePool *pool = &pool_storage;
+    pool->count = 0;
+
+    int stride = MAX_PARTICLES / live;
+    for (int n = 0; n < live; n++) {
+        Particle *p = &particles[n * stride];
+
+        // Long enough to outlive the timing
+        float life = steps * dt * random_float(2.f, 4.f);
+        float angle = random_float(0, 360);
+        float speed = random_float(20, 200);
+
+        p->active = true;
+        p->x = random_float(0, 500);
+        p->y = random_float(0, 300);
+        p->velocity_angle = angle;
+        p->vx = cosf(DegToRad(angle)) * speed;
+        p->vy = sinf(DegToRad(angle)) * speed;
+        p->gravity_x = random_float(-100, 100);
+        p->gravity_y = random_float(-100, 100);
+        // A quarter rotate with relative gravity, like the orb and portal effects
+        p->rel_gravity = (n % 4 == 0);
+        p->rotate_per_second = p->rel_gravity ? random_float(-90, 90) : 0;
+        p->lock_to_player = (n % 16 == 0);
+        p->player_id = n % 2;
+        p->trifading = (n % 4 == 1);
+        p->life = life;
+        p->elapsed = 0;
+        p->start_scale = random_float(0.5f, 1.5f);
+        p->end_scale = random_float(0, 0.5f);
+        p->color = p->start_color = (ColorAlpha) { 255, 255, 255, 255 };
+        p->end_color = (ColorAlpha) { 0, 128, 255, 0 };
+        p->color_delta = (ColorAlpha) { -255 / life, -127 / life, 0, -255 / life };
+
+        int i = pool->count++;
+        pool->x[i] = p->x;
+        pool->y[i] = p->y;
+        pool->vx[i] = p->vx;
+        pool->vy[i] = p->vy;
+        pool->gravity_x[i] = p->gravity_x;
+        pool->gravity_y[i] = p->gravity_y;
+        pool->velocity_angle[i] = angle;
+        pool->rotate_per_second[i] = p->rotate_per_second;
+        pool->rel_gravity[i] = p->rel_gravity;
+        if (p->rel_gravity) {
+            pool->accel_x[i] = p->gravity_y * cosf(DegToRad(angle)) - p->gravity_x * sinf(DegToRad(angle));
+            pool->accel_y[i] = p->gravity_y * sinf(DegToRad(angle)) + p->gravity_x * cosf(DegToRad(angle));
+        } else {
+            pool->accel_x[i] = p->gravity_x;
+            pool->accel_y[i] = p->gravity_y;
+        }
+        pool->lock_to_player[i] = p->lock_to_player;
+        pool->player_id[i] = p->player_id;
+        pool->trifading[i] = p->trifading;
+        pool->life[i] = life;
+        pool->inv_life[i] = 1.f / life;
+        pool->elapsed[i] = 0;
+        pool->start_scale[i] = p->start_scale;
+        pool->end_scale[i] = p->end_scale;
+        pool->r[i] = pool->g[i] = pool->b[i] = pool->a[i] = 255;
+        pool->delta_r[i] = p->color_delta.r;
+        pool->delta_g[i] = p->color_delta.g;
+        pool->delta_b[i] = p->color_delta.b;
+        pool->start_a[i] = 255;
+        pool->end_a[i] = 0;
+    }
+}
+
+int main(int argc, char **argv) {
+    int live = (argc > 1) ? atoi(argv[1]) : MAX_PARTICLES;
+    int steps = (argc > 2) ? atoi(argv[2]) : 2400;
+
+    if (live < 1 || live > MAX_PARTICLES || steps < 1) {
+        fprintf(stderr, "Usage: %s [live particles, 1 to %d] [steps]\n", argv[0], MAX_PARTICLES);
+        return 1;
+    }
+
+    srand(1);
+    spawn_particles(live, steps);
+    player = (Player) { 100, 50 };
+    player2 = (Player) { 100, 250 };
+
+    u64 t0 = now_ns();
+    for (int step = 0; step < steps; step++) old_update_particles();
+    u64 t1 = now_ns();
+    for (int step = 0; step < steps; step++) update_particles();
+    u64 t2 = now_ns();
+
+    // Keeps the compiler from dropping the updates
+    float check = 0;
+    for (int i = 0; i < MAX_PARTICLES; i++) check += particles[i].x + particles[i].color.a;
+    for (int i = 0; i < pool_storage.count; i++) check += pool_storage.x[i] + pool_storage.a[i];
+
+    float old_us = (t1 - t0) / 1000.f / steps;
+    float new_us = (t2 - t1) / 1000.f / steps;
+    printf("%d of %d particles live, %d steps (checksum %.0f)\n", live, MAX_PARTICLES, steps, check);
+    printf("array of structs:    %8.2f us/step\n", old_us);
+    printf("structure of arrays: %8.2f us/step (%.2fx)\n", new_us, old_us / new_us);
+    return 0;
+}
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+# Converts a sprite animation plist into a binary table that loadAnimations()
+# maps in place, so the Wii doesn't have to parse XML at boot.
+#
+# Usage: plist2anim.py input.plist output
+#
+# Blob layout (big endian, everything 4 byte aligned):
+#   0  char[4] "ANIM"
+#   4  u32     animation count
+#   8  animation headers, 44 bytes each:
+#        char[32] name
+#        u32      frame count
+#        u32      part count
+#        u32      offset of the poses from the start of the blob
+#   poses, [frame][part] of float x, y, sx, sy, rotation (same as SpritePart)
+#
+# Every frame of an animation gets the same part count, missing parts are
+# written with the identity pose.
+
+import re
+import struct
+import sys
+import xml.etree.ElementTree as ET
+
+MAX_NAME_LENGTH = 31
+
+HEADER_SIZE = 8
+ANIMATION_HEADER_SIZE = 44
+
+
+def dict_items(node):
+    # Plist dicts are <key> followed by its value element
+    children = list(node)
+    for i in range(0, len(children) - 1, 2):
+        if children[i].tag != 'key':
+            raise ValueError('expected <key>, got <%s>' % children[i].tag)
+        yield children[i].text or '', children[i + 1]
+
+
+def get_anim_name(frame_name):
+    # Robot_run_001.png -> Robot_run
+    name = re.sub(r'\.[^.]*$', '', frame_name)
+    underscore = name.rfind('_')
+    if underscore >= 0 and name[underscore + 1:underscore + 2].isdigit():
+        name = name[:underscore]
+    return name
+
+
+def parse_pair(text):
+    x, y = text.strip().strip('{}').split(',')
+    return float(x), float(y)
+
+
+def parse_sprite(sprite_dict):
+    x, y, sx, sy, rotation = 0.0, 0.0, 1.0, 1.0, 0.0
+    for key, value in dict_items(sprite_dict):
+        text = value.text or ''
+        if key == 'position':
+            x, y = parse_pair(text)
+        elif key == 'scale':
+            sx, sy = parse_pair(text)
+        elif key == 'rotation':
+            rotation = float(text)
+    return (x, y, sx, sy, rotation)
+
+
+def read_plist(path):
+    root = ET.parse(path).getroot()
+    if root.tag == 'plist':
+        root = root.find('dict')
+
+    container = None
+    for key, value in dict_items(root):
+        if key == 'animationContainer':
+            container = value
+            break
+
+    if container is None or container.tag != 'dict':
+        raise ValueError('no animationContainer dict found')
+
+    # Keep the order of the plist, frames are listed in play order
+    animations = {}
+    for frame_name, frame_dict in dict_items(container):
+        parts = [parse_sprite(sprite) for _, sprite in dict_items(frame_dict) if sprite.tag == 'dict']
+        animations.setdefault(get_anim_name(frame_name), []).append(parts)
+
+    return animations
+
+
+def write_blob(path, animations):
+    headers = bytearray()
+    poses = bytearray()
+    offset = HEADER_SIZE + ANIMATION_HEADER_SIZE * len(animations)
+
+    for name, frames in animations.items():
+        name_bytes = name.encode('ascii')
+        if len(name_bytes) > MAX_NAME_LENGTH:
+            raise ValueError('animation name too long: %s' % name)
+
+        part_count = max(len(parts) for parts in frames)
+        headers += struct.pack('>32sIII', name_bytes, len(frames), part_count, offset + len(poses))
+
+        for parts in frames:
+            for part in parts + [(0.0, 0.0, 1.0, 1.0, 0.0)] * (part_count - len(parts)):
+                poses += struct.pack('>5f', *part)
+
+    with open(path, 'wb') as f:
+        f.write(struct.pack('>4sI', b'ANIM', len(animations)))
+        f.write(headers)
+        f.write(poses)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print('Usage: %s input.plist output' % sys.argv[0], file=sys.stderr)
+        return 1
+
+    try:
+        animations = read_plist(sys.argv[1])
+        write_blob(sys.argv[2], animations)
+    except (ValueError, ET.ParseError) as e:
+        print('%s: %s' % (sys.argv[1], e), file=sys.stderr)
+        return 1
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
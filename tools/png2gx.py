@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+# Converts a PNG into a pre-tiled GX texture blob that load_texture() copies
+# straight into texture memory, so the Wii doesn't have to decode PNGs at runtime.
+#
+# Usage: png2gx.py [-f auto|rgba8|rgb5a3|cmpr] [-q max_error] input.png output
+#
+# Blob layout (big endian, 32 bytes header so the texture data stays aligned):
+#   0  char[4] "GXTX"
+#   4  u16     width
+#   6  u16     height
+#   8  u32     GX texture format (GX_TF_*)
+#   12 u32     data size
+#   16 pad to 32
+#   32 tiled texture data
+
+import argparse
+import struct
+import sys
+import zlib
+
+GX_TF_RGB5A3 = 0x5
+GX_TF_RGBA8 = 0x6
+GX_TF_CMPR = 0xE
+
+HEADER_SIZE = 32
+
+# Only opaque textures at least this big are considered for CMPR,
+# small sprites look too blocky with it
+CMPR_MIN_PIXELS = 128 * 128
+
+
+def read_png(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        raise ValueError('not a PNG file')
+
+    pos = 8
+    idat = []
+    palette = None
+    trns = None
+    while pos < len(data):
+        length, chunk_type = struct.unpack('>I4s', data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+
+        if chunk_type == b'IHDR':
+            width, height, depth, color_type, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+        elif chunk_type == b'PLTE':
+            palette = chunk
+        elif chunk_type == b'tRNS':
+            trns = chunk
+        elif chunk_type == b'IDAT':
+            idat.append(chunk)
+        elif chunk_type == b'IEND':
+            break
+
+    if depth != 8 or interlace:
+        raise ValueError('only 8 bit non interlaced PNGs are supported')
+
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color_type]
+    stride = width * channels
+    raw = zlib.decompress(b''.join(idat))
+
+    # Undo scanline filters
+    pixels = bytearray(stride * height)
+    prev = bytearray(stride)
+    src = 0
+    for y in range(height):
+        filter_type = raw[src]
+        line = bytearray(raw[src + 1:src + 1 + stride])
+        src += 1 + stride
+
+        if filter_type == 1:
+            for i in range(channels, stride):
+                line[i] = (line[i] + line[i - channels]) & 0xff
+        elif filter_type == 2:
+            for i in range(stride):
+                line[i] = (line[i] + prev[i]) & 0xff
+        elif filter_type == 3:
+            for i in range(stride):
+                left = line[i - channels] if i >= channels else 0
+                line[i] = (line[i] + ((left + prev[i]) >> 1)) & 0xff
+        elif filter_type == 4:
+            for i in range(stride):
+                a = line[i - channels] if i >= channels else 0
+                b = prev[i]
+                c = prev[i - channels] if i >= channels else 0
+                p = a + b - c
+                pa = abs(p - a)
+                pb = abs(p - b)
+                pc = abs(p - c)
+                if pa <= pb and pa <= pc:
+                    pred = a
+                elif pb <= pc:
+                    pred = b
+                else:
+                    pred = c
+                line[i] = (line[i] + pred) & 0xff
+
+        pixels[y * stride:(y + 1) * stride] = line
+        prev = line
+
+    # Expand to a flat RGBA list
+    rgba = []
+    for i in range(width * height):
+        px = pixels[i * channels:(i + 1) * channels]
+        if color_type == 6:
+            rgba.append(tuple(px))
+        elif color_type == 2:
+            rgba.append((px[0], px[1], px[2], 255))
+        elif color_type == 4:
+            rgba.append((px[0], px[0], px[0], px[1]))
+        elif color_type == 0:
+            rgba.append((px[0], px[0], px[0], 255))
+        else:
+            index = px[0]
+            alpha = trns[index] if trns and index < len(trns) else 255
+            rgba.append((palette[index * 3], palette[index * 3 + 1], palette[index * 3 + 2], alpha))
+
+    return width, height, rgba
+
+
+def get_pixel(rgba, width, height, x, y):
+    # Tiles past the image edge are padded with transparent pixels
+    if x >= width or y >= height:
+        return (0, 0, 0, 0)
+    return rgba[y * width + x]
+
+
+def encode_rgba8(width, height, rgba):
+    out = bytearray()
+    for ty in range(0, height, 4):
+        for tx in range(0, width, 4):
+            ar = bytearray()
+            gb = bytearray()
+            for y in range(ty, ty + 4):
+                for x in range(tx, tx + 4):
+                    r, g, b, a = get_pixel(rgba, width, height, x, y)
+                    ar += bytes((a, r))
+                    gb += bytes((g, b))
+            out += ar + gb
+    return out, 0
+
+
+def rgb5a3_pixel(r, g, b, a):
+    if a >= 0xe0:
+        value = 0x8000 | ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3)
+        decoded = (((r >> 3) * 255 + 15) // 31, ((g >> 3) * 255 + 15) // 31, ((b >> 3) * 255 + 15) // 31, 255)
+    else:
+        value = ((a >> 5) << 12) | ((r >> 4) << 8) | ((g >> 4) << 4) | (b >> 4)
+        decoded = ((r >> 4) * 17, (g >> 4) * 17, (b >> 4) * 17, ((a >> 5) * 255 + 3) // 7)
+    return value, decoded
+
+
+def encode_rgb5a3(width, height, rgba):
+    out = bytearray()
+    error = 0
+    for ty in range(0, height, 4):
+        for tx in range(0, width, 4):
+            for y in range(ty, ty + 4):
+                for x in range(tx, tx + 4):
+                    px = get_pixel(rgba, width, height, x, y)
+                    value, decoded = rgb5a3_pixel(*px)
+                    out += struct.pack('>H', value)
+                    error = max(error, pixel_error(px, decoded))
+    return out, error
+
+
+def pixel_error(original, decoded):
+    # Color error only matters as much as the pixel is visible
+    alpha = original[3]
+    color_error = max(abs(original[i] - decoded[i]) for i in range(3)) * alpha // 255
+    return max(color_error, abs(original[3] - decoded[3]))
+
+
+def to_565(color):
+    r, g, b = color[:3]
+    return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+
+
+def from_565(value):
+    r = (value >> 11) & 0x1f
+    g = (value >> 5) & 0x3f
+    b = value & 0x1f
+    return ((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2))
+
+
+def encode_cmpr_block(block):
+    opaque = [px for px in block if px[3] >= 0x80]
+    has_transparency = len(opaque) < 16
+
+    if not opaque:
+        return struct.pack('>HHI', 0, 0, 0xffffffff), [(0, 0, 0, 0)] * 16
+
+    # Endpoints are the darkest and brightest colors of the block
+    luma = lambda px: px[0] * 299 + px[1] * 587 + px[2] * 114
+    c0 = to_565(max(opaque, key=luma))
+    c1 = to_565(min(opaque, key=luma))
+
+    if has_transparency:
+        # 3 color mode, index 3 is transparent
+        if c0 > c1:
+            c0, c1 = c1, c0
+        e0, e1 = from_565(c0), from_565(c1)
+        palette = [e0, e1, tuple((e0[i] + e1[i]) // 2 for i in range(3))]
+    else:
+        if c0 < c1:
+            c0, c1 = c1, c0
+        e0, e1 = from_565(c0), from_565(c1)
+        if c0 == c1:
+            palette = [e0]
+        else:
+            palette = [e0, e1,
+                       tuple((2 * e0[i] + e1[i]) // 3 for i in range(3)),
+                       tuple((e0[i] + 2 * e1[i]) // 3 for i in range(3))]
+
+    indices = 0
+    decoded = []
+    for px in block:
+        if px[3] < 0x80:
+            index = 3
+            decoded.append((0, 0, 0, 0))
+        else:
+            index = min(range(len(palette)), key=lambda i: sum((palette[i][c] - px[c]) ** 2 for c in range(3)))
+            decoded.append(palette[index] + (255,))
+        indices = (indices << 2) | index
+
+    return struct.pack('>HHI', c0, c1, indices), decoded
+
+
+def encode_cmpr(width, height, rgba):
+    out = bytearray()
+    error = 0
+    for ty in range(0, height, 8):
+        for tx in range(0, width, 8):
+            for sy, sx in ((0, 0), (0, 4), (4, 0), (4, 4)):
+                block = [get_pixel(rgba, width, height, tx + sx + x, ty + sy + y)
+                         for y in range(4) for x in range(4)]
+                data, decoded = encode_cmpr_block(block)
+                out += data
+                for original, result in zip(block, decoded):
+                    error = max(error, pixel_error(original, result))
+    return out, error
+
+
+def choose_format(width, height, rgba, max_error):
+    # Pick the smallest format that stays within the error budget
+    binary_alpha = all(px[3] in (0, 255) for px in rgba)
+    if binary_alpha and width * height >= CMPR_MIN_PIXELS:
+        data, error = encode_cmpr(width, height, rgba)
+        if error <= max_error * 4:
+            return GX_TF_CMPR, data
+
+    data, error = encode_rgb5a3(width, height, rgba)
+    if error <= max_error:
+        return GX_TF_RGB5A3, data
+
+    return GX_TF_RGBA8, encode_rgba8(width, height, rgba)[0]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert a PNG into a GX texture blob')
+    parser.add_argument('-f', '--format', default='auto', choices=['auto', 'rgba8', 'rgb5a3', 'cmpr'])
+    parser.add_argument('-q', '--max-error', type=int, default=12,
+                        help='max per channel error allowed when picking a format automatically')
+    parser.add_argument('input')
+    parser.add_argument('output')
+    args = parser.parse_args()
+
+    try:
+        width, height, rgba = read_png(args.input)
+    except (ValueError, KeyError, zlib.error) as e:
+        print(f'{args.input}: {e}', file=sys.stderr)
+        return 1
+
+    if args.format == 'rgba8':
+        fmt, data = GX_TF_RGBA8, encode_rgba8(width, height, rgba)[0]
+    elif args.format == 'rgb5a3':
+        fmt, data = GX_TF_RGB5A3, encode_rgb5a3(width, height, rgba)[0]
+    elif args.format == 'cmpr':
+        fmt, data = GX_TF_CMPR, encode_cmpr(width, height, rgba)[0]
+    else:
+        fmt, data = choose_format(width, height, rgba, args.max_error)
+
+    header = struct.pack('>4sHHII', b'GXTX', width, height, fmt, len(data))
+    header += bytes(HEADER_SIZE - len(header))
+
+    with open(args.output, 'wb') as f:
+        f.write(header)
+        f.write(data)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
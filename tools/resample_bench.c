@@ -0,0 +1,452 @@
+// Host benchmark of the audio thread's per frame work in custom_mp3player.c:
+// libmad decoding plus Resample()/Do3Band(), in the per sample form they had
+// before and in the block form they have now.
+//
+// Usage: resample_bench [-e] song.mp3 [song.mp3 ...]
+//   -e  run the EQ with non unity gains, otherwise the block form skips it
+//       like the game does while all three gains are 1
+//
+// Build: cc -O2 -o resample_bench resample_bench.c -lmad -lm
+//
+// Prints the microseconds per mp3 frame of each stage for every song. This
+// runs on the host CPU, so only compare the numbers against each other.
+// Resample(), Do3Band() and buf_put() are copied from custom_mp3player.c,
+// keep them in sync with it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <mad.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef float f32;
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+#define DATABUFFER_SIZE			(32768)
+#define RESAMPLE_BUFFER_SIZE	(3456)
+
+typedef struct _eqstate_s
+{
+	f32 lf;
+	f32 f1p0;
+	f32 f1p1;
+	f32 f1p2;
+	f32 f1p3;
+
+	f32 hf;
+	f32 f2p0;
+	f32 f2p1;
+	f32 f2p2;
+	f32 f2p3;
+
+	f32 sdm1;
+	f32 sdm2;
+	f32 sdm3;
+
+	f32 lg;
+	f32 mg;
+	f32 hg;
+} EQState;
+
+// No thread drains it here, buf_put() drops what is in it when it's full
+struct _outbuffer_s
+{
+	u8 *bs;
+	u8 *put,*get;
+	u8 buffer[DATABUFFER_SIZE];
+};
+
+typedef union {
+	struct {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+		u16 lo;
+		u16 hi;
+#else
+		u16 hi;
+		u16 lo;
+#endif
+	} aword;
+	u32 adword;
+} dword;
+
+static struct _outbuffer_s OutputRingBuffer;
+static s16 FrameSamples[2][1152];
+static u32 ResampleBuffer[RESAMPLE_BUFFER_SIZE];
+static f32 VSA = (1.0/4294967295.0);
+static volatile float mp3_amplitude = 0.f;
+
+static u64 now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (u64)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+static inline s16 FixedToShort(mad_fixed_t Fixed)
+{
+	/* Clipping */
+	if(Fixed>=MAD_F_ONE)
+		return(SHRT_MAX);
+	if(Fixed<=-MAD_F_ONE)
+		return(-SHRT_MAX);
+
+	Fixed=Fixed>>(MAD_F_FRACBITS-15);
+	return((s16)Fixed);
+}
+
+static inline s32 buf_space(struct _outbuffer_s *buf)
+{
+	return ((DATABUFFER_SIZE - (buf->put - buf->get) - 1) % DATABUFFER_SIZE);
+}
+
+static void Init3BandState(EQState *es,s32 lowfreq,s32 highfreq,s32 mixfreq,f32 gain)
+{
+	memset(es,0,sizeof(EQState));
+
+	es->lg = gain;
+	es->mg = 1.0;
+	es->hg = gain;
+
+	es->lf = 2.0F*sinf(M_PI*((f32)lowfreq/(f32)mixfreq));
+	es->hf = 2.0F*sinf(M_PI*((f32)highfreq/(f32)mixfreq));
+}
+
+static float update_pulse(float current_amp)
+{
+	static float prev = 0.0f;
+	static float pulse = 0.0f;
+	float decay = 0.05f;
+	float delta = current_amp - prev;
+
+	if (delta > 0.02f) {
+		pulse += powf(delta, 0.6f) * 4.0f;
+	}
+
+	pulse *= (1.0f - decay);
+	if (pulse > 1.0f) pulse = 1.0f;
+	if (pulse < 0.0f) pulse = 0.0f;
+	prev = current_amp;
+
+	return pulse;
+}
+
+/* Before: one sample at a time */
+
+static inline s32 old_buf_put(struct _outbuffer_s *buf,void *data,s32 len)
+{
+	u32 *p,*put;
+	s32 cnt,i;
+
+	if(len>buf_space(buf))
+		buf->get = buf->put;
+
+	p = data;
+	put = (u32*)buf->put;
+	cnt = (buf->bs + DATABUFFER_SIZE - buf->put);
+	if(len>cnt) {
+		for(i=0;i<(cnt>>2);i++)
+			*put++ = *p++;
+		put = (u32*)buf->bs;
+		for(i=0;i<((len-cnt)>>2);i++)
+			*put++ = *p++;
+	} else {
+		for(i=0;i<(len>>2);i++)
+			*put++ = *p++;
+	}
+	buf->put = (u8*)put;
+	if(buf->put==buf->bs+DATABUFFER_SIZE) buf->put = buf->bs;
+
+	return len;
+}
+
+static s16 OldDo3Band(EQState *es,s16 sample)
+{
+	f32 l,m,h;
+
+	es->f1p0 += (es->lf*((f32)sample - es->f1p0))+VSA;
+	es->f1p1 += (es->lf*(es->f1p0 - es->f1p1));
+	es->f1p2 += (es->lf*(es->f1p1 - es->f1p2));
+	es->f1p3 += (es->lf*(es->f1p2 - es->f1p3));
+	l = es->f1p3;
+
+	es->f2p0 += (es->hf*((f32)sample - es->f2p0))+VSA;
+	es->f2p1 += (es->hf*(es->f2p0 - es->f2p1));
+	es->f2p2 += (es->hf*(es->f2p1 - es->f2p2));
+	es->f2p3 += (es->hf*(es->f2p2 - es->f2p3));
+	h = es->sdm3 - es->f2p3;
+
+	m = es->sdm3 - (h+l);
+
+	l *= es->lg;
+	m *= es->mg;
+	h *= es->hg;
+
+	es->sdm3 = es->sdm2;
+	es->sdm2 = es->sdm1;
+	es->sdm1 = (f32)sample;
+
+	return (s16)(l+m+h);
+}
+
+static void OldResample(struct mad_pcm *Pcm,EQState eqs[2],u32 stereo,u32 src_samplerate)
+{
+	u32 val32;
+	dword pos;
+	s32 incr;
+
+	pos.adword = 0;
+	incr = (u32)(((f32)src_samplerate/48000.0F)*65536.0F);
+	u64 sum_squares = 0;
+	u32 sample_count = 0;
+
+	while(pos.aword.hi < Pcm->length) {
+		s16 left = OldDo3Band(&eqs[0], FixedToShort(Pcm->samples[0][pos.aword.hi]));
+		s16 right = stereo ? OldDo3Band(&eqs[1], FixedToShort(Pcm->samples[1][pos.aword.hi])) : left;
+
+		// Average stereo to mono
+		s16 mono = (left + right) / 2;
+
+		// Accumulate square of sample
+		sum_squares += mono * mono;
+		sample_count++;
+
+		val32 = ((u16)left << 16) | ((u16)right & 0xFFFF);
+		old_buf_put(&OutputRingBuffer, &val32, sizeof(u32));
+
+		pos.adword += incr;
+	}
+
+	if (sample_count > 0) {
+		// RMS amplitude normalized to 0.0–1.0 (16-bit audio)
+		float rms = sqrtf((float)sum_squares / sample_count) / 32768.0f;
+
+		mp3_amplitude = update_pulse(rms);
+	}
+}
+
+/* Now: a whole frame at a time */
+
+static inline s32 buf_put(struct _outbuffer_s *buf,void *data,s32 len)
+{
+	u8 *p;
+	s32 cnt;
+
+	if(len>buf_space(buf))
+		buf->get = buf->put;
+
+	p = data;
+	cnt = (buf->bs + DATABUFFER_SIZE - buf->put);
+	if(len>=cnt) {
+		memcpy(buf->put,p,cnt);
+		memcpy(buf->bs,p+cnt,len-cnt);
+		buf->put = buf->bs + (len-cnt);
+	} else {
+		memcpy(buf->put,p,len);
+		buf->put += len;
+	}
+
+	return len;
+}
+
+static void Do3Band(EQState *es,s16 *samples,u32 count)
+{
+	u32 i;
+
+	// With unity gains the bands add back up to the input
+	if(es->lg==1.0F && es->mg==1.0F && es->hg==1.0F)
+		return;
+
+	// Work on a local copy so the state stays in registers
+	EQState eq = *es;
+	for(i=0;i<count;i++) {
+		f32 l,m,h;
+		f32 sample = samples[i];
+
+		eq.f1p0 += (eq.lf*(sample - eq.f1p0))+VSA;
+		eq.f1p1 += (eq.lf*(eq.f1p0 - eq.f1p1));
+		eq.f1p2 += (eq.lf*(eq.f1p1 - eq.f1p2));
+		eq.f1p3 += (eq.lf*(eq.f1p2 - eq.f1p3));
+		l = eq.f1p3;
+
+		eq.f2p0 += (eq.hf*(sample - eq.f2p0))+VSA;
+		eq.f2p1 += (eq.hf*(eq.f2p0 - eq.f2p1));
+		eq.f2p2 += (eq.hf*(eq.f2p1 - eq.f2p2));
+		eq.f2p3 += (eq.hf*(eq.f2p2 - eq.f2p3));
+		h = eq.sdm3 - eq.f2p3;
+
+		m = eq.sdm3 - (h+l);
+
+		eq.sdm3 = eq.sdm2;
+		eq.sdm2 = eq.sdm1;
+		eq.sdm1 = sample;
+
+		samples[i] = (s16)(l*eq.lg + m*eq.mg + h*eq.hg);
+	}
+	*es = eq;
+}
+
+static void Resample(struct mad_pcm *Pcm,EQState eqs[2],u32 stereo,u32 src_samplerate)
+{
+	dword pos;
+	u32 incr,i,len,count = 0;
+	u64 sum_squares = 0;
+	s16 *left = FrameSamples[0];
+	s16 *right = stereo ? FrameSamples[1] : FrameSamples[0];
+
+	len = MIN(Pcm->length,1152);
+	for(i=0;i<len;i++)
+		left[i] = FixedToShort(Pcm->samples[0][i]);
+	Do3Band(&eqs[0],left,len);
+
+	if(stereo) {
+		for(i=0;i<len;i++)
+			right[i] = FixedToShort(Pcm->samples[1][i]);
+		Do3Band(&eqs[1],right,len);
+	}
+
+	pos.adword = 0;
+	incr = (u32)(((f32)src_samplerate/48000.0F)*65536.0F);
+
+	while(pos.aword.hi<len && count<RESAMPLE_BUFFER_SIZE) {
+		s16 l = left[pos.aword.hi];
+		s16 r = right[pos.aword.hi];
+		s32 mono = (l + r)/2;
+
+		sum_squares += mono*mono;
+		ResampleBuffer[count++] = ((u16)l<<16) | (u16)r;
+		pos.adword += incr;
+	}
+
+	if(count==0) return;
+
+	buf_put(&OutputRingBuffer,ResampleBuffer,count*sizeof(u32));
+
+	// RMS amplitude normalized to 0.0–1.0 (16-bit audio)
+	float rms = sqrtf((float)sum_squares / count) / 32768.0f;
+	mp3_amplitude = update_pulse(rms);
+}
+
+static u8 *read_song(const char *path,size_t *out_size)
+{
+	FILE *f = fopen(path,"rb");
+	if(!f) return NULL;
+
+	fseek(f,0,SEEK_END);
+	size_t size = ftell(f);
+	rewind(f);
+
+	// libmad reads up to MAD_BUFFER_GUARD bytes past the last frame
+	u8 *data = calloc(1,size+MAD_BUFFER_GUARD);
+	if(data && fread(data,1,size,f)!=size) {
+		free(data);
+		data = NULL;
+	}
+	fclose(f);
+
+	*out_size = size;
+	return data;
+}
+
+static void bench_song(const char *path,f32 gain)
+{
+	size_t size;
+	u8 *data = read_song(path,&size);
+	if(!data) {
+		fprintf(stderr,"Couldn't read %s\n",path);
+		return;
+	}
+
+	struct mad_stream Stream;
+	struct mad_frame Frame;
+	struct mad_synth Synth;
+	EQState old_eqs[2],new_eqs[2];
+
+	mad_stream_init(&Stream);
+	mad_frame_init(&Frame);
+	mad_synth_init(&Synth);
+	mad_stream_buffer(&Stream,data,size+MAD_BUFFER_GUARD);
+
+	for(int i=0;i<2;i++) {
+		Init3BandState(&old_eqs[i],880,5000,48000,gain);
+		Init3BandState(&new_eqs[i],880,5000,48000,gain);
+	}
+
+	OutputRingBuffer.bs = OutputRingBuffer.buffer;
+	OutputRingBuffer.put = OutputRingBuffer.get = OutputRingBuffer.bs;
+
+	u64 decode_ns = 0,old_ns = 0,new_ns = 0;
+	u32 frames = 0;
+
+	while(1) {
+		u64 t0 = now_ns();
+		if(mad_frame_decode(&Frame,&Stream)) {
+			if(MAD_RECOVERABLE(Stream.error)) continue;
+			break;
+		}
+		mad_synth_frame(&Synth,&Frame);
+		u64 t1 = now_ns();
+
+		u32 stereo = (MAD_NCHANNELS(&Frame.header)==2);
+		OldResample(&Synth.pcm,old_eqs,stereo,Frame.header.samplerate);
+		u64 t2 = now_ns();
+		Resample(&Synth.pcm,new_eqs,stereo,Frame.header.samplerate);
+		u64 t3 = now_ns();
+
+		decode_ns += t1 - t0;
+		old_ns += t2 - t1;
+		new_ns += t3 - t2;
+		frames++;
+	}
+
+	mad_synth_finish(&Synth);
+	mad_frame_finish(&Frame);
+	mad_stream_finish(&Stream);
+	free(data);
+
+	if(frames==0) {
+		fprintf(stderr,"No frames in %s\n",path);
+		return;
+	}
+
+	f32 decode_us = decode_ns/1000.0/frames;
+	f32 old_us = old_ns/1000.0/frames;
+	f32 new_us = new_ns/1000.0/frames;
+	printf("%-32s %6u %8.2f %8.2f %8.2f %9.2f %9.2f\n",path,frames,decode_us,
+		old_us,new_us,decode_us+old_us,decode_us+new_us);
+}
+
+int main(int argc,char **argv)
+{
+	f32 gain = 1.0F;
+	int first = 1;
+
+	if(argc>1 && strcmp(argv[1],"-e")==0) {
+		gain = 1.5F;
+		first = 2;
+	}
+
+	if(first>=argc) {
+		fprintf(stderr,"Usage: %s [-e] song.mp3 [song.mp3 ...]\n",argv[0]);
+		return 1;
+	}
+
+	printf("%-32s %6s %8s %8s %8s %9s %9s\n","song","frames","decode",
+		"old","new","total old","total new");
+	printf("%-32s %6s %8s %8s %8s %9s %9s\n","","","us/frame",
+		"us/frame","us/frame","us/frame","us/frame");
+
+	for(int i=first;i<argc;i++)
+		bench_song(argv[i],gain);
+
+	return 0;
+}
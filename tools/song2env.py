@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+# Analyzes songs into the pulse envelope and onset table the game looks up
+# while playing, so the Wii doesn't have to decode the whole song first.
+# Each song gets a <song>.env next to it, copy it with the song to the SD card.
+#
+# Usage: song2env.py song.mp3 [song.mp3 ...]
+#
+# Needs ffmpeg in the PATH to decode the mp3s. ffmpeg leaves out the
+# Xing/Info frame and the LAME encoder delay, which libmad plays, so that
+# much silence is put back in front to line the windows up with the game.
+#
+# File layout (big endian):
+#   0  char[4] "SENV"
+#   4  u32     version
+#   8  u32     size of the mp3 file
+#   12 u32     windows per second (240)
+#   16 u32     window count
+#   20 u8      envelope[count], pulse from 0 to 255
+#      u8      onset bits[(count + 7) / 8], window i is bit i % 8 of byte i / 8
+#
+# Must match the analysis in source/song_analysis.c.
+
+import array
+import math
+import os
+import struct
+import subprocess
+import sys
+
+ENVELOPE_RATE = 240
+ENVELOPE_VERSION = 1
+ONSET_LAG = 6
+ONSET_THRESHOLD = 0.02
+# update_pulse() decays 5% every mp3 frame
+PULSE_DECAY = 0.95 ** (38.28125 / ENVELOPE_RATE)
+
+SAMPLE_RATE = 48000
+
+# libmad's own delay, ffmpeg skips it along with the LAME encoder delay
+DECODER_DELAY = 529
+
+MPEG_SAMPLE_RATES = {
+    3: (44100, 48000, 32000),  # MPEG 1
+    2: (22050, 24000, 16000),  # MPEG 2
+    0: (11025, 12000, 8000),   # MPEG 2.5
+}
+
+
+def skipped_samples(path):
+    """Samples at the start of the song that libmad plays and ffmpeg drops."""
+    with open(path, 'rb') as f:
+        data = f.read(64 * 1024)
+
+    pos = 0
+    if data[:3] == b'ID3' and len(data) >= 10:
+        size = (data[6] << 21) | (data[7] << 14) | (data[8] << 7) | data[9]
+        pos = 10 + size + (10 if data[5] & 0x10 else 0)
+        if pos + 4 > len(data):
+            with open(path, 'rb') as f:
+                f.seek(pos)
+                data = f.read(64 * 1024)
+            pos = 0
+
+    # First frame header
+    while pos + 4 <= len(data) and not (data[pos] == 0xFF and (data[pos + 1] & 0xE0) == 0xE0):
+        pos += 1
+    if pos + 4 > len(data):
+        return 0
+
+    version = (data[pos + 1] >> 3) & 3
+    rate_index = (data[pos + 2] >> 2) & 3
+    mono = (data[pos + 3] >> 6) == 3
+    if version == 1 or rate_index == 3:
+        return 0
+    samplerate = MPEG_SAMPLE_RATES[version][rate_index]
+    samples_per_frame = 1152 if version == 3 else 576
+
+    if version == 3:
+        side_info = 17 if mono else 32
+    else:
+        side_info = 9 if mono else 17
+
+    skipped = 0
+    xing = pos + 4 + side_info
+    if data[xing:xing + 4] in (b'Xing', b'Info'):
+        skipped += samples_per_frame
+        flags = struct.unpack('>I', data[xing + 4:xing + 8])[0]
+        lame = xing + 8
+        lame += 4 if flags & 1 else 0     # Frames
+        lame += 4 if flags & 2 else 0     # Bytes
+        lame += 100 if flags & 4 else 0   # TOC
+        lame += 4 if flags & 8 else 0     # Quality
+        if data[lame:lame + 4] == b'LAME' and lame + 24 <= len(data):
+            delay = (data[lame + 21] << 4) | (data[lame + 22] >> 4)
+            skipped += delay + DECODER_DELAY
+    elif data[pos + 36:pos + 40] == b'VBRI':
+        skipped += samples_per_frame
+
+    return round(skipped * SAMPLE_RATE / samplerate)
+
+
+def decode(path):
+    pcm = subprocess.run(
+        ['ffmpeg', '-v', 'error', '-i', path, '-f', 's16be', '-ac', '1', '-ar', str(SAMPLE_RATE), '-'],
+        check=True, stdout=subprocess.PIPE).stdout
+    samples = array.array('h', bytes(2 * skipped_samples(path)))
+    decoded = array.array('h')
+    decoded.frombytes(pcm)
+    if sys.byteorder == 'little':
+        decoded.byteswap()
+    samples.extend(decoded)
+    return samples
+
+
+def analyze(samples):
+    envelope = bytearray()
+    onsets = bytearray()
+    history = [0.0] * ONSET_LAG
+    pulse = 0.0
+
+    window_sum = 0.0
+    window_samples = 0
+    phase = 0
+    for sample in samples:
+        sample /= 32768.0
+        window_sum += sample * sample
+        window_samples += 1
+
+        phase += ENVELOPE_RATE
+        if phase < SAMPLE_RATE:
+            continue
+        phase -= SAMPLE_RATE
+
+        count = len(envelope)
+        rms = math.sqrt(window_sum / window_samples)
+        window_sum = 0.0
+        window_samples = 0
+
+        if count % 8 == 0:
+            onsets.append(0)
+
+        delta = rms - history[count % ONSET_LAG]
+        if delta > ONSET_THRESHOLD:
+            pulse += delta ** 0.6 * 4.0 / ONSET_LAG
+            onsets[count // 8] |= 1 << (count % 8)
+        pulse = min(max(pulse * PULSE_DECAY, 0.0), 1.0)
+        history[count % ONSET_LAG] = rms
+
+        envelope.append(int(pulse * 255.0))
+
+    return envelope, onsets
+
+
+def main():
+    if len(sys.argv) < 2:
+        print('Usage: %s song.mp3 [song.mp3 ...]' % sys.argv[0], file=sys.stderr)
+        return 1
+
+    for path in sys.argv[1:]:
+        try:
+            envelope, onsets = analyze(decode(path))
+        except (OSError, subprocess.CalledProcessError) as e:
+            print('%s: %s' % (path, e), file=sys.stderr)
+            return 1
+
+        with open(path + '.env', 'wb') as f:
+            f.write(struct.pack('>4sIIII', b'SENV', ENVELOPE_VERSION, os.path.getsize(path),
+                                ENVELOPE_RATE, len(envelope)))
+            f.write(envelope)
+            f.write(onsets)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
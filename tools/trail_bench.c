@@ -0,0 +1,454 @@
+// Host benchmark of MotionTrail_Update() at MAX_TRAIL_POINTS: the shifting
+// arrays trail.c used before against the ring buffer it uses now.
+//
+// Usage: trail_bench [steps]
+//
+// Build: cc -O2 -o trail_bench trail_bench.c -lm
+//
+// Runs two cases. "full" appends a point every step and fades them so the
+// trail stays at MAX_TRAIL_POINTS. "game" uses the player's trail settings
+// (0.3 seconds of fade, 3 units between points) moving at normal speed.
+// Each step also copies the trail in and out once, like game.c does for
+// every player. The updates are copied from trail.c, keep them in sync
+// with it. This runs on the host CPU, so only compare the numbers against
+// each other.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define MAX_TRAIL_POINTS 128
+#define STEPS_HZ 240
+
+// Fade time after which point birth times get moved back to keep float precision
+#define TRAIL_REBASE_TIME 64.f
+
+// Physical slot of the nth oldest point
+#define TRAIL_INDEX(trail, n) (((trail)->head + (n)) & (MAX_TRAIL_POINTS - 1))
+
+typedef uint8_t u8;
+typedef uint64_t u64;
+
+typedef struct {
+    u8 r;
+    u8 b;
+    u8 g;
+} Color;
+
+typedef struct {
+    float x, y;
+} Vec2;
+
+typedef struct {
+    float u, v;
+} Tex2F;
+
+static u64 now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static float getDistanceSq(const Vec2* a, const Vec2* b) {
+    float dx = a->x - b->x;
+    float dy = a->y - b->y;
+    return dx*dx + dy*dy;
+}
+
+/* Before: points shifted down as they expire, the strip rebuilt on every append */
+
+typedef struct {
+    bool appendNewPoints;
+    bool startingPositionInitialized;
+    bool waveTrail;
+
+    int nuPoints;
+    int previousNuPoints;
+    int actualNuPoints;
+    int maxPoints;
+    int offscreenCount;
+
+    float opacity;
+    float fadeDelta;
+    float minSeg;
+    float stroke;
+
+    Vec2 positionR;
+    Color displayedColor;
+
+    void *texture;
+
+    float pointState[MAX_TRAIL_POINTS];
+    Vec2 pointVertexes[MAX_TRAIL_POINTS];
+    Vec2 vertices[MAX_TRAIL_POINTS * 2];
+    u8 colorPointer[MAX_TRAIL_POINTS * 8]; // RGBA * 2 per point
+    Tex2F texCoords[MAX_TRAIL_POINTS * 2];
+
+    Vec2 centerVertices[MAX_TRAIL_POINTS * 2];
+
+    Vec2 lastStopPosition;
+    bool wasStopped;
+
+} OldMotionTrail;
+
+// Adds "thickness" to a line strip by generating a triangle strip
+static void ccVertexLineToPolygon(const Vec2* points, float stroke, Vec2* outVerts, int offset, int count) {
+    if (count <= 0) return;
+
+    float halfStroke = stroke / 2.0f;
+
+    for (int i = offset; i < count; ++i) {
+        Vec2 p = points[i];
+        Vec2 dir;
+
+        if (i == 0) {
+            dir.x = points[i + 1].x - p.x;
+            dir.y = points[i + 1].y - p.y;
+        } else if (i == count - 1) {
+            dir.x = p.x - points[i - 1].x;
+            dir.y = p.y - points[i - 1].y;
+        } else {
+            dir.x = points[i + 1].x - points[i - 1].x;
+            dir.y = points[i + 1].y - points[i - 1].y;
+        }
+
+        // Normalize direction
+        float len = sqrtf(dir.x * dir.x + dir.y * dir.y);
+        if (len == 0) len = 1.0f;
+        dir.x /= len;
+        dir.y /= len;
+
+        // Perpendicular vector
+        Vec2 perp;
+        perp.x = -dir.y;
+        perp.y = dir.x;
+
+        // Offset left and right
+        outVerts[i * 2].x     = p.x + perp.x * halfStroke;
+        outVerts[i * 2].y     = p.y + perp.y * halfStroke;
+
+        outVerts[i * 2 + 1].x = p.x - perp.x * halfStroke;
+        outVerts[i * 2 + 1].y = p.y - perp.y * halfStroke;
+    }
+}
+
+static void OldMotionTrail_Init(OldMotionTrail* trail, float fade, float minSeg, float stroke, Color color) {
+    memset(trail, 0, sizeof(OldMotionTrail));
+    trail->maxPoints = MAX_TRAIL_POINTS;
+    trail->fadeDelta = 1.0f / fade;
+    trail->minSeg = minSeg * minSeg;  // Compare squared distance
+    trail->stroke = stroke;
+    trail->displayedColor = color;
+    trail->appendNewPoints = true;
+    trail->startingPositionInitialized = true;
+}
+
+static void OldMotionTrail_Update(OldMotionTrail* trail, float delta) {
+    if (trail->waveTrail) return;
+    if (!trail->startingPositionInitialized) return;
+
+    delta *= trail->fadeDelta;
+
+    unsigned int newIdx, newIdx2, i, i2;
+    unsigned int mov = 0;
+
+    // Fade old points
+    for (i = 0; i < trail->nuPoints; i++) {
+        trail->pointState[i] -= delta;
+        if (trail->pointState[i] <= 0) {
+            mov++;
+        } else {
+            newIdx = i - mov;
+            if (mov > 0) {
+                trail->pointState[newIdx] = trail->pointState[i];
+                trail->pointVertexes[newIdx] = trail->pointVertexes[i];
+
+                i2 = i * 2;
+                newIdx2 = newIdx * 2;
+                trail->vertices[newIdx2] = trail->vertices[i2];
+                trail->vertices[newIdx2 + 1] = trail->vertices[i2 + 1];
+
+                i2 *= 4;
+                newIdx2 *= 4;
+                memcpy(&trail->colorPointer[newIdx2], &trail->colorPointer[i2], 8);
+            }
+
+            newIdx2 = newIdx * 8;
+            u8 op = (u8)(trail->pointState[newIdx] * 255.0f);
+            trail->colorPointer[newIdx2 + 3] = op;
+            trail->colorPointer[newIdx2 + 7] = op;
+        }
+    }
+
+    trail->nuPoints -= mov;
+
+    // Append new point
+    bool append = true;
+    if (trail->nuPoints >= trail->maxPoints) {
+        append = false;
+    } else if (trail->nuPoints > 0) {
+        bool a1 = getDistanceSq(&trail->pointVertexes[trail->nuPoints - 1], &trail->positionR) < trail->minSeg;
+        bool a2 = (trail->nuPoints == 1) ? false : getDistanceSq(&trail->pointVertexes[trail->nuPoints - 2], &trail->positionR) < (trail->minSeg * 2.0f);
+        if (a1 || a2) append = false;
+    }
+
+    if (append && trail->appendNewPoints) {
+        unsigned int idx = trail->nuPoints;
+
+        trail->pointVertexes[idx] = trail->positionR;
+        trail->pointState[idx] = 1.0f;
+
+        unsigned int offset = idx * 8;
+        trail->colorPointer[offset + 0] = trail->displayedColor.r;
+        trail->colorPointer[offset + 1] = trail->displayedColor.g;
+        trail->colorPointer[offset + 2] = trail->displayedColor.b;
+        trail->colorPointer[offset + 3] = 255;
+        trail->colorPointer[offset + 4] = trail->displayedColor.r;
+        trail->colorPointer[offset + 5] = trail->displayedColor.g;
+        trail->colorPointer[offset + 6] = trail->displayedColor.b;
+        trail->colorPointer[offset + 7] = 255;
+
+        trail->nuPoints++;
+
+        if (trail->nuPoints > 1) {
+            ccVertexLineToPolygon(trail->pointVertexes, trail->stroke, trail->vertices, 0, trail->nuPoints);
+        }
+
+    }
+
+    if (!append || !trail->appendNewPoints) {
+        if (trail->nuPoints > 1) {
+            ccVertexLineToPolygon(trail->pointVertexes, trail->stroke, trail->vertices, 0, trail->nuPoints);
+        }
+    }
+
+    // Update tex coords
+    if (trail->nuPoints && trail->previousNuPoints != trail->nuPoints) {
+        float texDelta = 1.0f / trail->nuPoints;
+        for (i = 0; i < trail->nuPoints; i++) {
+            trail->texCoords[i * 2].u = 0;
+            trail->texCoords[i * 2].v = texDelta * i;
+            trail->texCoords[i * 2 + 1].u = 1;
+            trail->texCoords[i * 2 + 1].v = texDelta * i;
+        }
+        trail->previousNuPoints = trail->nuPoints;
+    }
+}
+
+/* Now: a ring buffer, only the points that change are rebuilt */
+
+typedef struct {
+    bool appendNewPoints;
+    bool startingPositionInitialized;
+    bool waveTrail;
+
+    int head;
+    int nuPoints;
+    int actualNuPoints;
+    int maxPoints;
+    int offscreenCount;
+
+    float opacity;
+    float fadeDelta;
+    float minSeg;
+    float stroke;
+    float builtStroke;
+
+    // A point's opacity is 1 - (fadeTime - pointBirth)
+    float fadeTime;
+
+    Vec2 positionR;
+    Color displayedColor;
+
+    void *texture;
+
+    float pointBirth[MAX_TRAIL_POINTS];
+    Vec2 pointVertexes[MAX_TRAIL_POINTS];
+    Color pointColor[MAX_TRAIL_POINTS];
+    Vec2 vertices[MAX_TRAIL_POINTS * 2]; // Left and right edge per point
+
+    Vec2 lastStopPosition;
+    bool wasStopped;
+
+} MotionTrail;
+
+static inline float get_point_opacity(MotionTrail *trail, int idx) {
+    return 1.0f - (trail->fadeTime - trail->pointBirth[idx]);
+}
+
+// Adds "thickness" to the nth point of the line strip, generating its two triangle strip vertices
+static void build_trail_vertices(MotionTrail *trail, int n) {
+    int count = trail->nuPoints;
+    if (count < 2) return;
+
+    float halfStroke = trail->stroke / 2.0f;
+
+    int idx = TRAIL_INDEX(trail, n);
+    Vec2 p = trail->pointVertexes[idx];
+    Vec2 prev = (n > 0) ? trail->pointVertexes[TRAIL_INDEX(trail, n - 1)] : p;
+    Vec2 next = (n < count - 1) ? trail->pointVertexes[TRAIL_INDEX(trail, n + 1)] : p;
+
+    Vec2 dir;
+    dir.x = next.x - prev.x;
+    dir.y = next.y - prev.y;
+
+    // Normalize direction
+    float len = sqrtf(dir.x * dir.x + dir.y * dir.y);
+    if (len == 0) len = 1.0f;
+    dir.x /= len;
+    dir.y /= len;
+
+    // Perpendicular vector
+    Vec2 perp;
+    perp.x = -dir.y;
+    perp.y = dir.x;
+
+    // Offset left and right
+    trail->vertices[idx * 2].x     = p.x + perp.x * halfStroke;
+    trail->vertices[idx * 2].y     = p.y + perp.y * halfStroke;
+
+    trail->vertices[idx * 2 + 1].x = p.x - perp.x * halfStroke;
+    trail->vertices[idx * 2 + 1].y = p.y - perp.y * halfStroke;
+}
+
+static void rebuild_trail_vertices(MotionTrail *trail) {
+    for (int n = 0; n < trail->nuPoints; n++) {
+        build_trail_vertices(trail, n);
+    }
+    trail->builtStroke = trail->stroke;
+}
+
+static void MotionTrail_Init(MotionTrail* trail, float fade, float minSeg, float stroke, Color color) {
+    memset(trail, 0, sizeof(MotionTrail));
+    trail->maxPoints = MAX_TRAIL_POINTS;
+    trail->fadeDelta = 1.0f / fade;
+    trail->minSeg = minSeg * minSeg;  // Compare squared distance
+    trail->stroke = stroke;
+    trail->builtStroke = stroke;
+    trail->displayedColor = color;
+    trail->appendNewPoints = true;
+    trail->startingPositionInitialized = true;
+}
+
+static void MotionTrail_Update(MotionTrail* trail, float delta) {
+    if (trail->waveTrail) return;
+    if (!trail->startingPositionInitialized) return;
+
+    trail->fadeTime += delta * trail->fadeDelta;
+
+    // Every point fades at the same rate, so the ones that expire are always the oldest
+    int expired = 0;
+    while (trail->nuPoints > 0 && get_point_opacity(trail, trail->head) <= 0) {
+        trail->head = (trail->head + 1) & (MAX_TRAIL_POINTS - 1);
+        trail->nuPoints--;
+        expired++;
+    }
+
+    // Keep the fade time small so it doesn't lose precision
+    if (trail->fadeTime > TRAIL_REBASE_TIME) {
+        for (int n = 0; n < trail->nuPoints; n++) {
+            trail->pointBirth[TRAIL_INDEX(trail, n)] -= trail->fadeTime;
+        }
+        trail->fadeTime = 0;
+    }
+
+    if (trail->stroke != trail->builtStroke) {
+        // The size changed, so the whole strip has to be rebuilt
+        rebuild_trail_vertices(trail);
+    } else if (expired > 0) {
+        // The new oldest point is now an end of the strip
+        build_trail_vertices(trail, 0);
+    }
+
+    // Append new point
+    bool append = true;
+    if (trail->nuPoints >= trail->maxPoints) {
+        append = false;
+    } else if (trail->nuPoints > 0) {
+        Vec2 *last = &trail->pointVertexes[TRAIL_INDEX(trail, trail->nuPoints - 1)];
+        bool a1 = getDistanceSq(last, &trail->positionR) < trail->minSeg;
+        bool a2 = (trail->nuPoints == 1) ? false : getDistanceSq(&trail->pointVertexes[TRAIL_INDEX(trail, trail->nuPoints - 2)], &trail->positionR) < (trail->minSeg * 2.0f);
+        if (a1 || a2) append = false;
+    }
+
+    if (append && trail->appendNewPoints) {
+        int idx = TRAIL_INDEX(trail, trail->nuPoints);
+
+        trail->pointVertexes[idx] = trail->positionR;
+        trail->pointBirth[idx] = trail->fadeTime;
+        trail->pointColor[idx] = trail->displayedColor;
+
+        trail->nuPoints++;
+
+        // Only the new point and the one before it change
+        if (trail->nuPoints > 1) {
+            build_trail_vertices(trail, trail->nuPoints - 2);
+            build_trail_vertices(trail, trail->nuPoints - 1);
+        }
+    }
+}
+
+static OldMotionTrail old_trail, old_trail_p1;
+static MotionTrail trail, trail_p1;
+
+static void run_case(const char *name, float fade, float min_seg, float speed, int steps) {
+    float dt = 1.f / STEPS_HZ;
+    Color color = { 255, 255, 255 };
+
+    OldMotionTrail_Init(&old_trail_p1, fade, min_seg, 10.0f, color);
+    MotionTrail_Init(&trail_p1, fade, min_seg, 10.0f, color);
+
+    // Fill the trail up before timing
+    int warmup = (int) (fade * STEPS_HZ) + 1;
+    int total_points = 0, old_total_points = 0;
+    u64 old_ns = 0, new_ns = 0;
+
+    for (int step = 0; step < warmup + steps; step++) {
+        float x = step * speed * dt;
+        float y = 50.f + 30.f * sinf(step * 0.02f);
+
+        u64 t0 = now_ns();
+        old_trail = old_trail_p1;
+        old_trail.positionR = (Vec2) { x, y };
+        OldMotionTrail_Update(&old_trail, dt);
+        old_trail_p1 = old_trail;
+        u64 t1 = now_ns();
+        trail = trail_p1;
+        trail.positionR = (Vec2) { x, y };
+        MotionTrail_Update(&trail, dt);
+        trail_p1 = trail;
+        u64 t2 = now_ns();
+
+        if (step < warmup) continue;
+        old_ns += t1 - t0;
+        new_ns += t2 - t1;
+        old_total_points += old_trail_p1.nuPoints;
+        total_points += trail_p1.nuPoints;
+    }
+
+    float old_us = old_ns / 1000.f / steps;
+    float new_us = new_ns / 1000.f / steps;
+    printf("%-5s %6.1f %6.1f points  old %7.3f us/step  new %7.3f us/step  (%.1fx)\n", name,
+        (float) old_total_points / steps, (float) total_points / steps, old_us, new_us, old_us / new_us);
+}
+
+int main(int argc, char **argv) {
+    int steps = (argc > 1) ? atoi(argv[1]) : 24000;
+    if (steps < 1) {
+        fprintf(stderr, "Usage: %s [steps]\n", argv[0]);
+        return 1;
+    }
+
+    printf("MotionTrail is %zu bytes, it was %zu\n", sizeof(MotionTrail), sizeof(OldMotionTrail));
+
+    float dt = 1.f / STEPS_HZ;
+    // A point every step, each lasting MAX_TRAIL_POINTS steps
+    run_case("full", MAX_TRAIL_POINTS * dt, 3, 4 * STEPS_HZ, steps);
+    // The player's trail at normal speed
+    run_case("game", 0.3f, 3, 311.58f, steps);
+    return 0;
+}